@@ -0,0 +1,131 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "cpu/band_stream.hpp"
+#include "cpu/thread_pool.hpp"
+
+// peak rss of three 8k fp16 monitors side by side (23040x4320), tonemapped
+// as a whole frame or streamed in bands. peak rss only grows, so every mode
+// runs in its own process:
+//   bench_band_stream frame
+//   bench_band_stream <band height>
+namespace
+{
+	constexpr int monitor_width = 7680;
+	constexpr int monitor_height = 4320;
+	constexpr int monitors = 3;
+
+	void fill(uint8_t* px, size_t size)
+	{
+		// halves between 0.125 and 2.0
+		for (size_t i = 0; i < size; i += 2)
+		{
+			const auto half = static_cast<uint16_t>(0x3000 + (i * 2654435761u >> 8) % 0x1800);
+			std::memcpy(px + i, &half, 2);
+		}
+	}
+
+	// makes up the pixels of every request, like a staging texture would hold
+	struct synthetic_reader : cpu::band_reader
+	{
+		struct request_t
+		{
+			std::vector<uint8_t> pixels;
+			int width;
+			int height;
+		};
+
+		void* request(size_t, const cpu::rect& region) override
+		{
+			auto* r = new request_t{ std::vector<uint8_t>(static_cast<size_t>(region.width()) * region.height() * 8), region.width(), region.height() };
+			fill(r->pixels.data(), r->pixels.size());
+			return r;
+		}
+
+		cpu::image_view wait(void* request) override
+		{
+			const auto* r = static_cast<request_t*>(request);
+			return { r->pixels.data(), r->width, r->height, r->width * 8, cpu::pixel_format::r16g16b16a16_float };
+		}
+
+		void release(void* request) override
+		{
+			delete static_cast<request_t*>(request);
+		}
+	};
+
+	// one band sized buffer, like the SetDIBitsToDevice path
+	struct band_buffer_sink : cpu::band_sink
+	{
+		std::vector<uint8_t> pixels;
+
+		cpu::bitmap_view begin(const cpu::rect& band) override
+		{
+			pixels.resize(static_cast<size_t>(band.width()) * band.height() * 4);
+			return { pixels.data(), band.width(), band.height(), band.width() * 4 };
+		}
+
+		void end(const cpu::rect&, const cpu::bitmap_view&) override
+		{
+		}
+	};
+
+	long peak_rss_mb()
+	{
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss / 1024;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::printf("usage: %s frame | <band height>\n", argv[0]);
+		return 1;
+	}
+
+	constexpr int width = monitor_width * monitors;
+	constexpr int height = monitor_height;
+
+	auto& pool = cpu::thread_pool::shared();
+
+	std::vector<cpu::band_source> sources;
+	for (int i = 0; i < monitors; i++)
+		sources.push_back({ { monitor_width, monitor_height, i * monitor_width, 0, cpu::rotation_t::identity }, 200.0f });
+
+	if (!std::strcmp(argv[1], "frame"))
+	{
+		std::vector<std::vector<uint8_t>> images;
+		std::vector<cpu::render_job> jobs;
+
+		for (int i = 0; i < monitors; i++)
+		{
+			images.emplace_back(static_cast<size_t>(monitor_width) * monitor_height * 8);
+			fill(images.back().data(), images.back().size());
+
+			jobs.push_back({ { images.back().data(), monitor_width, monitor_height, monitor_width * 8, cpu::pixel_format::r16g16b16a16_float },
+				i * monitor_width, 0, cpu::rotation_t::identity, 200.0f });
+		}
+
+		std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 4);
+		cpu::tonemap(jobs, { frame.data(), width, height, width * 4 }, pool);
+
+		std::printf("%dx%d whole frame: peak rss %ld MB\n", width, height, peak_rss_mb());
+		return 0;
+	}
+
+	const int band_height = std::atoi(argv[1]);
+
+	synthetic_reader reader;
+	band_buffer_sink sink;
+	cpu::stream_bands(sources, width, height, band_height, reader, sink, pool);
+
+	std::printf("%dx%d in %d row bands: peak rss %ld MB\n", width, height, band_height, peak_rss_mb());
+}
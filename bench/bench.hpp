@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace bench
+{
+	// median of runs calls of fn in milliseconds, after one call to warm up
+	template <typename Fn>
+	double median_ms(int runs, Fn&& fn)
+	{
+		fn();
+
+		std::vector<double> times;
+		times.reserve(runs);
+
+		for (int i = 0; i < runs; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			fn();
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		return times[times.size() / 2];
+	}
+
+	// an fp16 frame that looks like an hdr desktop: scRGB values mostly at or
+	// below the sdr white of 200 nits (2.5), every 16th pixel a highlight
+	inline std::vector<uint16_t> hdr_frame(int width, int height, uint32_t seed = 1)
+	{
+		const auto to_half = [](float value)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+
+			const int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+			if (exponent <= 0)
+				return static_cast<uint16_t>(0);
+
+			return static_cast<uint16_t>((exponent << 10) | ((bits & 0x7fffff) >> 13));
+		};
+
+		std::mt19937 rng{ seed };
+		std::uniform_real_distribution<float> desktop{ 0.0f, 2.5f };
+		std::uniform_real_distribution<float> highlight{ 2.5f, 12.0f };
+
+		std::vector<uint16_t> px(static_cast<size_t>(width) * height * 4);
+
+		for (size_t i = 0; i < px.size(); i += 4)
+		{
+			auto& range = (i / 4) % 16 ? desktop : highlight;
+
+			px[i] = to_half(range(rng));
+			px[i + 1] = to_half(range(rng));
+			px[i + 2] = to_half(range(rng));
+			px[i + 3] = to_half(1.0f);
+		}
+
+		return px;
+	}
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "cpu/capture_service.hpp"
+
+// concurrent BitBlt callers, half of them asking for the whole 1080p desktop
+// and half for loupe sized crops, served by a plain mutex around the capture
+// against capture_service. the fake capture waits 4 ms like an acquire and
+// readback would, then fills a pattern derived from each pixel's position
+//   bench_capture_service [threads] [requests per thread]
+namespace
+{
+	using clock_type = std::chrono::steady_clock;
+
+	uint32_t pattern(int x, int y)
+	{
+		return (static_cast<uint32_t>(x) * 2654435761u) ^ (static_cast<uint32_t>(y) * 40503u);
+	}
+
+	std::atomic<int> inside{ 0 };
+	std::atomic<bool> reentered{ false };
+
+	bool fake_capture(const cpu::rect& area, const cpu::bitmap_view& dest)
+	{
+		reentered = reentered || inside++;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(4));
+
+		for (int y = 0; y < area.height(); y++)
+		{
+			auto* row = reinterpret_cast<uint32_t*>(dest.data + dest.pitch * y);
+
+			for (int x = 0; x < area.width(); x++)
+				row[x] = pattern(area.left + x, area.top + y);
+		}
+
+		inside--;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int threads = argc > 1 ? std::atoi(argv[1]) : 16;
+	const int per_thread = argc > 2 ? std::atoi(argv[2]) : 40;
+
+	const char* names[] = { "mutex, no coalescing", "service, window 0", "service, window 1 ms" };
+
+	std::printf("%d threads x %d requests\n\n", threads, per_thread);
+	std::printf("%-22s %8s %8s %8s %9s %6s\n", "", "req/s", "p50 ms", "p99 ms", "captures", "wrong");
+
+	for (int mode = 0; mode < 3; mode++)
+	{
+		std::mutex plain;
+		std::atomic<uint64_t> plain_captures{ 0 };
+		cpu::capture_service service{ fake_capture, std::chrono::microseconds(mode == 2 ? 1000 : 0) };
+
+		std::mutex latency_mutex;
+		std::vector<double> latencies;
+		std::atomic<int> wrong{ 0 };
+
+		const auto start = clock_type::now();
+		std::vector<std::thread> callers;
+
+		for (int t = 0; t < threads; t++)
+		{
+			callers.emplace_back([&, t]
+			{
+				std::mt19937 rng{ static_cast<uint32_t>(t) };
+				std::vector<double> mine;
+				std::vector<uint32_t> pixels;
+
+				for (int i = 0; i < per_thread; i++)
+				{
+					cpu::rect request{ 0, 0, 1920, 1080 };
+
+					if (rng() % 2)
+					{
+						const int x = static_cast<int>(rng() % 1600);
+						const int y = static_cast<int>(rng() % 800);
+						request = { x, y, x + 64 + static_cast<int>(rng() % 256), y + 64 + static_cast<int>(rng() % 256) };
+					}
+
+					pixels.assign(static_cast<size_t>(request.width()) * request.height(), 0);
+					const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(pixels.data()), request.width(), request.height(), request.width() * 4 };
+
+					const auto requested = clock_type::now();
+					bool ok;
+
+					if (mode == 0)
+					{
+						std::lock_guard lock{ plain };
+						ok = fake_capture(request, dest);
+						plain_captures++;
+					}
+					else
+					{
+						ok = service.capture(request, dest);
+					}
+
+					mine.push_back(std::chrono::duration<double, std::milli>(clock_type::now() - requested).count());
+
+					for (int y = 0; ok && y < request.height(); y++)
+					{
+						for (int x = 0; x < request.width(); x++)
+							ok &= pixels[static_cast<size_t>(y) * request.width() + x] == pattern(request.left + x, request.top + y);
+					}
+
+					wrong += !ok;
+					std::this_thread::sleep_for(std::chrono::milliseconds(rng() % 3));
+				}
+
+				std::lock_guard lock{ latency_mutex };
+				latencies.insert(latencies.end(), mine.begin(), mine.end());
+			});
+		}
+
+		for (auto& caller : callers)
+			caller.join();
+
+		const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+		std::sort(latencies.begin(), latencies.end());
+
+		const auto captures = mode == 0 ? plain_captures.load() : service.captures();
+
+		std::printf("%-22s %8.0f %8.2f %8.2f %9llu %6d\n", names[mode], latencies.size() / seconds,
+					latencies[latencies.size() / 2], latencies[static_cast<size_t>(latencies.size() * 0.99)],
+					static_cast<unsigned long long>(captures), wrong.load());
+	}
+
+	if (reentered)
+		std::printf("\nthe capture was reentered\n");
+}
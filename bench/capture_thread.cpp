@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "cpu/capture_thread.hpp"
+
+// how many requests the background thread answers for captures and requests
+// of different speeds, against the 33 ms max age the hook uses. every frame
+// carries the time its capture started, so the age of what was served can be
+// checked, and one number in every pixel so a torn frame shows
+int main()
+{
+	using namespace std::chrono;
+
+	const auto now_ms = []
+	{
+		return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+	};
+
+	std::printf("%10s %10s %8s %6s %10s %9s\n", "capture ms", "request ms", "hits", "torn", "oldest ms", "captures");
+
+	for (const int capture_ms : { 2, 10, 30 })
+	{
+		for (const int request_ms : { 1, 5, 20 })
+		{
+			std::atomic<uint32_t> number{ 0 };
+
+			cpu::capture_thread thread{ [&](const cpu::rect&, const cpu::bitmap_view& dest)
+			{
+				const uint32_t started = now_ms();
+				std::this_thread::sleep_for(milliseconds(capture_ms));
+
+				const uint32_t n = ++number;
+				for (int y = 0; y < dest.height; y++)
+				{
+					auto* row = reinterpret_cast<uint32_t*>(dest.data + dest.pitch * y);
+					for (int x = 0; x < dest.width; x++)
+						row[x] = n;
+				}
+
+				*reinterpret_cast<uint32_t*>(dest.data) = started;
+				return true;
+			}, milliseconds(33), seconds(1) };
+
+			std::vector<uint32_t> out(64 * 64);
+			const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), 64, 64, 64 * 4 };
+
+			int requests = 0;
+			int hits = 0;
+			int torn = 0;
+			uint32_t oldest = 0;
+
+			const auto end = steady_clock::now() + milliseconds(600);
+
+			while (steady_clock::now() < end)
+			{
+				requests++;
+
+				if (thread.try_get({ 0, 0, 64, 64 }, dest))
+				{
+					hits++;
+
+					for (size_t i = 2; i < out.size(); i++)
+					{
+						if (out[i] != out[1])
+						{
+							torn++;
+							break;
+						}
+					}
+
+					oldest = std::max(oldest, now_ms() - out[0]);
+				}
+
+				std::this_thread::sleep_for(milliseconds(request_ms));
+			}
+
+			thread.stop();
+
+			std::printf("%10d %10d %3d/%-4d %6d %10u %9llu\n", capture_ms, request_ms, hits, requests, torn, oldest,
+						static_cast<unsigned long long>(thread.captures()));
+		}
+	}
+}
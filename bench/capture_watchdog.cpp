@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bench.hpp"
+#include "cpu/capture_watchdog.hpp"
+#include "cpu/strided_copy.hpp"
+#include "cpu/thread_pool.hpp"
+
+// what running a capture under the watchdog costs on top of the capture.
+// the worker fills a pooled buffer that the caller copies into its
+// destination once the capture is in, so a direct to dib capture pays one
+// extra full frame copy plus the hand off. the fake capture only writes the
+// frame, standing in for the last pass of the tonemap
+int main()
+{
+	constexpr int runs = 15;
+
+	struct size
+	{
+		int width;
+		int height;
+	};
+
+	const size sizes[] = { { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 }, { 7680, 4320 } };
+
+	const auto fill = [](const cpu::rect& area, const cpu::bitmap_view& dest)
+	{
+		for (int y = 0; y < area.height(); y++)
+			std::memset(dest.data + dest.pitch * y, y & 0xff, static_cast<size_t>(area.width()) * 4);
+
+		return true;
+	};
+
+	cpu::capture_watchdog watchdog{ fill, std::chrono::seconds(10) };
+
+	std::printf("%u threads, median of %d\n\n", cpu::thread_pool::shared().size(), runs);
+	std::printf("%12s %10s %12s %10s %9s\n", "size", "direct ms", "watchdog ms", "copy ms", "extra ms");
+
+	for (const auto& s : sizes)
+	{
+		const cpu::rect area{ 0, 0, s.width, s.height };
+		const size_t row_bytes = static_cast<size_t>(s.width) * 4;
+
+		std::vector<uint8_t> dest(row_bytes * s.height);
+		std::vector<uint8_t> pooled(row_bytes * s.height, 1);
+		const cpu::bitmap_view view{ dest.data(), s.width, s.height, static_cast<ptrdiff_t>(row_bytes) };
+
+		const auto direct_ms = bench::median_ms(runs, [&] { fill(area, view); });
+
+		const auto watchdog_ms = bench::median_ms(runs, [&] { watchdog.capture(area, view); });
+
+		const auto copy_ms = bench::median_ms(runs, [&]
+		{
+			cpu::strided_copy(pooled.data(), row_bytes, dest.data(), row_bytes, row_bytes, s.height, cpu::thread_pool::shared());
+		});
+
+		std::printf("%6dx%-5d %10.2f %12.2f %10.2f %9.2f\n", s.width, s.height, direct_ms, watchdog_ms, copy_ms,
+					watchdog_ms - direct_ms);
+	}
+}
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <thread>
+#include <utility>
+
+#include "cpu/frame_acquirer.hpp"
+
+// time spent acquiring against a fake duplication that presents frames at
+// scripted times and blocks like dxgi would, for a static desktop and for a
+// desktop presenting every 5 ms while captures come every 3 ms
+namespace
+{
+	using namespace std::chrono;
+
+	struct timed_source : cpu::duplication_source
+	{
+		steady_clock::time_point start = steady_clock::now();
+
+		// ms since start, and whether more than the pointer changed
+		std::deque<std::pair<double, bool>> script;
+
+		acquire_status acquire(unsigned int timeout_ms, bool& presented) override
+		{
+			const double now = duration<double, std::milli>(steady_clock::now() - start).count();
+
+			if (script.empty() || script.front().first > now + timeout_ms)
+			{
+				std::this_thread::sleep_for(milliseconds(timeout_ms));
+				return acquire_status::timeout;
+			}
+
+			const auto [at, changed] = script.front();
+			script.pop_front();
+
+			if (at > now)
+				std::this_thread::sleep_for(duration<double, std::milli>(at - now));
+
+			presented = changed;
+			return acquire_status::frame;
+		}
+
+		void retain() override
+		{
+		}
+
+		void release() override
+		{
+		}
+
+		void recreate() override
+		{
+		}
+	};
+
+	void run(const char* name, timed_source& source, milliseconds capture_every)
+	{
+		cpu::frame_acquirer acquirer{ milliseconds(1), seconds(1) };
+		int fresh = 0;
+		int retained = 0;
+
+		for (int i = 0; i < 500; i++)
+		{
+			const auto r = acquirer.acquire(source);
+			fresh += r == cpu::frame_acquirer::result::fresh;
+			retained += r == cpu::frame_acquirer::result::retained;
+
+			std::this_thread::sleep_for(capture_every);
+		}
+
+		const auto& waits = acquirer.waits();
+		std::printf("%-8s fresh %3d retained %3d p50 %.2f ms p99 %.2f ms\n", name, fresh, retained, waits.percentile(0.5), waits.percentile(0.99));
+	}
+}
+
+int main()
+{
+	timed_source still;
+	still.script = { { 0.0, true } };
+	run("static", still, milliseconds(0));
+
+	// every fourth frame only moves the pointer
+	timed_source busy;
+	for (int i = 0; i < 400; i++)
+		busy.script.push_back({ i * 5.0, i % 4 != 3 });
+	run("busy", busy, milliseconds(3));
+}
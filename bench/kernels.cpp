@@ -0,0 +1,67 @@
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.hpp"
+#include "cpu/kernels.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tonemapper.hpp"
+
+// one 4K frame through every row kernel this cpu can run on a single thread,
+// then through cpu::tonemap with one thread
+int main()
+{
+	constexpr int width = 3840;
+	constexpr int height = 2160;
+	constexpr int runs = 9;
+
+	std::mt19937 rng{ 1 };
+
+	const auto hdr = bench::hdr_frame(width, height);
+
+	std::vector<uint8_t> sdr(static_cast<size_t>(width) * height * 4);
+	for (auto& c : sdr)
+		c = static_cast<uint8_t>(rng());
+
+	std::vector<uint32_t> out(static_cast<size_t>(width) * height);
+
+	std::vector<const cpu::row_kernels*> tables{ &cpu::scalar_row_kernels };
+
+#ifdef CPU_KERNELS_X86
+	if (&cpu::select_row_kernels() != &cpu::scalar_row_kernels)
+		tables.push_back(&cpu::avx2_row_kernels);
+
+	if (&cpu::select_row_kernels() == &cpu::avx512_row_kernels)
+		tables.push_back(&cpu::avx512_row_kernels);
+#endif
+
+	std::printf("%dx%d, median of %d, 1 thread\n\n", width, height, runs);
+	std::printf("%-8s %10s %10s\n", "kernels", "hdr ms", "sdr ms");
+
+	for (const auto* kernels : tables)
+	{
+		const auto hdr_ms = bench::median_ms(runs, [&]
+		{
+			for (int y = 0; y < height; y++)
+				kernels->hdr(reinterpret_cast<const uint8_t*>(hdr.data()) + static_cast<size_t>(width) * 8 * y, out.data() + static_cast<size_t>(width) * y, width, 200.0f);
+		});
+
+		const auto sdr_ms = bench::median_ms(runs, [&]
+		{
+			for (int y = 0; y < height; y++)
+				kernels->sdr(sdr.data() + static_cast<size_t>(width) * 4 * y, out.data() + static_cast<size_t>(width) * y, width, 0.0f);
+		});
+
+		std::printf("%-8s %10.2f %10.2f\n", kernels->name, hdr_ms, sdr_ms);
+	}
+
+	cpu::thread_pool pool{ 1 };
+
+	const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), width, height, width * 4 };
+	const cpu::render_job job{ { reinterpret_cast<const uint8_t*>(hdr.data()), width, height, width * 8, cpu::pixel_format::r16g16b16a16_float }, 0, 0, cpu::rotation_t::identity, 200.0f };
+
+	const auto tonemap_ms = bench::median_ms(runs, [&] { cpu::tonemap({ &job, 1 }, dest, pool); });
+
+	std::printf("\ncpu::tonemap hdr (%s), 1 thread: %.2f ms\n", cpu::select_row_kernels().name, tonemap_ms);
+}
@@ -0,0 +1,71 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "cpu/monitor_batch.hpp"
+#include "cpu/retained_frame.hpp"
+#include "cpu/thread_pool.hpp"
+
+// three 4K hdr monitors side by side with every tile damaged, updated and
+// composed a monitor at a time against a single render_batch
+int main()
+{
+	constexpr int width = 3840;
+	constexpr int height = 2160;
+	constexpr int count = 3;
+	constexpr int runs = 9;
+
+	std::vector<std::vector<uint16_t>> frames;
+	for (int i = 0; i < count; i++)
+		frames.push_back(bench::hdr_frame(width, height, i + 1));
+
+	std::vector<uint8_t> out(static_cast<size_t>(width) * count * height * 4);
+	const cpu::bitmap_view dest{ out.data(), width * count, height, width * count * 4 };
+
+	auto& pool = cpu::thread_pool::shared();
+
+	std::vector<cpu::retained_frame> retained(count);
+	std::vector<cpu::monitor_params> table(count);
+	std::vector<cpu::retained_frame*> targets;
+	std::vector<cpu::image_view> sources;
+
+	for (int i = 0; i < count; i++)
+	{
+		cpu::make_monitor_params({ width, height, i * width, 0, cpu::rotation_t::identity }, cpu::pixel_format::r16g16b16a16_float, 200.0f,
+								 width * count, height, table[i]);
+
+		targets.push_back(&retained[i]);
+		sources.push_back({ reinterpret_cast<const uint8_t*>(frames[i].data()), width, height, width * 8, cpu::pixel_format::r16g16b16a16_float });
+	}
+
+	const auto damage_all = [&]
+	{
+		for (auto& frame : retained)
+		{
+			frame.prepare(width, height, cpu::pixel_format::r16g16b16a16_float, 200.0f);
+			frame.damage_all();
+		}
+	};
+
+	const auto single_ms = bench::median_ms(runs, [&]
+	{
+		damage_all();
+
+		for (int i = 0; i < count; i++)
+		{
+			retained[i].update(sources[i], table[i].region, pool);
+			retained[i].compose(table[i].region, table[i].visible, dest, pool);
+		}
+	});
+
+	const auto batched_ms = bench::median_ms(runs, [&]
+	{
+		damage_all();
+		cpu::render_batch(table, targets, sources, dest, pool);
+	});
+
+	std::printf("3x %dx%d hdr, full damage, %u threads, median of %d\n\n", width, height, pool.size(), runs);
+	std::printf("per monitor %8.2f ms\n", single_ms);
+	std::printf("batched     %8.2f ms\n", batched_ms);
+}
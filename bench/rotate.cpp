@@ -0,0 +1,58 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "cpu/kernels.hpp"
+#include "cpu/rotate.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tonemapper.hpp"
+
+// a 4K hdr frame tonemapped at every rotation on one thread, the rotated
+// tiles go through rotate_copy, and rotate_copy of a 4K bgra frame alone.
+// speed is relative to the unrotated tonemap
+int main()
+{
+	constexpr int width = 3840;
+	constexpr int height = 2160;
+	constexpr int runs = 9;
+
+	const auto hdr = bench::hdr_frame(width, height);
+	std::vector<uint32_t> out(static_cast<size_t>(width) * height);
+
+	const char* names[] = { "0", "90", "180", "270" };
+	const cpu::rotation_t rotations[] =
+	{
+		cpu::rotation_t::identity, cpu::rotation_t::rotate90, cpu::rotation_t::rotate180, cpu::rotation_t::rotate270,
+	};
+
+	cpu::thread_pool pool{ 1 };
+
+	std::printf("%dx%d, %s kernels, median of %d, 1 thread\n\n", width, height, cpu::select_row_kernels().name, runs);
+	std::printf("%8s %12s %8s %14s\n", "rotation", "tonemap ms", "speed", "rotate_copy ms");
+
+	double unrotated = 0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		const bool transposed = rotations[i] == cpu::rotation_t::rotate90 || rotations[i] == cpu::rotation_t::rotate270;
+		const int dest_width = transposed ? height : width;
+		const int dest_height = transposed ? width : height;
+
+		const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), dest_width, dest_height, dest_width * 4 };
+		const cpu::render_job job{ { reinterpret_cast<const uint8_t*>(hdr.data()), width, height, width * 8, cpu::pixel_format::r16g16b16a16_float }, 0, 0, rotations[i], 200.0f };
+
+		const auto tonemap_ms = bench::median_ms(runs, [&] { cpu::tonemap({ &job, 1 }, dest, pool); });
+
+		// the fp16 frame reused as bgra, only the layout matters here
+		const auto copy_ms = bench::median_ms(runs, [&]
+		{
+			cpu::rotate_copy(reinterpret_cast<const uint8_t*>(hdr.data()), width * 4, width, height, dest.data, dest.pitch, rotations[i]);
+		});
+
+		if (!i)
+			unrotated = tonemap_ms;
+
+		std::printf("%8s %12.2f %7.0f%% %14.2f\n", names[i], tonemap_ms, 100.0 * unrotated / tonemap_ms, copy_ms);
+	}
+}
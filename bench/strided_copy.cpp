@@ -0,0 +1,57 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bench.hpp"
+#include "cpu/kernels.hpp"
+#include "cpu/strided_copy.hpp"
+#include "cpu/thread_pool.hpp"
+
+// copying a mapped bgra readback with a padded row pitch into a packed frame
+// buffer, a row by row memcpy against strided_copy. copies past the last
+// level cache use streaming stores
+int main()
+{
+	constexpr int runs = 9;
+
+	struct size
+	{
+		int width;
+		int height;
+		int padding;
+	};
+
+	const size sizes[] =
+	{
+		{ 1920, 1080, 0 }, { 1920, 1080, 256 }, { 3840, 2160, 0 }, { 3840, 2160, 64 },
+		{ 7680, 4320, 0 }, { 7680, 4320, 256 }, { 11520, 2160, 0 },
+	};
+
+	cpu::thread_pool pool;
+
+	std::printf("last level cache %zu MB, %u threads, median of %d\n\n", cpu::last_level_cache_size() >> 20, pool.size(), runs);
+	std::printf("%12s %7s %10s %14s\n", "size", "padding", "memcpy ms", "strided ms");
+
+	for (const auto& s : sizes)
+	{
+		const size_t row_bytes = static_cast<size_t>(s.width) * 4;
+		const size_t src_pitch = row_bytes + s.padding;
+
+		std::vector<uint8_t> src(src_pitch * s.height, 1);
+		std::vector<uint8_t> dest(row_bytes * s.height);
+
+		const auto memcpy_ms = bench::median_ms(runs, [&]
+		{
+			for (int y = 0; y < s.height; y++)
+				std::memcpy(&dest[row_bytes * y], &src[src_pitch * y], row_bytes);
+		});
+
+		const auto strided_ms = bench::median_ms(runs, [&]
+		{
+			cpu::strided_copy(src.data(), src_pitch, dest.data(), row_bytes, row_bytes, s.height, pool);
+		});
+
+		std::printf("%6dx%-5d %7d %10.2f %14.2f\n", s.width, s.height, s.padding, memcpy_ms, strided_ms);
+	}
+}
@@ -0,0 +1,40 @@
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "bench.hpp"
+#include "cpu/kernels.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tonemapper.hpp"
+
+// how cpu::tonemap of a 4K hdr frame scales with the threads of the pool
+int main()
+{
+	constexpr int width = 3840;
+	constexpr int height = 2160;
+	constexpr int runs = 9;
+
+	const auto hdr = bench::hdr_frame(width, height);
+	std::vector<uint32_t> out(static_cast<size_t>(width) * height);
+
+	const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), width, height, width * 4 };
+	const cpu::render_job job{ { reinterpret_cast<const uint8_t*>(hdr.data()), width, height, width * 8, cpu::pixel_format::r16g16b16a16_float }, 0, 0, cpu::rotation_t::identity, 200.0f };
+
+	std::printf("%dx%d hdr, %s kernels, %u hardware threads, median of %d\n\n", width, height, cpu::select_row_kernels().name, std::thread::hardware_concurrency(), runs);
+	std::printf("%8s %10s %8s\n", "threads", "ms", "speedup");
+
+	double single = 0;
+
+	for (const unsigned int threads : { 1u, 2u, 4u, 8u, 16u })
+	{
+		cpu::thread_pool pool{ threads };
+
+		const auto ms = bench::median_ms(runs, [&] { cpu::tonemap({ &job, 1 }, dest, pool); });
+
+		if (threads == 1)
+			single = ms;
+
+		std::printf("%8u %10.2f %8.2f\n", threads, ms, single / ms);
+	}
+}
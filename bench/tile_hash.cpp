@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "cpu/kernels.hpp"
+#include "cpu/retained_frame.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tile_cache.hpp"
+
+// what the tile cache costs and saves on a 4K frame, one thread: hashing
+// every tile against tonemapping every row, and a full retained update with
+// a warm cache against one without a cache
+int main()
+{
+	constexpr int width = 3840;
+	constexpr int height = 2160;
+	constexpr int runs = 9;
+
+	const auto hdr = bench::hdr_frame(width, height);
+	const auto* px = reinterpret_cast<const uint8_t*>(hdr.data());
+	std::vector<uint32_t> out(static_cast<size_t>(width) * height);
+
+	const auto& kernels = cpu::select_row_kernels();
+	volatile uint64_t sink = 0;
+
+	const auto hash_ms = bench::median_ms(runs, [&]
+	{
+		for (int y = 0; y < height; y += cpu::tile_size)
+		{
+			for (int x = 0; x < width; x += cpu::tile_size)
+			{
+				const int w = std::min(cpu::tile_size, width - x);
+				const int h = std::min(cpu::tile_size, height - y);
+				sink = sink + kernels.hash(px + (static_cast<size_t>(y) * width + x) * 8, width * 8, w * 8, h);
+			}
+		}
+	});
+
+	const auto tonemap_ms = bench::median_ms(runs, [&]
+	{
+		for (int y = 0; y < height; y++)
+			kernels.hdr(px + static_cast<size_t>(y) * width * 8, out.data() + static_cast<size_t>(y) * width, width, 200.0f);
+	});
+
+	cpu::thread_pool pool{ 1 };
+	cpu::tile_cache cache{ 64 << 20 };
+
+	const cpu::image_view src{ px, width, height, width * 8, cpu::pixel_format::r16g16b16a16_float };
+	const cpu::rect region{ 0, 0, width, height };
+
+	cpu::retained_frame cached, plain;
+	cached.prepare(width, height, src.format, 200.0f);
+	plain.prepare(width, height, src.format, 200.0f);
+
+	const auto cached_ms = bench::median_ms(runs, [&]
+	{
+		cached.damage_all();
+		cached.update(src, region, pool, &cache);
+	});
+
+	const auto plain_ms = bench::median_ms(runs, [&]
+	{
+		plain.damage_all();
+		plain.update(src, region, pool);
+	});
+
+	std::printf("%dx%d, %s kernels, median of %d, 1 thread\n\n", width, height, kernels.name, runs);
+	std::printf("hash every tile      %8.2f ms\n", hash_ms);
+	std::printf("tonemap every row    %8.2f ms\n", tonemap_ms);
+	std::printf("update, warm cache   %8.2f ms (%llu hits, %zu bytes)\n", cached_ms, static_cast<unsigned long long>(cache.hits()), cache.size());
+	std::printf("update, no cache     %8.2f ms\n", plain_ms);
+}
@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "bench.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tonemapper.hpp"
+#include "cpu/worker_group.hpp"
+
+// monitors processed one after the other against one worker each. a fake
+// monitor waits 2 ms to acquire and 3 ms for its readback, then tonemaps a
+// 1080p fp16 frame into its part of a shared destination
+int main()
+{
+	using namespace std::chrono;
+
+	constexpr int width = 1920;
+	constexpr int height = 1080;
+	constexpr uint32_t max_monitors = 6;
+	constexpr int runs = 15;
+
+	const auto hdr = bench::hdr_frame(width, height);
+	std::vector<uint8_t> dest(static_cast<size_t>(width) * max_monitors * height * 4);
+
+	auto& pool = cpu::thread_pool::shared();
+	cpu::worker_group group;
+
+	const auto monitor = [&](uint32_t i)
+	{
+		std::this_thread::sleep_for(milliseconds(2));
+		std::this_thread::sleep_for(milliseconds(3));
+
+		const cpu::render_job job
+		{
+			{ reinterpret_cast<const uint8_t*>(hdr.data()), width, height, width * 8, cpu::pixel_format::r16g16b16a16_float },
+			static_cast<int>(i) * width, 0, cpu::rotation_t::identity, 200.0f,
+		};
+
+		cpu::tonemap({ &job, 1 }, { dest.data(), width * static_cast<int>(max_monitors), height, width * static_cast<int>(max_monitors) * 4 }, pool);
+	};
+
+	std::printf("%u threads, median of %d\n\n", pool.size(), runs);
+	std::printf("%8s %14s %14s %12s\n", "monitors", "sequential ms", "concurrent ms", "waits only");
+
+	for (uint32_t count = 1; count <= max_monitors; count++)
+	{
+		const auto sequential = bench::median_ms(runs, [&]
+		{
+			for (uint32_t i = 0; i < count; i++)
+				monitor(i);
+		});
+
+		const auto concurrent = bench::median_ms(runs, [&] { group.run(count, monitor); });
+
+		// monitors that only wait on the gpu
+		const auto waits = bench::median_ms(runs, [&]
+		{
+			group.run(count, [](uint32_t) { std::this_thread::sleep_for(milliseconds(5)); });
+		});
+
+		std::printf("%8u %14.2f %14.2f %12.2f\n", count, sequential, concurrent, waits);
+	}
+}
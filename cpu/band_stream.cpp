@@ -0,0 +1,160 @@
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "band_stream.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		// a band whose parts are being read
+		struct pending_band
+		{
+			rect band;
+			std::vector<band_part> parts;
+			std::vector<void*> requests;
+		};
+
+		void release_all(band_reader& reader, pending_band& pending)
+		{
+			for (auto* request : pending.requests)
+				reader.release(request);
+
+			pending.requests.clear();
+		}
+
+		void finish_band(std::span<const band_source> sources, pending_band& pending,
+						 band_reader& reader, band_sink& sink, thread_pool& pool)
+		{
+			std::vector<render_job> jobs;
+			jobs.reserve(pending.parts.size());
+
+			for (size_t i = 0; i < pending.parts.size(); i++)
+			{
+				const auto& part = pending.parts[i];
+
+				jobs.push_back({
+					reader.wait(pending.requests[i]),
+					part.visible.x, part.visible.y, part.visible.rotation,
+					sources[part.source].white_level,
+				});
+			}
+
+			const auto pixels = sink.begin(pending.band);
+
+			// the sink may hand out the same memory for every band
+			if (!covers(pending.band, pending.parts))
+			{
+				for (int y = 0; y < pixels.height; y++)
+					std::memset(pixels.data + pixels.pitch * y, 0, static_cast<size_t>(pixels.width) * 4);
+			}
+
+			tonemap(jobs, pixels, pool);
+			release_all(reader, pending);
+
+			sink.end(pending.band, pixels);
+		}
+	}
+
+	void for_each_band(std::span<const placement> sources, int width, int height, int band_height,
+					   const std::function<void(const rect& band, std::span<const band_part> parts)>& fn)
+	{
+		if (width <= 0 || height <= 0)
+			return;
+
+		if (band_height <= 0)
+			band_height = height;
+
+		std::vector<band_part> parts;
+		parts.reserve(sources.size());
+
+		for (int top = 0; top < height; top += band_height)
+		{
+			const rect band{ 0, top, width, height - top > band_height ? top + band_height : height };
+
+			parts.clear();
+
+			for (size_t i = 0; i < sources.size(); i++)
+			{
+				band_part part;
+				part.source = i;
+				part.region = crop(sources[i], band, part.visible);
+
+				if (part.region.empty())
+					continue;
+
+				part.visible.y -= top;
+				parts.push_back(part);
+			}
+
+			fn(band, parts);
+		}
+	}
+
+	bool covers(const rect& band, std::span<const band_part> parts)
+	{
+		int64_t covered = 0;
+
+		// rotation keeps the pixel count, the source area is the area landed on
+		for (const auto& part : parts)
+			covered += static_cast<int64_t>(part.region.width()) * part.region.height();
+
+		return covered >= static_cast<int64_t>(band.width()) * band.height();
+	}
+
+	bitmap_sink::bitmap_sink(const bitmap_view& frame) :
+		frame_(frame)
+	{
+	}
+
+	bitmap_view bitmap_sink::begin(const rect& band)
+	{
+		return { frame_.data + frame_.pitch * band.top, frame_.width, band.height(), frame_.pitch };
+	}
+
+	void bitmap_sink::end(const rect&, const bitmap_view&)
+	{
+	}
+
+	void stream_bands(std::span<const band_source> sources, int width, int height, int band_height,
+					  band_reader& reader, band_sink& sink, thread_pool& pool)
+	{
+		std::vector<placement> places;
+		places.reserve(sources.size());
+
+		for (const auto& source : sources)
+			places.push_back(source.place);
+
+		pending_band previous;
+		pending_band current;
+		bool has_previous = false;
+
+		try
+		{
+			for_each_band(places, width, height, band_height, [&](const rect& band, std::span<const band_part> parts)
+			{
+				current.band = band;
+				current.parts.assign(parts.begin(), parts.end());
+
+				for (const auto& part : parts)
+					current.requests.push_back(reader.request(part.source, part.region));
+
+				if (has_previous)
+					finish_band(sources, previous, reader, sink, pool);
+
+				std::swap(previous, current);
+				has_previous = true;
+			});
+
+			if (has_previous)
+				finish_band(sources, previous, reader, sink, pool);
+		}
+		catch (...)
+		{
+			release_all(reader, previous);
+			release_all(reader, current);
+			throw;
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <span>
+
+#include "geometry.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	class thread_pool;
+
+	// the part of one source that lands in a band
+	struct band_part
+	{
+		size_t source = 0;
+
+		// source pixels, in the source's own coordinates
+		rect region;
+
+		// where region lands, relative to the top left of the band
+		placement visible;
+	};
+
+	// walks a width x height destination in bands of band_height rows, top to
+	// bottom, and hands fn the part of every source that lands in each band.
+	// parts is only valid during the call
+	void for_each_band(std::span<const placement> sources, int width, int height, int band_height,
+					   const std::function<void(const rect& band, std::span<const band_part> parts)>& fn);
+
+	// whether parts leave no pixel of band uncovered, the sources must not overlap
+	bool covers(const rect& band, std::span<const band_part> parts);
+
+	// where the source pixels of a streamed frame come from, a region at a time
+	class band_reader
+	{
+	public:
+		virtual ~band_reader() = default;
+
+		// starts reading region of source, it is only waited on after the next
+		// band was requested so the read overlaps the work on this one
+		virtual void* request(size_t source, const rect& region) = 0;
+
+		// the pixels of a request, valid until it is released. throws when the
+		// read failed
+		virtual image_view wait(void* request) = 0;
+
+		// every request is released exactly once, waited on or not
+		virtual void release(void* request) = 0;
+	};
+
+	// where the bands of a streamed frame go
+	class band_sink
+	{
+	public:
+		virtual ~band_sink() = default;
+
+		// memory for the rows of band, filled in before end is called for it
+		virtual bitmap_view begin(const rect& band) = 0;
+		virtual void end(const rect& band, const bitmap_view& pixels) = 0;
+	};
+
+	// a sink that is a whole frame already, like the caller's dib section
+	class bitmap_sink : public band_sink
+	{
+	public:
+		explicit bitmap_sink(const bitmap_view& frame);
+
+		bitmap_view begin(const rect& band) override;
+		void end(const rect& band, const bitmap_view& pixels) override;
+
+	private:
+		bitmap_view frame_;
+	};
+
+	struct band_source
+	{
+		placement place;
+		float white_level = 200.0f;
+	};
+
+	// produces a width x height frame a band at a time: decode, tonemap, rotate
+	// and pack into whatever sink hands out, then deliver. the parts of a band
+	// are requested before the previous band is tonemapped, so besides what the
+	// sink holds only two bands worth of source pixels are alive at once
+	void stream_bands(std::span<const band_source> sources, int width, int height, int band_height,
+					  band_reader& reader, band_sink& sink, thread_pool& pool);
+}
@@ -0,0 +1,154 @@
+#include <thread>
+#include <utility>
+
+#include "capture_service.hpp"
+#include "strided_copy.hpp"
+#include "thread_pool.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		int64_t area_of(const rect& r)
+		{
+			return static_cast<int64_t>(r.width()) * r.height();
+		}
+	}
+
+	capture_service::capture_service(capture_fn capture, clock::duration window) :
+		capture_(std::move(capture)), window_(window)
+	{
+	}
+
+	bool capture_service::capture(const rect& request, const bitmap_view& dest)
+	{
+		requests_.fetch_add(1, std::memory_order_relaxed);
+
+		std::shared_ptr<batch> b;
+		bool leader = false;
+
+		{
+			std::lock_guard lock{ mutex_ };
+
+			for (const auto& open : open_)
+			{
+				if (fits(*open, request))
+				{
+					b = open;
+					break;
+				}
+			}
+
+			if (!b)
+			{
+				b = std::make_shared<batch>();
+				open_.push_back(b);
+				leader = true;
+			}
+
+			b->bounds = unite(b->bounds, request);
+			b->area += area_of(request);
+			b->members++;
+		}
+
+		if (leader)
+			return lead(*b, request, dest);
+
+		{
+			std::unique_lock lock{ mutex_ };
+			done_.wait(lock, [&] { return b->done; });
+		}
+
+		if (!b->ok)
+			return false;
+
+		copy_out(*b, request, dest);
+		return true;
+	}
+
+	uint64_t capture_service::requests() const
+	{
+		return requests_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t capture_service::captures() const
+	{
+		return captures_.load(std::memory_order_relaxed);
+	}
+
+	bool capture_service::fits(const batch& b, const rect& request) const
+	{
+		// far apart requests are better off captured one after the other than
+		// as one capture of mostly nothing anyone asked for
+		return area_of(unite(b.bounds, request)) <= 2 * (b.area + area_of(request));
+	}
+
+	bool capture_service::lead(batch& b, const rect& request, const bitmap_view& dest)
+	{
+		if (window_ > clock::duration::zero())
+			std::this_thread::sleep_for(window_);
+
+		std::unique_lock capture_lock{ capture_mutex_ };
+
+		{
+			std::lock_guard lock{ mutex_ };
+			std::erase_if(open_, [&](const std::shared_ptr<batch>& open) { return open.get() == &b; });
+		}
+
+		// nobody joined, no need for a copy
+		const bool alone = b.members == 1;
+		bool ok = false;
+
+		try
+		{
+			if (alone)
+			{
+				ok = capture_(request, dest);
+			}
+			else
+			{
+				const auto& bounds = b.bounds;
+
+				b.pixels = pixel_pool::shared().acquire(static_cast<size_t>(area_of(bounds)) * 4);
+				b.view = { b.pixels.data(), bounds.width(), bounds.height(), static_cast<ptrdiff_t>(bounds.width()) * 4 };
+
+				ok = capture_(bounds, b.view);
+			}
+		}
+		catch (...)
+		{
+			capture_lock.unlock();
+			finish(b, false);
+			throw;
+		}
+
+		captures_.fetch_add(1, std::memory_order_relaxed);
+		capture_lock.unlock();
+
+		finish(b, ok);
+
+		if (ok && !alone)
+			copy_out(b, request, dest);
+
+		return ok;
+	}
+
+	void capture_service::finish(batch& b, bool ok)
+	{
+		{
+			std::lock_guard lock{ mutex_ };
+
+			b.done = true;
+			b.ok = ok;
+		}
+
+		done_.notify_all();
+	}
+
+	void capture_service::copy_out(const batch& b, const rect& request, const bitmap_view& dest)
+	{
+		const auto* src = b.view.data + b.view.pitch * (request.top - b.bounds.top) + (request.left - b.bounds.left) * 4;
+
+		strided_copy(src, b.view.pitch, dest.data, dest.pitch, static_cast<size_t>(request.width()) * 4, request.height(), thread_pool::shared());
+	}
+}
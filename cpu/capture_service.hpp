@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "geometry.hpp"
+#include "pixel_pool.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	// serves capture requests from any number of threads, one capture at a
+	// time. requests arriving within window of each other, or while an earlier
+	// capture is still running, are folded into a single capture of their
+	// bounding rect and every caller copies its own part out of it
+	class capture_service
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		// fills dest, which is sized to area, false when capturing failed
+		using capture_fn = std::function<bool(const rect& area, const bitmap_view& dest)>;
+
+		capture_service(capture_fn capture, clock::duration window);
+
+		capture_service(const capture_service&) = delete;
+		capture_service& operator=(const capture_service&) = delete;
+
+		// blocks until request was captured into dest, which is sized to it.
+		// false when the capture it was folded into failed
+		bool capture(const rect& request, const bitmap_view& dest);
+
+		uint64_t requests() const;
+		uint64_t captures() const;
+
+	private:
+		// requests captured together, the first one to arrive runs the capture
+		struct batch
+		{
+			rect bounds;
+			int64_t area = 0;
+			size_t members = 0;
+
+			bool done = false;
+			bool ok = false;
+
+			pixel_buffer pixels;
+			bitmap_view view;
+		};
+
+		bool fits(const batch& b, const rect& request) const;
+
+		bool lead(batch& b, const rect& request, const bitmap_view& dest);
+		void finish(batch& b, bool ok);
+
+		static void copy_out(const batch& b, const rect& request, const bitmap_view& dest);
+
+		capture_fn capture_;
+		clock::duration window_;
+
+		// held for the whole capture, batches keep filling up while they wait
+		std::mutex capture_mutex_;
+
+		std::mutex mutex_;
+		std::condition_variable done_;
+		std::vector<std::shared_ptr<batch>> open_;
+
+		std::atomic<uint64_t> requests_{ 0 };
+		std::atomic<uint64_t> captures_{ 0 };
+	};
+}
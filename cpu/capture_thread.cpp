@@ -0,0 +1,180 @@
+#include <new>
+#include <utility>
+
+#include "capture_thread.hpp"
+#include "strided_copy.hpp"
+#include "thread_pool.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		bool contains(const rect& outer, const rect& inner)
+		{
+			return !inner.empty()
+				&& inner.left >= outer.left && inner.top >= outer.top
+				&& inner.right <= outer.right && inner.bottom <= outer.bottom;
+		}
+	}
+
+	capture_thread::capture_thread(capture_fn capture, clock::duration max_age, clock::duration idle_after) :
+		capture_(std::move(capture)), max_age_(max_age), idle_after_(idle_after),
+		thread_(&capture_thread::run, this)
+	{
+	}
+
+	capture_thread::~capture_thread()
+	{
+		stop();
+	}
+
+	bool capture_thread::try_get(const rect& request, const bitmap_view& dest)
+	{
+		{
+			std::lock_guard lock{ mutex_ };
+
+			if (stop_)
+			{
+				misses_.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			const auto now = clock::now();
+			const bool idle = requested_.empty() || now - requested_at_ > idle_after_;
+
+			// a loupe asking for parts of the desktop should not make the next
+			// whole desktop request miss
+			if (idle || !contains(requested_, request))
+			{
+				requested_ = request;
+				wake_.notify_one();
+			}
+
+			requested_at_ = now;
+		}
+
+		std::lock_guard consumer{ consumer_mutex_ };
+
+		slot_.take();
+		const auto& latest = slot_.front();
+
+		const bool hit = latest.pixels
+			&& contains(latest.area, request)
+			&& clock::now() - latest.captured <= max_age_;
+
+		if (!hit)
+		{
+			misses_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		const ptrdiff_t pitch = latest.area.width() * 4;
+		const auto* src = latest.pixels.data() + pitch * (request.top - latest.area.top) + (request.left - latest.area.left) * 4;
+
+		strided_copy(src, pitch, dest.data, dest.pitch, static_cast<size_t>(request.width()) * 4, request.height(), thread_pool::shared());
+
+		hits_.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void capture_thread::stop()
+	{
+		{
+			std::lock_guard lock{ mutex_ };
+			stop_ = true;
+		}
+
+		wake_.notify_one();
+
+		if (thread_.joinable())
+			thread_.join();
+	}
+
+	capture_thread::clock::duration capture_thread::max_age() const
+	{
+		return max_age_;
+	}
+
+	uint64_t capture_thread::captures() const
+	{
+		return captures_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t capture_thread::hits() const
+	{
+		return hits_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t capture_thread::misses() const
+	{
+		return misses_.load(std::memory_order_relaxed);
+	}
+
+	void capture_thread::run()
+	{
+		// twice per max_age, so the latest frame is always young enough
+		const auto interval = max_age_ / 2;
+
+		std::unique_lock lock{ mutex_ };
+
+		while (!stop_)
+		{
+			const auto wanted = [&]
+			{
+				return !requested_.empty() && clock::now() - requested_at_ <= idle_after_;
+			};
+
+			if (!wanted())
+			{
+				wake_.wait(lock, [&] { return stop_ || wanted(); });
+				continue;
+			}
+
+			const rect area = requested_;
+			lock.unlock();
+
+			const auto started = clock::now();
+			auto& next = slot_.back();
+
+			try
+			{
+				const size_t size = static_cast<size_t>(area.width()) * area.height() * 4;
+
+				if (next.pixels.size() != size)
+				{
+					next.pixels = {};
+					next.pixels = pixel_pool::shared().acquire(size);
+				}
+
+				if (capture_(area, { next.pixels.data(), area.width(), area.height(), area.width() * 4 }))
+				{
+					// the age of a frame counts from when its capture started
+					next.area = area;
+					next.captured = started;
+
+					slot_.publish();
+					captures_.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+				next.pixels = {};
+			}
+			catch (...)
+			{
+				// the frame is dropped, an exception leaving the thread would
+				// terminate the host
+			}
+
+			lock.lock();
+
+			// a different area is captured right away, the same one again once
+			// the interval is up
+			wake_.wait_until(lock, started + interval, [&]
+			{
+				return stop_ || requested_.left != area.left || requested_.top != area.top
+					|| requested_.right != area.right || requested_.bottom != area.bottom;
+			});
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "geometry.hpp"
+#include "latest_slot.hpp"
+#include "pixel_pool.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	// keeps capturing the last requested area on a thread of its own, so a
+	// request can be answered right away with a frame no older than max_age.
+	// frames reach the requesting side through a latest_slot. the thread goes
+	// idle when nothing was requested for idle_after
+	class capture_thread
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		// fills dest, which is sized to area, false when capturing failed
+		using capture_fn = std::function<bool(const rect& area, const bitmap_view& dest)>;
+
+		capture_thread(capture_fn capture, clock::duration max_age, clock::duration idle_after);
+		~capture_thread();
+
+		capture_thread(const capture_thread&) = delete;
+		capture_thread& operator=(const capture_thread&) = delete;
+
+		// copies request out of the latest frame into dest when that frame
+		// covers it and is younger than max_age. either way request is what
+		// gets captured from now on
+		bool try_get(const rect& request, const bitmap_view& dest);
+
+		// joins the thread, try_get misses from then on
+		void stop();
+
+		clock::duration max_age() const;
+
+		uint64_t captures() const;
+		uint64_t hits() const;
+		uint64_t misses() const;
+
+	private:
+		struct frame
+		{
+			pixel_buffer pixels;
+			rect area;
+			clock::time_point captured;
+		};
+
+		void run();
+
+		capture_fn capture_;
+		clock::duration max_age_;
+		clock::duration idle_after_;
+
+		latest_slot<frame> slot_;
+
+		// the slot has a single consumer, concurrent requests take turns
+		std::mutex consumer_mutex_;
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		rect requested_;
+		clock::time_point requested_at_;
+		bool stop_ = false;
+
+		std::atomic<uint64_t> captures_{ 0 };
+		std::atomic<uint64_t> hits_{ 0 };
+		std::atomic<uint64_t> misses_{ 0 };
+
+		std::thread thread_;
+	};
+}
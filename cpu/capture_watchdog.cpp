@@ -0,0 +1,205 @@
+#include <utility>
+
+#include "capture_watchdog.hpp"
+#include "strided_copy.hpp"
+#include "thread_pool.hpp"
+
+namespace cpu
+{
+	capture_watchdog::capture_watchdog(capture_fn capture, clock::duration budget, unsigned int max_workers) :
+		capture_(std::move(capture)), budget_(budget), max_workers_(max_workers ? max_workers : 1)
+	{
+	}
+
+	capture_watchdog::~capture_watchdog()
+	{
+		stop();
+	}
+
+	capture_watchdog::outcome capture_watchdog::capture(const rect& request, const bitmap_view& dest)
+	{
+		const auto deadline = clock::now() + budget_;
+
+		// the capture may outlive the caller and dest with it
+		auto j = std::make_shared<job>();
+		j->area = request;
+		j->pixels = pixel_pool::shared().acquire(static_cast<size_t>(request.width()) * request.height() * 4);
+		j->view = { j->pixels.data(), request.width(), request.height(), static_cast<ptrdiff_t>(request.width()) * 4 };
+
+		std::unique_lock lock{ mutex_ };
+
+		if (stop_)
+		{
+			failed_.fetch_add(1, std::memory_order_relaxed);
+			return outcome::failed;
+		}
+
+		queue_.push_back(j);
+
+		if (!idle_ && threads_.size() < max_workers_)
+		{
+			threads_.emplace_back(&capture_watchdog::worker_main, this);
+			running_++;
+		}
+		else
+			wake_.notify_one();
+
+		if (!done_.wait_until(lock, deadline, [&] { return j->done; }))
+		{
+			j->abandoned = true;
+
+			if (!j->started)
+			{
+				std::erase(queue_, j);
+				cancelled_.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			timed_out_.fetch_add(1, std::memory_order_relaxed);
+			return outcome::timed_out;
+		}
+
+		lock.unlock();
+
+		if (!j->ok)
+		{
+			failed_.fetch_add(1, std::memory_order_relaxed);
+			return outcome::failed;
+		}
+
+		strided_copy(j->view.data, j->view.pitch, dest.data, dest.pitch, static_cast<size_t>(request.width()) * 4, request.height(), thread_pool::shared());
+
+		captured_.fetch_add(1, std::memory_order_relaxed);
+		return outcome::captured;
+	}
+
+	void capture_watchdog::stop()
+	{
+		std::vector<std::thread> threads;
+
+		{
+			std::lock_guard lock{ mutex_ };
+
+			stop_ = true;
+
+			for (auto& j : queue_)
+				j->done = true;
+
+			queue_.clear();
+			threads.swap(threads_);
+		}
+
+		wake_.notify_all();
+		done_.notify_all();
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	bool capture_watchdog::stop(clock::duration wait)
+	{
+		std::vector<std::thread> threads;
+		bool finished;
+
+		{
+			std::unique_lock lock{ mutex_ };
+
+			stop_ = true;
+
+			for (auto& j : queue_)
+				j->done = true;
+
+			queue_.clear();
+
+			wake_.notify_all();
+			done_.notify_all();
+
+			finished = done_.wait_for(lock, wait, [this] { return !running_; });
+			threads.swap(threads_);
+		}
+
+		for (auto& thread : threads)
+		{
+			if (finished)
+				thread.join();
+			else
+				thread.detach();
+		}
+
+		return finished;
+	}
+
+	capture_watchdog::clock::duration capture_watchdog::budget() const
+	{
+		return budget_;
+	}
+
+	uint64_t capture_watchdog::captured() const
+	{
+		return captured_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t capture_watchdog::failed() const
+	{
+		return failed_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t capture_watchdog::timed_out() const
+	{
+		return timed_out_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t capture_watchdog::cancelled() const
+	{
+		return cancelled_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t capture_watchdog::late() const
+	{
+		return late_.load(std::memory_order_relaxed);
+	}
+
+	void capture_watchdog::worker_main()
+	{
+		std::unique_lock lock{ mutex_ };
+
+		while (true)
+		{
+			idle_++;
+			wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+			idle_--;
+
+			if (stop_)
+			{
+				running_--;
+				done_.notify_all();
+				return;
+			}
+
+			auto j = std::move(queue_.front());
+			queue_.pop_front();
+			j->started = true;
+
+			lock.unlock();
+
+			bool ok = false;
+
+			try
+			{
+				ok = capture_(j->area, j->view);
+			}
+			catch (...)
+			{
+			}
+
+			lock.lock();
+
+			j->done = true;
+			j->ok = ok;
+
+			if (j->abandoned)
+				late_.fetch_add(1, std::memory_order_relaxed);
+
+			done_.notify_all();
+		}
+	}
+}
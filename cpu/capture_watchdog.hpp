@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "geometry.hpp"
+#include "pixel_pool.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	// runs captures on worker threads against a budget, so a stalled capture
+	// costs its caller no more than that. a capture that runs late is not
+	// interrupted, it finishes without the caller and leaves whatever caches
+	// it went through warm for the next request. captures land in a pooled
+	// buffer that is copied into dest once they are in, one full frame copy
+	// more than capturing straight into the caller's dib
+	class capture_watchdog
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		// fills dest, which is sized to area, false when capturing failed
+		using capture_fn = std::function<bool(const rect& area, const bitmap_view& dest)>;
+
+		enum class outcome
+		{
+			captured,
+			failed,
+			// not done within the budget, the caller should fall back
+			timed_out,
+		};
+
+		// up to max_workers captures run at the same time, the others queue
+		capture_watchdog(capture_fn capture, clock::duration budget, unsigned int max_workers = 4);
+		~capture_watchdog();
+
+		capture_watchdog(const capture_watchdog&) = delete;
+		capture_watchdog& operator=(const capture_watchdog&) = delete;
+
+		// request into dest, which is sized to it. a request still queued when
+		// it times out is cancelled instead of run
+		outcome capture(const rect& request, const bitmap_view& dest);
+
+		// cancels the queued captures and waits for the running ones, capture
+		// fails from then on
+		void stop();
+
+		// stop waiting at most wait for the running captures. false when some
+		// were still running, those are detached and whatever they use must
+		// outlive them, the watchdog included
+		bool stop(clock::duration wait);
+
+		clock::duration budget() const;
+
+		uint64_t captured() const;
+		uint64_t failed() const;
+		uint64_t timed_out() const;
+
+		// timed out before a worker got to them
+		uint64_t cancelled() const;
+
+		// finished after their caller gave up on them
+		uint64_t late() const;
+
+	private:
+		struct job
+		{
+			rect area;
+			pixel_buffer pixels;
+			bitmap_view view;
+
+			bool started = false;
+			bool done = false;
+			bool ok = false;
+			bool abandoned = false;
+		};
+
+		void worker_main();
+
+		capture_fn capture_;
+		clock::duration budget_;
+		unsigned int max_workers_;
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		std::deque<std::shared_ptr<job>> queue_;
+		std::vector<std::thread> threads_;
+		unsigned int idle_ = 0;
+		unsigned int running_ = 0;
+		bool stop_ = false;
+
+		std::atomic<uint64_t> captured_{ 0 };
+		std::atomic<uint64_t> failed_{ 0 };
+		std::atomic<uint64_t> timed_out_{ 0 };
+		std::atomic<uint64_t> cancelled_{ 0 };
+		std::atomic<uint64_t> late_{ 0 };
+	};
+}
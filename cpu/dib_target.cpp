@@ -0,0 +1,28 @@
+#include "dib_target.hpp"
+
+namespace cpu
+{
+	bool dib_target(const dib_desc& dib, int x, int y, int width, int height, bitmap_view& view)
+	{
+		if (!dib.bits || width <= 0 || height <= 0)
+			return false;
+
+		if (x < 0 || y < 0 || x + width > dib.width || y + height > dib.height)
+			return false;
+
+		if (dib.stride < static_cast<ptrdiff_t>(dib.width) * 4)
+			return false;
+
+		if (dib.bottom_up)
+		{
+			// the last row in memory is the top of the image
+			view = { dib.bits + dib.stride * (dib.height - 1 - y) + x * 4, width, height, -dib.stride };
+		}
+		else
+		{
+			view = { dib.bits + dib.stride * y + x * 4, width, height, dib.stride };
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	// a 32bpp dib section the way gdi describes it, height is always positive
+	struct dib_desc
+	{
+		uint8_t* bits = nullptr;
+		int width = 0;
+		int height = 0;
+		ptrdiff_t stride = 0;
+		bool bottom_up = true;
+	};
+
+	// the width x height block at (x, y) of dib as a top down bitmap_view, a
+	// bottom up dib gets a negative pitch. false when the block does not lie
+	// completely inside the dib
+	bool dib_target(const dib_desc& dib, int x, int y, int width, int height, bitmap_view& view);
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#include "frame_acquirer.hpp"
+
+namespace cpu
+{
+	wait_stats::wait_stats(size_t count)
+	{
+		samples_.reserve(count ? count : 1);
+	}
+
+	void wait_stats::record(double ms)
+	{
+		if (samples_.size() < samples_.capacity())
+			samples_.push_back(ms);
+		else
+			samples_[next_] = ms;
+
+		next_ = (next_ + 1) % samples_.capacity();
+		recorded_++;
+		last_ = ms;
+	}
+
+	double wait_stats::percentile(double p) const
+	{
+		if (samples_.empty())
+			return 0;
+
+		auto sorted = samples_;
+		const auto index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+
+		std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+		return sorted[index];
+	}
+
+	double wait_stats::last() const
+	{
+		return last_;
+	}
+
+	uint64_t wait_stats::recorded() const
+	{
+		return recorded_;
+	}
+
+	frame_acquirer::frame_acquirer(clock::duration fresh_wait, clock::duration first_wait) :
+		fresh_wait_(fresh_wait), first_wait_(first_wait)
+	{
+	}
+
+	frame_acquirer::result frame_acquirer::acquire(duplication_source& source)
+	{
+		// a duplication that keeps losing access right away is as good as failed
+		constexpr int max_recreations = 3;
+
+		const auto start = clock::now();
+		auto deadline = start + (has_retained_ ? fresh_wait_ : first_wait_);
+		int recreations = 0;
+
+		const auto finish = [&](result r)
+		{
+			waits_.record(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+			return r;
+		};
+
+		while (true)
+		{
+			const auto now = clock::now();
+			const auto remaining = now < deadline
+				? std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count()
+				: 0;
+
+			bool presented = false;
+			const auto status = source.acquire(static_cast<unsigned int>(remaining), presented);
+
+			if (status == duplication_source::acquire_status::frame)
+			{
+				if (presented)
+				{
+					source.retain();
+					source.release();
+
+					has_retained_ = true;
+					return finish(result::fresh);
+				}
+
+				// only the pointer moved, the desktop may still present in time
+				source.release();
+
+				if (clock::now() < deadline)
+					continue;
+			}
+			else if (status == duplication_source::acquire_status::access_lost)
+			{
+				if (++recreations > max_recreations)
+					return finish(result::failed);
+
+				source.recreate();
+
+				// a new duplication hands out the whole desktop as its first frame
+				has_retained_ = false;
+				deadline = clock::now() + first_wait_;
+				continue;
+			}
+			else if (status == duplication_source::acquire_status::failed)
+			{
+				return finish(result::failed);
+			}
+
+			// nothing new was presented within the budget
+			return finish(has_retained_ ? result::retained : result::failed);
+		}
+	}
+
+	void frame_acquirer::forget()
+	{
+		has_retained_ = false;
+	}
+
+	bool frame_acquirer::has_retained() const
+	{
+		return has_retained_;
+	}
+
+	const wait_stats& frame_acquirer::waits() const
+	{
+		return waits_;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cpu
+{
+	// the part of an output duplication frame_acquirer drives, so the policy can
+	// run against a scripted fake
+	class duplication_source
+	{
+	public:
+		enum class acquire_status
+		{
+			frame,
+			timeout,
+			access_lost,
+			failed,
+		};
+
+		virtual ~duplication_source() = default;
+
+		// blocks up to timeout_ms for the next frame. presented is false for a
+		// frame that only moved the pointer
+		virtual acquire_status acquire(unsigned int timeout_ms, bool& presented) = 0;
+
+		// copies the acquired frame into the retained copy, along with what it damaged
+		virtual void retain() = 0;
+
+		// hands the acquired frame back to the os
+		virtual void release() = 0;
+
+		// after access_lost, the retained copy is gone with the old duplication
+		virtual void recreate() = 0;
+	};
+
+	// the last count samples of something, in milliseconds
+	class wait_stats
+	{
+	public:
+		explicit wait_stats(size_t count = 1024);
+
+		void record(double ms);
+
+		// p in [0, 1] over the samples kept, 0 without any
+		double percentile(double p) const;
+		double last() const;
+
+		uint64_t recorded() const;
+
+	private:
+		std::vector<double> samples_;
+		size_t next_ = 0;
+		uint64_t recorded_ = 0;
+		double last_ = 0;
+	};
+
+	// gets the frame to capture out of a duplication without spinning: blocks
+	// on the next frame for at most fresh_wait when an earlier frame is
+	// retained and falls back to it, and for at most first_wait when nothing
+	// is retained yet
+	class frame_acquirer
+	{
+	public:
+		enum class result
+		{
+			fresh,    // a new frame was presented and is now the retained copy
+			retained, // nothing new within the budget, the retained copy stands
+			failed,
+		};
+
+		using clock = std::chrono::steady_clock;
+
+		frame_acquirer(clock::duration fresh_wait, clock::duration first_wait);
+
+		result acquire(duplication_source& source);
+
+		// the retained copy is gone, like after a size change
+		void forget();
+		bool has_retained() const;
+
+		// time spent in acquire per call
+		const wait_stats& waits() const;
+
+	private:
+		clock::duration fresh_wait_;
+		clock::duration first_wait_;
+		bool has_retained_ = false;
+
+		wait_stats waits_;
+	};
+}
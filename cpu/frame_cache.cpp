@@ -0,0 +1,82 @@
+#include <cstring>
+
+#include "frame_cache.hpp"
+
+namespace cpu
+{
+	frame_cache::frame_cache(clock::duration ttl) :
+		ttl_(ttl)
+	{
+	}
+
+	frame_cache::clock::duration frame_cache::ttl() const
+	{
+		return ttl_;
+	}
+
+	void frame_cache::set_ttl(clock::duration ttl)
+	{
+		ttl_ = ttl;
+	}
+
+	bool frame_cache::lookup(const rect& request, uint64_t generation, int64_t present_time, const bitmap_view& dest)
+	{
+		const bool hit = valid_
+			&& generation == generation_
+			&& present_time <= present_time_
+			&& clock::now() - stored_at_ <= ttl_
+			&& !request.empty()
+			&& request.left >= area_.left && request.top >= area_.top
+			&& request.right <= area_.right && request.bottom <= area_.bottom;
+
+		if (!hit)
+		{
+			misses_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		const ptrdiff_t pitch = area_.width() * 4;
+		const auto* src = pixels_.data() + pitch * (request.top - area_.top) + (request.left - area_.left) * 4;
+
+		for (int y = 0; y < request.height(); y++)
+			std::memcpy(dest.data + dest.pitch * y, src + pitch * y, request.width() * 4);
+
+		hits_.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void frame_cache::store(const rect& area, uint64_t generation, int64_t present_time, const uint8_t* data, ptrdiff_t pitch)
+	{
+		const ptrdiff_t row_size = area.width() * 4;
+		const size_t size = static_cast<size_t>(row_size) * area.height();
+
+		// every byte is written below, no need to clear it
+		if (pixels_.capacity() < size)
+			pixels_ = pixel_pool::shared().acquire(size);
+
+		for (int y = 0; y < area.height(); y++)
+			std::memcpy(pixels_.data() + row_size * y, data + pitch * y, row_size);
+
+		area_ = area;
+		generation_ = generation;
+		present_time_ = present_time;
+		stored_at_ = clock::now();
+		valid_ = true;
+	}
+
+	void frame_cache::invalidate()
+	{
+		valid_ = false;
+		pixels_ = {};
+	}
+
+	uint64_t frame_cache::hits() const
+	{
+		return hits_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t frame_cache::misses() const
+	{
+		return misses_.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "geometry.hpp"
+#include "pixel_pool.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	// keeps the last composed frame around for a short while so the burst of
+	// BitBlt calls a screenshotter makes (one per monitor, loupe updates) can be
+	// served by cropping it instead of capturing again
+	class frame_cache
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		explicit frame_cache(clock::duration ttl);
+
+		clock::duration ttl() const;
+		void set_ttl(clock::duration ttl);
+
+		// copies request out of the cached frame into dest (sized to request).
+		// misses when the topology changed, the frame is older than the ttl,
+		// present_time is newer than the stored one or request is not fully
+		// covered. present_time is the newest LastPresentTime seen on the
+		// monitors under the request
+		bool lookup(const rect& request, uint64_t generation, int64_t present_time, const bitmap_view& dest);
+
+		// area is where data sits on the virtual desktop. the buffer of the
+		// previous frame is reused when it is big enough
+		void store(const rect& area, uint64_t generation, int64_t present_time, const uint8_t* data, ptrdiff_t pitch);
+
+		// also gives the buffer back to the pool
+		void invalidate();
+
+		uint64_t hits() const;
+		uint64_t misses() const;
+
+	private:
+		clock::duration ttl_;
+
+		pixel_buffer pixels_;
+		rect area_;
+		uint64_t generation_ = 0;
+		int64_t present_time_ = 0;
+		clock::time_point stored_at_;
+		bool valid_ = false;
+
+		std::atomic<uint64_t> hits_{ 0 };
+		std::atomic<uint64_t> misses_{ 0 };
+	};
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+
+#include "geometry.hpp"
+
+namespace cpu
+{
+	rect intersect(const rect& a, const rect& b)
+	{
+		return
+		{
+			std::max(a.left, b.left),
+			std::max(a.top, b.top),
+			std::min(a.right, b.right),
+			std::min(a.bottom, b.bottom),
+		};
+	}
+
+	rect unite(const rect& a, const rect& b)
+	{
+		if (a.empty())
+			return b;
+
+		if (b.empty())
+			return a;
+
+		return
+		{
+			std::min(a.left, b.left),
+			std::min(a.top, b.top),
+			std::max(a.right, b.right),
+			std::max(a.bottom, b.bottom),
+		};
+	}
+
+	rotation_t rotation_from_degrees(float degrees)
+	{
+		switch (static_cast<int>(degrees))
+		{
+		case 90:
+			return rotation_t::rotate90;
+		case 180:
+			return rotation_t::rotate180;
+		case 270:
+			return rotation_t::rotate270;
+		default:
+			return rotation_t::identity;
+		}
+	}
+
+	rect to_dest(const placement& p, const rect& src)
+	{
+		switch (p.rotation)
+		{
+		case rotation_t::rotate90:
+			return { p.x + p.height - src.bottom, p.y + src.left, p.x + p.height - src.top, p.y + src.right };
+		case rotation_t::rotate180:
+			return { p.x + p.width - src.right, p.y + p.height - src.bottom, p.x + p.width - src.left, p.y + p.height - src.top };
+		case rotation_t::rotate270:
+			return { p.x + src.top, p.y + p.width - src.right, p.x + src.bottom, p.y + p.width - src.left };
+		default:
+			return { p.x + src.left, p.y + src.top, p.x + src.right, p.y + src.bottom };
+		}
+	}
+
+	rect to_source(const placement& p, const rect& dest)
+	{
+		switch (p.rotation)
+		{
+		case rotation_t::rotate90:
+			return { dest.top - p.y, p.x + p.height - dest.right, dest.bottom - p.y, p.x + p.height - dest.left };
+		case rotation_t::rotate180:
+			return { p.x + p.width - dest.right, p.y + p.height - dest.bottom, p.x + p.width - dest.left, p.y + p.height - dest.top };
+		case rotation_t::rotate270:
+			return { p.y + p.width - dest.bottom, dest.left - p.x, p.y + p.width - dest.top, dest.right - p.x };
+		default:
+			return { dest.left - p.x, dest.top - p.y, dest.right - p.x, dest.bottom - p.y };
+		}
+	}
+
+	rect crop(const placement& p, const rect& bounds, placement& sub)
+	{
+		const auto visible = intersect(to_dest(p, { 0, 0, p.width, p.height }), bounds);
+		if (visible.empty())
+			return {};
+
+		const auto source = to_source(p, visible);
+		sub = { source.width(), source.height(), visible.left, visible.top, p.rotation };
+
+		return source;
+	}
+}
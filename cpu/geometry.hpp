@@ -0,0 +1,54 @@
+#pragma once
+
+namespace cpu
+{
+	// half open, [left, right) x [top, bottom)
+	struct rect
+	{
+		int left = 0;
+		int top = 0;
+		int right = 0;
+		int bottom = 0;
+
+		int width() const { return right - left; }
+		int height() const { return bottom - top; }
+		bool empty() const { return right <= left || bottom <= top; }
+	};
+
+	rect intersect(const rect& a, const rect& b);
+
+	// the smallest rect holding both, an empty one adds nothing
+	rect unite(const rect& a, const rect& b);
+
+	// the only angles DXGI_MODE_ROTATION can give us
+	enum class rotation_t
+	{
+		identity,
+		rotate90,
+		rotate180,
+		rotate270,
+	};
+
+	rotation_t rotation_from_degrees(float degrees);
+
+	// a width x height source image placed at (x, y) on the destination after
+	// rotating it, integer form of calc_dest_pos in tonemapper.hlsl
+	struct placement
+	{
+		int width = 0;
+		int height = 0;
+		int x = 0;
+		int y = 0;
+		rotation_t rotation = rotation_t::identity;
+	};
+
+	// where a rect of source pixels ends up on the destination
+	rect to_dest(const placement& p, const rect& src);
+
+	// which source pixels end up inside a rect of the destination
+	rect to_source(const placement& p, const rect& dest);
+
+	// the source pixels of p that land inside bounds, sub is set to the placement
+	// of just that part of the image. returns an empty rect when nothing lands
+	rect crop(const placement& p, const rect& bounds, placement& sub);
+}
@@ -0,0 +1,220 @@
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "kernels.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		void hdr_row_scalar(const uint8_t* src, uint32_t* dest, int count, float white_level)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				uint16_t px[4];
+				std::memcpy(px, src + i * 8, sizeof(px));
+
+				const float3 color{ half_to_float(px[0]), half_to_float(px[1]), half_to_float(px[2]) };
+				dest[i] = pack_bgra(tonemap_hdr(color, white_level));
+			}
+		}
+
+		void sdr_row_scalar(const uint8_t* src, uint32_t* dest, int count, float)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				const auto* px = src + i * 4;
+				dest[i] = px[2] | (px[1] << 8) | (px[0] << 16) | 0xff000000u;
+			}
+		}
+
+		uint64_t hash_block_scalar(const uint8_t* src, ptrdiff_t pitch, int row_bytes, int rows)
+		{
+			uint64_t acc[4] = { block_hash::prime32, block_hash::prime64, 0, block_hash::prime32 };
+
+			const auto accumulate = [&](const uint8_t* stripe)
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					uint64_t data;
+					std::memcpy(&data, stripe + i * 8, sizeof(data));
+
+					const uint64_t key = data ^ block_hash::secret[i];
+					acc[i] += (key & 0xffffffff) * (key >> 32);
+					acc[i ^ 1] += data;
+				}
+			};
+
+			for (int y = 0; y < rows; y++)
+			{
+				const auto* row = src + pitch * y;
+
+				int x = 0;
+				for (; x + block_hash::stripe_size <= row_bytes; x += block_hash::stripe_size)
+					accumulate(row + x);
+
+				if (x < row_bytes)
+				{
+					uint8_t tail[block_hash::stripe_size] = {};
+					std::memcpy(tail, row + x, row_bytes - x);
+					accumulate(tail);
+				}
+
+				block_hash::scramble(acc);
+			}
+
+			return block_hash::finish(acc, static_cast<uint64_t>(row_bytes) * rows);
+		}
+
+#ifdef CPU_KERNELS_X86
+		void cpuid(int leaf, int subleaf, int regs[4])
+		{
+#if defined(_MSC_VER)
+			__cpuidex(regs, leaf, subleaf);
+#else
+			unsigned int a, b, c, d;
+			__cpuid_count(leaf, subleaf, a, b, c, d);
+			regs[0] = a; regs[1] = b; regs[2] = c; regs[3] = d;
+#endif
+		}
+
+		uint64_t xgetbv()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned int lo, hi;
+			__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+			return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+		}
+
+		const row_kernels& detect_row_kernels()
+		{
+			int regs[4];
+			cpuid(0, 0, regs);
+			const int max_leaf = regs[0];
+
+			if (max_leaf < 7)
+				return scalar_row_kernels;
+
+			cpuid(1, 0, regs);
+			const bool osxsave = regs[2] & (1 << 27);
+			const bool avx = regs[2] & (1 << 28);
+			const bool fma = regs[2] & (1 << 12);
+			const bool f16c = regs[2] & (1 << 29);
+
+			if (!osxsave || !avx)
+				return scalar_row_kernels;
+
+			const auto xcr0 = xgetbv();
+
+			// xmm + ymm state
+			if ((xcr0 & 0x6) != 0x6)
+				return scalar_row_kernels;
+
+			cpuid(7, 0, regs);
+			const bool avx2 = regs[1] & (1 << 5);
+			const bool avx512f = regs[1] & (1 << 16);
+			const bool avx512dq = regs[1] & (1 << 17);
+			const bool avx512bw = regs[1] & (1 << 30);
+			const bool avx512vl = regs[1] & (1u << 31);
+
+			if (!avx2 || !fma || !f16c)
+				return scalar_row_kernels;
+
+			// the avx512 table hashes with avx2, and /arch:AVX512 lets the compiler
+			// use bw, dq and vl anywhere in that file. opmask + zmm state
+			if (avx512f && avx512dq && avx512bw && avx512vl && (xcr0 & 0xe6) == 0xe6)
+				return avx512_row_kernels;
+
+			return avx2_row_kernels;
+		}
+
+		size_t detect_last_level_cache()
+		{
+			int regs[4];
+
+			// deterministic cache parameters, intel has them at leaf 4 and amd at
+			// 0x8000001d with the same layout
+			const auto largest_cache = [&](int leaf)
+			{
+				size_t largest = 0;
+
+				for (int index = 0; index < 16; index++)
+				{
+					cpuid(leaf, index, regs);
+
+					const int type = regs[0] & 0x1f;
+					if (type == 0)
+						break;
+
+					// instruction cache
+					if (type == 2)
+						continue;
+
+					const size_t ways = ((static_cast<unsigned int>(regs[1]) >> 22) & 0x3ff) + 1;
+					const size_t partitions = ((static_cast<unsigned int>(regs[1]) >> 12) & 0x3ff) + 1;
+					const size_t line_size = (static_cast<unsigned int>(regs[1]) & 0xfff) + 1;
+					const size_t sets = static_cast<size_t>(static_cast<unsigned int>(regs[2])) + 1;
+
+					const size_t size = ways * partitions * line_size * sets;
+					if (size > largest)
+						largest = size;
+				}
+
+				return largest;
+			};
+
+			cpuid(0, 0, regs);
+			const int max_leaf = regs[0];
+
+			cpuid(static_cast<int>(0x80000000), 0, regs);
+			const auto max_extended_leaf = static_cast<unsigned int>(regs[0]);
+
+			size_t size = 0;
+
+			if (max_leaf >= 4)
+				size = largest_cache(4);
+
+			if (!size && max_extended_leaf >= 0x8000001d)
+				size = largest_cache(static_cast<int>(0x8000001d));
+
+			return size;
+		}
+#endif
+	}
+
+	const row_kernels scalar_row_kernels{ "scalar", hdr_row_scalar, sdr_row_scalar, hash_block_scalar };
+
+	const row_kernels& select_row_kernels()
+	{
+#ifdef CPU_KERNELS_X86
+		static const row_kernels& kernels = detect_row_kernels();
+#else
+		static const row_kernels& kernels = scalar_row_kernels;
+#endif
+
+		return kernels;
+	}
+
+	size_t last_level_cache_size()
+	{
+		// what a desktop part usually has when cpuid does not say
+		constexpr size_t fallback = 32 << 20;
+
+#ifdef CPU_KERNELS_X86
+		static const size_t size = detect_last_level_cache();
+#else
+		static const size_t size = 0;
+#endif
+
+		return size ? size : fallback;
+	}
+}
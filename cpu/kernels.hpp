@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// row kernels converting a run of duplicated pixels into B8G8R8A8
+// picked once from cpuid, see select_row_kernels
+namespace cpu
+{
+	// src points at count pixels of the source format, dest at count B8G8R8A8 pixels
+	using row_kernel_t = void(*)(const uint8_t* src, uint32_t* dest, int count, float white_level);
+
+	// 64 bit content hash of rows x row_bytes bytes, every implementation returns
+	// the same value for the same bytes
+	using hash_kernel_t = uint64_t(*)(const uint8_t* src, ptrdiff_t pitch, int row_bytes, int rows);
+
+	struct row_kernels
+	{
+		const char* name;
+		row_kernel_t hdr; // R16G16B16A16_FLOAT, full tonemap
+		row_kernel_t sdr; // R8G8B8A8_UNORM, swizzle only
+		hash_kernel_t hash;
+	};
+
+	// xxh3 style: every 32 byte stripe is folded into four 64 bit lanes with a
+	// 32x32 -> 64 multiply, the lanes are scrambled at the end of every row
+	namespace block_hash
+	{
+		constexpr int stripe_size = 32;
+
+		constexpr uint64_t secret[4] =
+		{
+			0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull,
+			0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+		};
+
+		constexpr uint64_t prime32 = 0x9e3779b1ull;
+		constexpr uint64_t prime64 = 0x9e3779b185ebca87ull;
+
+		// static: every tu gets its own copy. a shared inline one may be kept
+		// from the avx2 or avx512 tu and reach the scalar path with it
+		static inline void scramble(uint64_t acc[4])
+		{
+			for (int i = 0; i < 4; i++)
+				acc[i] = (acc[i] ^ (acc[i] >> 47) ^ secret[i]) * prime32;
+		}
+
+		static inline uint64_t finish(const uint64_t acc[4], uint64_t length)
+		{
+			uint64_t h = length * prime64;
+
+			for (int i = 0; i < 4; i++)
+			{
+				h ^= acc[i];
+				h ^= h >> 33;
+				h *= 0xff51afd7ed558ccdull;
+				h ^= h >> 33;
+				h *= 0xc4ceb9fe1a85ec53ull;
+				h ^= h >> 33;
+			}
+
+			return h;
+		}
+	}
+
+	extern const row_kernels scalar_row_kernels;
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CPU_KERNELS_X86 1
+
+	extern const row_kernels avx2_row_kernels;   // avx2 + fma + f16c, 8 lanes
+	extern const row_kernels avx512_row_kernels; // avx512f/bw/dq/vl on top of avx2, 16 lanes
+
+	// shared by both tables, hashing is bound by loads long before it needs zmm
+	uint64_t hash_block_avx2(const uint8_t* src, ptrdiff_t pitch, int row_bytes, int rows);
+#endif
+
+	const row_kernels& select_row_kernels();
+
+	// bytes of the largest data cache, from cpuid as well
+	size_t last_level_cache_size();
+}
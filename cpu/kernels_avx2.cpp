@@ -0,0 +1,297 @@
+// built with /arch:AVX2, keep this file free of inline functions shared with
+// other translation units so the linker never picks an avx2 copy of them
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC target("avx2,fma,f16c")
+#elif defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), apply_to = function)
+#endif
+
+#include <immintrin.h>
+#include <cstring>
+
+#include "kernels.hpp"
+
+#ifdef CPU_KERNELS_X86
+namespace cpu
+{
+	namespace
+	{
+		constexpr int lanes = 8;
+
+		__m256 splat(float v) { return _mm256_set1_ps(v); }
+
+		__m256 select(__m256 mask, __m256 a, __m256 b)
+		{
+			// mask ? a : b
+			return _mm256_blendv_ps(b, a, mask);
+		}
+
+		__m256 log2(__m256 x)
+		{
+			const __m256i bits = _mm256_castps_si256(x);
+			__m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+
+			// mantissa in [0.5, 1)
+			__m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x807fffff)), _mm256_set1_epi32(0x3f000000)));
+
+			const __m256 small = _mm256_cmp_ps(m, splat(0.707106781186547524f), _CMP_LT_OQ);
+			e = _mm256_sub_ps(e, _mm256_and_ps(small, splat(1.0f)));
+			m = _mm256_sub_ps(_mm256_add_ps(m, _mm256_and_ps(small, m)), splat(1.0f));
+
+			const __m256 z = _mm256_mul_ps(m, m);
+
+			__m256 y = splat(7.0376836292e-2f);
+			y = _mm256_fmadd_ps(y, m, splat(-1.1514610310e-1f));
+			y = _mm256_fmadd_ps(y, m, splat(1.1676998740e-1f));
+			y = _mm256_fmadd_ps(y, m, splat(-1.2420140846e-1f));
+			y = _mm256_fmadd_ps(y, m, splat(1.4249322787e-1f));
+			y = _mm256_fmadd_ps(y, m, splat(-1.6668057665e-1f));
+			y = _mm256_fmadd_ps(y, m, splat(2.0000714765e-1f));
+			y = _mm256_fmadd_ps(y, m, splat(-2.4999993993e-1f));
+			y = _mm256_fmadd_ps(y, m, splat(3.3333331174e-1f));
+			y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+			y = _mm256_fmadd_ps(z, splat(-0.5f), y);
+
+			const __m256 ln = _mm256_add_ps(m, y);
+			return _mm256_fmadd_ps(ln, splat(1.44269504088896341f), e);
+		}
+
+		__m256 exp2(__m256 x)
+		{
+			x = _mm256_min_ps(_mm256_max_ps(x, splat(-126.0f)), splat(126.0f));
+
+			const __m256 n = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+			const __m256 g = _mm256_mul_ps(_mm256_sub_ps(x, n), splat(0.693147180559945309f));
+
+			__m256 p = splat(1.9875691500e-4f);
+			p = _mm256_fmadd_ps(p, g, splat(1.3981999507e-3f));
+			p = _mm256_fmadd_ps(p, g, splat(8.3334519073e-3f));
+			p = _mm256_fmadd_ps(p, g, splat(4.1665795894e-2f));
+			p = _mm256_fmadd_ps(p, g, splat(1.6666665459e-1f));
+			p = _mm256_fmadd_ps(p, g, splat(5.0000001201e-1f));
+			p = _mm256_fmadd_ps(p, _mm256_mul_ps(g, g), _mm256_add_ps(g, splat(1.0f)));
+
+			const __m256i scale = _mm256_slli_epi32(_mm256_cvtps_epi32(n), 23);
+			return _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(p), scale));
+		}
+
+		__m256 bt2020_inv_gamma(__m256 x)
+		{
+			const __m256 curve = _mm256_fmsub_ps(exp2(_mm256_mul_ps(log2(x), splat(1.0f / 2.4f))), splat(1.055f), splat(0.055f));
+			const __m256 linear = _mm256_mul_ps(x, splat(12.92f));
+
+			return select(_mm256_cmp_ps(x, splat(0.00313066844250063f), _CMP_GT_OQ), curve, linear);
+		}
+
+		__m256 linear_tonemap(__m256 x)
+		{
+			const __m256 compressed = _mm256_fmadd_ps(_mm256_sub_ps(x, splat(0.8f)), splat(1.0f / 2.5f), splat(0.8f));
+			return select(_mm256_cmp_ps(x, splat(0.8f), _CMP_GE_OQ), compressed, x);
+		}
+
+		__m256 rgb_to_luma(__m256 r, __m256 g, __m256 b)
+		{
+			return _mm256_fmadd_ps(splat(0.213f), r, _mm256_fmadd_ps(splat(0.715f), g, _mm256_mul_ps(splat(0.072f), b)));
+		}
+
+		void neutral(__m256& r, __m256& g, __m256& b)
+		{
+			constexpr float start_compression = 0.8f - 0.04f;
+			constexpr float desaturation = 0.15f;
+			constexpr float d = 1.0f - start_compression;
+
+			const __m256 x = _mm256_min_ps(r, _mm256_min_ps(g, b));
+			const __m256 offset = select(_mm256_cmp_ps(x, splat(0.08f), _CMP_LT_OQ), _mm256_fnmadd_ps(_mm256_mul_ps(x, x), splat(6.25f), x), splat(0.04f));
+
+			r = _mm256_sub_ps(r, offset);
+			g = _mm256_sub_ps(g, offset);
+			b = _mm256_sub_ps(b, offset);
+
+			const __m256 peak = _mm256_max_ps(r, _mm256_max_ps(g, b));
+			const __m256 compress = _mm256_cmp_ps(peak, splat(start_compression), _CMP_GE_OQ);
+
+			if (_mm256_testz_ps(compress, compress))
+				return;
+
+			const __m256 new_peak = _mm256_sub_ps(splat(1.0f), _mm256_div_ps(splat(d * d), _mm256_add_ps(peak, splat(d - start_compression))));
+			const __m256 scale = _mm256_div_ps(new_peak, peak);
+			const __m256 t = _mm256_sub_ps(splat(1.0f), _mm256_div_ps(splat(1.0f), _mm256_fmadd_ps(splat(desaturation), _mm256_sub_ps(peak, new_peak), splat(1.0f))));
+
+			const auto compress_channel = [&](__m256 c)
+			{
+				c = _mm256_mul_ps(c, scale);
+				return _mm256_fmadd_ps(_mm256_sub_ps(new_peak, c), t, c);
+			};
+
+			r = select(compress, compress_channel(r), r);
+			g = select(compress, compress_channel(g), g);
+			b = select(compress, compress_channel(b), b);
+		}
+
+		__m256i to_unorm(__m256 x)
+		{
+			// max first so NaN ends up as 0
+			x = _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), splat(1.0f));
+			return _mm256_cvttps_epi32(_mm256_fmadd_ps(x, splat(255.0f), splat(0.5f)));
+		}
+
+		// 8 R16G16B16A16_FLOAT pixels in, 8 B8G8R8A8 pixels out
+		void tonemap8(const uint8_t* src, uint32_t* dest, __m256 inv_white)
+		{
+			// two pixels per register, rgba rgba
+			const __m256 v0 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+			const __m256 v1 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)));
+			const __m256 v2 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32)));
+			const __m256 v3 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48)));
+
+			// lanes end up holding pixels 0 2 4 6 1 3 5 7
+			const __m256 t0 = _mm256_unpacklo_ps(v0, v1);
+			const __m256 t1 = _mm256_unpackhi_ps(v0, v1);
+			const __m256 t2 = _mm256_unpacklo_ps(v2, v3);
+			const __m256 t3 = _mm256_unpackhi_ps(v2, v3);
+
+			__m256 r = _mm256_shuffle_ps(t0, t2, 0x44);
+			__m256 g = _mm256_shuffle_ps(t0, t2, 0xee);
+			__m256 b = _mm256_shuffle_ps(t1, t3, 0x44);
+
+			const auto input = [&](__m256 c)
+			{
+				c = _mm256_min_ps(_mm256_max_ps(c, _mm256_setzero_ps()), splat(10000.0f));
+				return bt2020_inv_gamma(_mm256_mul_ps(c, inv_white));
+			};
+
+			r = input(r);
+			g = input(g);
+			b = input(b);
+
+			const __m256 lr = linear_tonemap(r);
+			const __m256 lg = linear_tonemap(g);
+			const __m256 lb = linear_tonemap(b);
+
+			neutral(r, g, b);
+
+			const __m256 linear_luma = rgb_to_luma(lr, lg, lb);
+			const __m256 blend = _mm256_cmp_ps(linear_luma, splat(0.8f), _CMP_GE_OQ);
+
+			if (!_mm256_testz_ps(blend, blend))
+			{
+				const __m256 s = _mm256_div_ps(linear_luma, rgb_to_luma(r, g, b));
+
+				r = select(blend, _mm256_mul_ps(r, s), lr);
+				g = select(blend, _mm256_mul_ps(g, s), lg);
+				b = select(blend, _mm256_mul_ps(b, s), lb);
+			}
+			else
+			{
+				r = lr;
+				g = lg;
+				b = lb;
+			}
+
+			__m256i packed = _mm256_or_si256(to_unorm(b), _mm256_slli_epi32(to_unorm(g), 8));
+			packed = _mm256_or_si256(packed, _mm256_slli_epi32(to_unorm(r), 16));
+			packed = _mm256_or_si256(packed, _mm256_set1_epi32(static_cast<int>(0xff000000u)));
+
+			packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), packed);
+		}
+
+		void hdr_row_avx2(const uint8_t* src, uint32_t* dest, int count, float white_level)
+		{
+			const __m256 inv_white = splat(80.0f / white_level);
+
+			int i = 0;
+			for (; i + lanes <= count; i += lanes)
+				tonemap8(src + i * 8, dest + i, inv_white);
+
+			if (i == count)
+				return;
+
+			// pad the tail out to a full vector
+			alignas(32) uint8_t tail_src[lanes * 8] = {};
+			alignas(32) uint32_t tail_dest[lanes];
+
+			const int rest = count - i;
+			std::memcpy(tail_src, src + i * 8, rest * 8);
+			tonemap8(tail_src, tail_dest, inv_white);
+			std::memcpy(dest + i, tail_dest, rest * 4);
+		}
+
+		__m256i swizzle8(__m256i px)
+		{
+			// rgba -> bgra
+			const __m256i ga = _mm256_and_si256(px, _mm256_set1_epi32(0x0000ff00));
+			const __m256i r = _mm256_slli_epi32(_mm256_and_si256(px, _mm256_set1_epi32(0x000000ff)), 16);
+			const __m256i b = _mm256_and_si256(_mm256_srli_epi32(px, 16), _mm256_set1_epi32(0x000000ff));
+
+			return _mm256_or_si256(_mm256_or_si256(ga, r), _mm256_or_si256(b, _mm256_set1_epi32(static_cast<int>(0xff000000u))));
+		}
+
+		void sdr_row_avx2(const uint8_t* src, uint32_t* dest, int count, float)
+		{
+			int i = 0;
+			for (; i + lanes <= count; i += lanes)
+			{
+				const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), swizzle8(px));
+			}
+
+			for (; i < count; i++)
+			{
+				const auto* px = src + i * 4;
+				dest[i] = px[2] | (px[1] << 8) | (px[0] << 16) | 0xff000000u;
+			}
+		}
+	}
+
+	uint64_t hash_block_avx2(const uint8_t* src, ptrdiff_t pitch, int row_bytes, int rows)
+	{
+		alignas(32) uint64_t acc[4] = { block_hash::prime32, block_hash::prime64, 0, block_hash::prime32 };
+
+		const __m256i secret = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block_hash::secret));
+		__m256i state = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc));
+
+		const auto accumulate = [&](const uint8_t* stripe)
+		{
+			const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe));
+			const __m256i key = _mm256_xor_si256(data, secret);
+
+			// lo32 * hi32 of every lane, plus the neighbouring lane's data
+			state = _mm256_add_epi64(state, _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32)));
+			state = _mm256_add_epi64(state, _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+		};
+
+		for (int y = 0; y < rows; y++)
+		{
+			const auto* row = src + pitch * y;
+
+			int x = 0;
+			for (; x + block_hash::stripe_size <= row_bytes; x += block_hash::stripe_size)
+				accumulate(row + x);
+
+			if (x < row_bytes)
+			{
+				alignas(32) uint8_t tail[block_hash::stripe_size] = {};
+				std::memcpy(tail, row + x, row_bytes - x);
+				accumulate(tail);
+			}
+
+			// (a ^ a >> 47 ^ secret) * prime32, split into 32 bit halves
+			const __m256i a = _mm256_xor_si256(_mm256_xor_si256(state, _mm256_srli_epi64(state, 47)), secret);
+			const __m256i prime = _mm256_set1_epi64x(static_cast<long long>(block_hash::prime32));
+			const __m256i lo = _mm256_mul_epu32(a, prime);
+			const __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+			state = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+		}
+
+		_mm256_store_si256(reinterpret_cast<__m256i*>(acc), state);
+		return block_hash::finish(acc, static_cast<uint64_t>(row_bytes) * rows);
+	}
+
+	const row_kernels avx2_row_kernels{ "avx2", hdr_row_avx2, sdr_row_avx2, hash_block_avx2 };
+}
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
@@ -0,0 +1,259 @@
+// built with /arch:AVX512, keep this file free of inline functions shared with
+// other translation units so the linker never picks an avx2 copy of them
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC target("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c")
+#elif defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c"))), apply_to = function)
+#endif
+
+#include <immintrin.h>
+#include <cstring>
+
+#include "kernels.hpp"
+
+#ifdef CPU_KERNELS_X86
+namespace cpu
+{
+	namespace
+	{
+		constexpr int lanes = 16;
+
+		__m512 splat(float v) { return _mm512_set1_ps(v); }
+
+		// rcp14 is plenty for 8 bit output and a lot cheaper than a full divide
+		__m512 div(__m512 a, __m512 b)
+		{
+			return _mm512_mul_ps(a, _mm512_rcp14_ps(b));
+		}
+
+		__m512 select(__mmask16 mask, __m512 a, __m512 b)
+		{
+			// mask ? a : b
+			return _mm512_mask_blend_ps(mask, b, a);
+		}
+
+		__m512 log2(__m512 x)
+		{
+			const __m512i bits = _mm512_castps_si512(x);
+			__m512 e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+
+			// mantissa in [0.5, 1)
+			__m512 m = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x807fffff)), _mm512_set1_epi32(0x3f000000)));
+
+			const __mmask16 small = _mm512_cmp_ps_mask(m, splat(0.707106781186547524f), _CMP_LT_OQ);
+			e = _mm512_mask_sub_ps(e, small, e, splat(1.0f));
+			m = _mm512_sub_ps(_mm512_mask_add_ps(m, small, m, m), splat(1.0f));
+
+			const __m512 z = _mm512_mul_ps(m, m);
+
+			__m512 y = splat(7.0376836292e-2f);
+			y = _mm512_fmadd_ps(y, m, splat(-1.1514610310e-1f));
+			y = _mm512_fmadd_ps(y, m, splat(1.1676998740e-1f));
+			y = _mm512_fmadd_ps(y, m, splat(-1.2420140846e-1f));
+			y = _mm512_fmadd_ps(y, m, splat(1.4249322787e-1f));
+			y = _mm512_fmadd_ps(y, m, splat(-1.6668057665e-1f));
+			y = _mm512_fmadd_ps(y, m, splat(2.0000714765e-1f));
+			y = _mm512_fmadd_ps(y, m, splat(-2.4999993993e-1f));
+			y = _mm512_fmadd_ps(y, m, splat(3.3333331174e-1f));
+			y = _mm512_mul_ps(_mm512_mul_ps(y, m), z);
+			y = _mm512_fmadd_ps(z, splat(-0.5f), y);
+
+			const __m512 ln = _mm512_add_ps(m, y);
+			return _mm512_fmadd_ps(ln, splat(1.44269504088896341f), e);
+		}
+
+		__m512 exp2(__m512 x)
+		{
+			x = _mm512_min_ps(_mm512_max_ps(x, splat(-126.0f)), splat(126.0f));
+
+			const __m512 n = _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+			const __m512 g = _mm512_mul_ps(_mm512_sub_ps(x, n), splat(0.693147180559945309f));
+
+			__m512 p = splat(1.9875691500e-4f);
+			p = _mm512_fmadd_ps(p, g, splat(1.3981999507e-3f));
+			p = _mm512_fmadd_ps(p, g, splat(8.3334519073e-3f));
+			p = _mm512_fmadd_ps(p, g, splat(4.1665795894e-2f));
+			p = _mm512_fmadd_ps(p, g, splat(1.6666665459e-1f));
+			p = _mm512_fmadd_ps(p, g, splat(5.0000001201e-1f));
+			p = _mm512_fmadd_ps(p, _mm512_mul_ps(g, g), _mm512_add_ps(g, splat(1.0f)));
+
+			const __m512i scale = _mm512_slli_epi32(_mm512_cvtps_epi32(n), 23);
+			return _mm512_castsi512_ps(_mm512_add_epi32(_mm512_castps_si512(p), scale));
+		}
+
+		__m512 bt2020_inv_gamma(__m512 x)
+		{
+			const __m512 curve = _mm512_fmsub_ps(exp2(_mm512_mul_ps(log2(x), splat(1.0f / 2.4f))), splat(1.055f), splat(0.055f));
+			const __m512 linear = _mm512_mul_ps(x, splat(12.92f));
+
+			return select(_mm512_cmp_ps_mask(x, splat(0.00313066844250063f), _CMP_GT_OQ), curve, linear);
+		}
+
+		__m512 linear_tonemap(__m512 x)
+		{
+			const __m512 compressed = _mm512_fmadd_ps(_mm512_sub_ps(x, splat(0.8f)), splat(1.0f / 2.5f), splat(0.8f));
+			return select(_mm512_cmp_ps_mask(x, splat(0.8f), _CMP_GE_OQ), compressed, x);
+		}
+
+		__m512 rgb_to_luma(__m512 r, __m512 g, __m512 b)
+		{
+			return _mm512_fmadd_ps(splat(0.213f), r, _mm512_fmadd_ps(splat(0.715f), g, _mm512_mul_ps(splat(0.072f), b)));
+		}
+
+		void neutral(__m512& r, __m512& g, __m512& b)
+		{
+			constexpr float start_compression = 0.8f - 0.04f;
+			constexpr float desaturation = 0.15f;
+			constexpr float d = 1.0f - start_compression;
+
+			const __m512 x = _mm512_min_ps(r, _mm512_min_ps(g, b));
+			const __m512 offset = select(_mm512_cmp_ps_mask(x, splat(0.08f), _CMP_LT_OQ), _mm512_fnmadd_ps(_mm512_mul_ps(x, x), splat(6.25f), x), splat(0.04f));
+
+			r = _mm512_sub_ps(r, offset);
+			g = _mm512_sub_ps(g, offset);
+			b = _mm512_sub_ps(b, offset);
+
+			const __m512 peak = _mm512_max_ps(r, _mm512_max_ps(g, b));
+			const __mmask16 compress = _mm512_cmp_ps_mask(peak, splat(start_compression), _CMP_GE_OQ);
+
+			if (!compress)
+				return;
+
+			const __m512 new_peak = _mm512_sub_ps(splat(1.0f), div(splat(d * d), _mm512_add_ps(peak, splat(d - start_compression))));
+			const __m512 scale = div(new_peak, peak);
+			const __m512 t = _mm512_sub_ps(splat(1.0f), _mm512_rcp14_ps(_mm512_fmadd_ps(splat(desaturation), _mm512_sub_ps(peak, new_peak), splat(1.0f))));
+
+			const auto compress_channel = [&](__m512 c)
+			{
+				c = _mm512_mul_ps(c, scale);
+				return _mm512_fmadd_ps(_mm512_sub_ps(new_peak, c), t, c);
+			};
+
+			r = select(compress, compress_channel(r), r);
+			g = select(compress, compress_channel(g), g);
+			b = select(compress, compress_channel(b), b);
+		}
+
+		__m512i to_unorm(__m512 x)
+		{
+			// max first so NaN ends up as 0
+			x = _mm512_min_ps(_mm512_max_ps(x, _mm512_setzero_ps()), splat(1.0f));
+			return _mm512_cvttps_epi32(_mm512_fmadd_ps(x, splat(255.0f), splat(0.5f)));
+		}
+
+		// 16 R16G16B16A16_FLOAT pixels in, 16 B8G8R8A8 pixels out
+		void tonemap16(const uint8_t* src, uint32_t* dest, __m512 inv_white)
+		{
+			// four pixels per register, rgba rgba rgba rgba
+			const __m512 v0 = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+			const __m512 v1 = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32)));
+			const __m512 v2 = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 64)));
+			const __m512 v3 = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 96)));
+
+			// lanes end up holding pixels 0 4 8 12 1 5 9 13 2 6 10 14 3 7 11 15
+			const __m512 t0 = _mm512_unpacklo_ps(v0, v1);
+			const __m512 t1 = _mm512_unpackhi_ps(v0, v1);
+			const __m512 t2 = _mm512_unpacklo_ps(v2, v3);
+			const __m512 t3 = _mm512_unpackhi_ps(v2, v3);
+
+			__m512 r = _mm512_shuffle_ps(t0, t2, 0x44);
+			__m512 g = _mm512_shuffle_ps(t0, t2, 0xee);
+			__m512 b = _mm512_shuffle_ps(t1, t3, 0x44);
+
+			const auto input = [&](__m512 c)
+			{
+				c = _mm512_min_ps(_mm512_max_ps(c, _mm512_setzero_ps()), splat(10000.0f));
+				return bt2020_inv_gamma(_mm512_mul_ps(c, inv_white));
+			};
+
+			r = input(r);
+			g = input(g);
+			b = input(b);
+
+			const __m512 lr = linear_tonemap(r);
+			const __m512 lg = linear_tonemap(g);
+			const __m512 lb = linear_tonemap(b);
+
+			neutral(r, g, b);
+
+			const __m512 linear_luma = rgb_to_luma(lr, lg, lb);
+			const __mmask16 blend = _mm512_cmp_ps_mask(linear_luma, splat(0.8f), _CMP_GE_OQ);
+
+			if (blend)
+			{
+				const __m512 s = div(linear_luma, rgb_to_luma(r, g, b));
+
+				r = select(blend, _mm512_mul_ps(r, s), lr);
+				g = select(blend, _mm512_mul_ps(g, s), lg);
+				b = select(blend, _mm512_mul_ps(b, s), lb);
+			}
+			else
+			{
+				r = lr;
+				g = lg;
+				b = lb;
+			}
+
+			__m512i packed = _mm512_or_si512(to_unorm(b), _mm512_slli_epi32(to_unorm(g), 8));
+			packed = _mm512_or_si512(packed, _mm512_slli_epi32(to_unorm(r), 16));
+			packed = _mm512_or_si512(packed, _mm512_set1_epi32(static_cast<int>(0xff000000u)));
+
+			packed = _mm512_permutexvar_epi32(_mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15), packed);
+			_mm512_storeu_si512(reinterpret_cast<__m512i*>(dest), packed);
+		}
+
+		void hdr_row_avx512(const uint8_t* src, uint32_t* dest, int count, float white_level)
+		{
+			const __m512 inv_white = splat(80.0f / white_level);
+
+			int i = 0;
+			for (; i + lanes <= count; i += lanes)
+				tonemap16(src + i * 8, dest + i, inv_white);
+
+			if (i == count)
+				return;
+
+			// pad the tail out to a full vector
+			alignas(64) uint8_t tail_src[lanes * 8] = {};
+			alignas(64) uint32_t tail_dest[lanes];
+
+			const int rest = count - i;
+			std::memcpy(tail_src, src + i * 8, rest * 8);
+			tonemap16(tail_src, tail_dest, inv_white);
+			std::memcpy(dest + i, tail_dest, rest * 4);
+		}
+
+		__m512i swizzle16(__m512i px)
+		{
+			// rgba -> bgra
+			const __m512i ga = _mm512_and_si512(px, _mm512_set1_epi32(0x0000ff00));
+			const __m512i r = _mm512_slli_epi32(_mm512_and_si512(px, _mm512_set1_epi32(0x000000ff)), 16);
+			const __m512i b = _mm512_and_si512(_mm512_srli_epi32(px, 16), _mm512_set1_epi32(0x000000ff));
+
+			return _mm512_or_si512(_mm512_or_si512(ga, r), _mm512_or_si512(b, _mm512_set1_epi32(static_cast<int>(0xff000000u))));
+		}
+
+		void sdr_row_avx512(const uint8_t* src, uint32_t* dest, int count, float)
+		{
+			int i = 0;
+			for (; i + lanes <= count; i += lanes)
+			{
+				const __m512i px = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(src + i * 4));
+				_mm512_storeu_si512(reinterpret_cast<__m512i*>(dest + i), swizzle16(px));
+			}
+
+			for (; i < count; i++)
+			{
+				const auto* px = src + i * 4;
+				dest[i] = px[2] | (px[1] << 8) | (px[0] << 16) | 0xff000000u;
+			}
+		}
+	}
+
+	const row_kernels avx512_row_kernels{ "avx512", hdr_row_avx512, sdr_row_avx512, hash_block_avx2 };
+}
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
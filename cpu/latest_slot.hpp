@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace cpu
+{
+	// hands the latest value from one producer thread to one consumer thread,
+	// triple buffered so neither side ever waits on the other. a value the
+	// consumer did not take before the next publish is simply replaced
+	template <typename T>
+	class latest_slot
+	{
+	public:
+		// what the producer fills in next, only the producer may touch it
+		T& back() { return values_[back_]; }
+
+		// makes back() the latest value, the producer gets a different back()
+		void publish()
+		{
+			back_ = state_.exchange(back_ | fresh_bit, std::memory_order_acq_rel) & index_mask;
+		}
+
+		// moves front() to the latest published value, false when nothing was
+		// published since the last take and front() stayed what it was
+		bool take()
+		{
+			if (!(state_.load(std::memory_order_relaxed) & fresh_bit))
+				return false;
+
+			front_ = state_.exchange(front_, std::memory_order_acq_rel) & index_mask;
+			return true;
+		}
+
+		// the value taken last, only the consumer may touch it
+		T& front() { return values_[front_]; }
+
+	private:
+		static constexpr uint8_t index_mask = 3;
+		static constexpr uint8_t fresh_bit = 4;
+
+		T values_[3];
+
+		uint8_t back_ = 0;
+		uint8_t front_ = 1;
+
+		// index of the value in between, with fresh_bit while it was not taken
+		std::atomic<uint8_t> state_{ 2 };
+	};
+}
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <vector>
+
+#include "monitor_batch.hpp"
+#include "retained_frame.hpp"
+#include "thread_pool.hpp"
+
+namespace cpu
+{
+	bool make_monitor_params(const placement& place, pixel_format format, float white_level, int width, int height, monitor_params& out)
+	{
+		out.place = place;
+		out.format = format;
+		out.white_level = white_level;
+		out.region = crop(place, { 0, 0, width, height }, out.visible);
+
+		return !out.region.empty();
+	}
+
+	void render_batch(
+		std::span<const monitor_params> table,
+		std::span<retained_frame* const> frames,
+		std::span<const image_view> sources,
+		const bitmap_view& dest, thread_pool& pool, tile_cache* cache
+	)
+	{
+		// job i is a row of tiles of the last monitor whose first row is <= i
+		std::vector<uint32_t> first_rows;
+		first_rows.reserve(table.size());
+
+		uint32_t total_rows = 0;
+
+		for (size_t i = 0; i < table.size(); i++)
+		{
+			first_rows.push_back(total_rows);
+			total_rows += frames[i]->tile_rows(table[i].region);
+		}
+
+		pool.parallel_for(total_rows, [&](uint32_t job)
+		{
+			const auto i = static_cast<size_t>(std::upper_bound(first_rows.begin(), first_rows.end(), job) - first_rows.begin() - 1);
+			const int row = static_cast<int>(job - first_rows[i]);
+
+			if (sources[i].data)
+				frames[i]->update_row(sources[i], table[i].region, row, cache);
+
+			frames[i]->compose_row(table[i].region, table[i].visible, row, dest);
+		});
+
+		for (size_t i = 0; i < table.size(); i++)
+		{
+			if (sources[i].data)
+				frames[i]->finish(table[i].region);
+		}
+	}
+}
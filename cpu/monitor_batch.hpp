@@ -0,0 +1,42 @@
+#pragma once
+#include <span>
+
+#include "geometry.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	class retained_frame;
+	class thread_pool;
+	class tile_cache;
+
+	// a row of the parameter table of a batched render, all a pass needs to
+	// know about one monitor
+	struct monitor_params
+	{
+		// extent of the duplicated frame, where its unrotated top left lands on
+		// dest and how it is rotated
+		placement place;
+		pixel_format format = pixel_format::r8g8b8a8_unorm;
+		float white_level = 200.0f;
+
+		// the source pixels that land on dest and where, what crop makes of place
+		rect region;
+		placement visible;
+	};
+
+	// false when nothing of place lands on a width x height dest
+	bool make_monitor_params(const placement& place, pixel_format format, float white_level, int width, int height, monitor_params& out);
+
+	// retained_frame::update and compose for every monitor of a request in one
+	// pass. frames[i] and sources[i] belong to table[i], sources[i] holds the
+	// region of table[i] or no data when nothing of it is stale. every row of
+	// tiles of every monitor is brought up to date and composed right after,
+	// all of them as a single job on pool
+	void render_batch(
+		std::span<const monitor_params> table,
+		std::span<retained_frame* const> frames,
+		std::span<const image_view> sources,
+		const bitmap_view& dest, thread_pool& pool, tile_cache* cache = nullptr
+	);
+}
@@ -0,0 +1,63 @@
+#include "output_diff.hpp"
+
+namespace cpu
+{
+	size_t output_diff::kept() const
+	{
+		size_t result = 0;
+
+		for (const auto from : kept_from)
+		{
+			if (from != npos)
+				result++;
+		}
+
+		return result;
+	}
+
+	size_t output_diff::added() const
+	{
+		return kept_from.size() - kept();
+	}
+
+	output_diff diff_outputs(std::span<const output_key> before, std::span<const output_key> after)
+	{
+		output_diff diff;
+		diff.kept_from.assign(after.size(), output_diff::npos);
+
+		std::vector<char> taken(before.size());
+
+		for (size_t i = 0; i < after.size(); i++)
+		{
+			const auto& now = after[i];
+
+			for (size_t j = 0; j < before.size(); j++)
+			{
+				const auto& then = before[j];
+
+				if (taken[j] || then.name != now.name || then.rotation != now.rotation)
+					continue;
+
+				// an hdr toggle changes the format the duplication hands out
+				if (then.hdr != now.hdr || then.color_space != now.color_space)
+					continue;
+
+				if (then.area.left != now.area.left || then.area.top != now.area.top ||
+					then.area.right != now.area.right || then.area.bottom != now.area.bottom)
+					continue;
+
+				taken[j] = true;
+				diff.kept_from[i] = j;
+				break;
+			}
+		}
+
+		for (size_t j = 0; j < before.size(); j++)
+		{
+			if (!taken[j])
+				diff.removed.push_back(j);
+		}
+
+		return diff;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace cpu
+{
+	// an output as an enumeration finds it
+	struct output_key
+	{
+		// the gdi device name, \\.\DISPLAY1 and so on
+		std::wstring name;
+		rect area;
+		rotation_t rotation = rotation_t::identity;
+
+		// whether it is in hdr, and its dxgi color space
+		bool hdr = false;
+		uint32_t color_space = 0;
+	};
+
+	// lists the outputs attached to the desktop, the dxgi adapter in the dll
+	class output_enumerator
+	{
+	public:
+		virtual ~output_enumerator() = default;
+
+		// in enumeration order
+		virtual void enumerate(std::vector<output_key>& out) = 0;
+	};
+
+	// what became of the outputs of an earlier enumeration
+	struct output_diff
+	{
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+		// for every output found now, the earlier one it continues or npos
+		std::vector<size_t> kept_from;
+
+		// earlier outputs nothing continues
+		std::vector<size_t> removed;
+
+		size_t kept() const;
+		size_t added() const;
+	};
+
+	// an output is continued by one of the same name that still sits where it
+	// was in the same color space, anything else about it changing costs its
+	// duplication anyway
+	output_diff diff_outputs(std::span<const output_key> before, std::span<const output_key> after);
+}
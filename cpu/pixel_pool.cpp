@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "pixel_pool.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		constexpr size_t page_size = 4096;
+		constexpr size_t large_page_size = 2 << 20;
+
+		// asking again after the os said no only costs a syscall per capture
+		std::atomic<bool> large_pages_unavailable{ false };
+		std::atomic<bool> large_pages_used{ false };
+
+		uint8_t* os_alloc(size_t capacity)
+		{
+#if defined(_WIN32)
+			const size_t minimum = GetLargePageMinimum();
+
+			// needs SeLockMemoryPrivilege, which most accounts do not have
+			if (minimum && capacity % minimum == 0 && !large_pages_unavailable.load(std::memory_order_relaxed))
+			{
+				auto* data = VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (data)
+				{
+					large_pages_used.store(true, std::memory_order_relaxed);
+					return static_cast<uint8_t*>(data);
+				}
+
+				large_pages_unavailable.store(true, std::memory_order_relaxed);
+			}
+
+			return static_cast<uint8_t*>(VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#elif defined(__linux__)
+			// only works with pages reserved in /proc/sys/vm/nr_hugepages
+			if (capacity % large_page_size == 0 && !large_pages_unavailable.load(std::memory_order_relaxed))
+			{
+				auto* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+				if (data != MAP_FAILED)
+				{
+					large_pages_used.store(true, std::memory_order_relaxed);
+					return static_cast<uint8_t*>(data);
+				}
+
+				large_pages_unavailable.store(true, std::memory_order_relaxed);
+			}
+
+			auto* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (data == MAP_FAILED)
+				return nullptr;
+
+			// transparent huge pages are the next best thing
+			if (capacity >= large_page_size)
+				madvise(data, capacity, MADV_HUGEPAGE);
+
+			return static_cast<uint8_t*>(data);
+#else
+			return static_cast<uint8_t*>(::operator new(capacity, std::align_val_t{ page_size }, std::nothrow));
+#endif
+		}
+
+		void os_free(uint8_t* data, size_t capacity)
+		{
+#if defined(_WIN32)
+			VirtualFree(data, 0, MEM_RELEASE);
+#elif defined(__linux__)
+			munmap(data, capacity);
+#else
+			::operator delete(data, std::align_val_t{ page_size });
+#endif
+		}
+	}
+
+	pixel_buffer::pixel_buffer(pixel_pool* pool, uint8_t* data, size_t size, size_t capacity) :
+		pool_(pool), data_(data), size_(size), capacity_(capacity)
+	{
+	}
+
+	pixel_buffer::~pixel_buffer()
+	{
+		reset();
+	}
+
+	pixel_buffer::pixel_buffer(pixel_buffer&& other) noexcept :
+		pool_(other.pool_), data_(other.data_), size_(other.size_), capacity_(other.capacity_)
+	{
+		other.pool_ = nullptr;
+		other.data_ = nullptr;
+		other.size_ = 0;
+		other.capacity_ = 0;
+	}
+
+	pixel_buffer& pixel_buffer::operator=(pixel_buffer&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+
+			std::swap(pool_, other.pool_);
+			std::swap(data_, other.data_);
+			std::swap(size_, other.size_);
+			std::swap(capacity_, other.capacity_);
+		}
+
+		return *this;
+	}
+
+	void pixel_buffer::reset()
+	{
+		if (data_)
+			pool_->release(data_, capacity_);
+
+		pool_ = nullptr;
+		data_ = nullptr;
+		size_ = 0;
+		capacity_ = 0;
+	}
+
+	pixel_pool::pixel_pool(size_t max_idle_bytes) :
+		max_idle_bytes_(max_idle_bytes)
+	{
+	}
+
+	pixel_pool::~pixel_pool()
+	{
+		trim();
+	}
+
+	size_t pixel_pool::size_class(size_t size)
+	{
+		if (size <= page_size)
+			return page_size;
+
+		// quarter steps between powers of two, at most 25% wasted
+		size_t power = page_size;
+		while (power * 2 < size)
+			power *= 2;
+
+		const size_t step = power / 4 > page_size ? power / 4 : page_size;
+		size_t capacity = (size + step - 1) / step * step;
+
+		// whole large pages from here on so they can back it
+		if (capacity >= large_page_size)
+			capacity = (capacity + large_page_size - 1) / large_page_size * large_page_size;
+
+		return capacity;
+	}
+
+	pixel_buffer pixel_pool::acquire(size_t size)
+	{
+		const size_t capacity = size_class(size);
+
+		{
+			std::lock_guard lock{ mutex_ };
+
+			const auto it = std::find_if(idle_.begin(), idle_.end(), [&](const block& b) { return b.capacity == capacity; });
+			if (it != idle_.end())
+			{
+				auto* data = it->data;
+
+				idle_bytes_ -= capacity;
+				idle_.erase(it);
+
+				reused_bytes_.fetch_add(capacity, std::memory_order_relaxed);
+				return { this, data, size, capacity };
+			}
+		}
+
+		auto* data = os_alloc(capacity);
+		if (!data)
+			throw std::bad_alloc{};
+
+		held_bytes_.fetch_add(capacity, std::memory_order_relaxed);
+		allocated_bytes_.fetch_add(capacity, std::memory_order_relaxed);
+
+		return { this, data, size, capacity };
+	}
+
+	void pixel_pool::release(uint8_t* data, size_t capacity)
+	{
+		{
+			std::lock_guard lock{ mutex_ };
+
+			if (idle_bytes_ + capacity <= max_idle_bytes_)
+			{
+				idle_.push_back({ data, capacity });
+				idle_bytes_ += capacity;
+				return;
+			}
+		}
+
+		os_free(data, capacity);
+		held_bytes_.fetch_sub(capacity, std::memory_order_relaxed);
+	}
+
+	void pixel_pool::trim()
+	{
+		std::vector<block> idle;
+
+		{
+			std::lock_guard lock{ mutex_ };
+
+			idle.swap(idle_);
+			idle_bytes_ = 0;
+		}
+
+		for (const auto& b : idle)
+		{
+			os_free(b.data, b.capacity);
+			held_bytes_.fetch_sub(b.capacity, std::memory_order_relaxed);
+		}
+	}
+
+	size_t pixel_pool::held_bytes() const
+	{
+		return held_bytes_.load(std::memory_order_relaxed);
+	}
+
+	size_t pixel_pool::idle_bytes() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return idle_bytes_;
+	}
+
+	uint64_t pixel_pool::reused_bytes() const
+	{
+		return reused_bytes_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t pixel_pool::allocated_bytes() const
+	{
+		return allocated_bytes_.load(std::memory_order_relaxed);
+	}
+
+	bool pixel_pool::large_pages() const
+	{
+		return large_pages_used.load(std::memory_order_relaxed);
+	}
+
+	pixel_pool& pixel_pool::shared()
+	{
+		// an 8k frame and change, never destroyed like the thread pool
+		static auto* pool = new pixel_pool(160ull << 20);
+		return *pool;
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cpu
+{
+	class pixel_pool;
+
+	// uninitialized, page aligned pixel memory from a pixel_pool, handed back to
+	// the pool when it goes away
+	class pixel_buffer
+	{
+	public:
+		pixel_buffer() = default;
+		~pixel_buffer();
+
+		pixel_buffer(pixel_buffer&& other) noexcept;
+		pixel_buffer& operator=(pixel_buffer&& other) noexcept;
+
+		pixel_buffer(const pixel_buffer&) = delete;
+		pixel_buffer& operator=(const pixel_buffer&) = delete;
+
+		uint8_t* data() const { return data_; }
+		size_t size() const { return size_; }
+		size_t capacity() const { return capacity_; }
+
+		explicit operator bool() const { return data_ != nullptr; }
+
+	private:
+		friend class pixel_pool;
+
+		pixel_buffer(pixel_pool* pool, uint8_t* data, size_t size, size_t capacity);
+
+		void reset();
+
+		pixel_pool* pool_ = nullptr;
+		uint8_t* data_ = nullptr;
+		size_t size_ = 0;
+		size_t capacity_ = 0;
+	};
+
+	// frame sized buffers kept around between captures instead of going back to
+	// the os. sizes are rounded up to classes a quarter of a power of two apart
+	// so a slightly different request size still finds its buffer. large pages
+	// are used when the os hands them out
+	class pixel_pool
+	{
+	public:
+		explicit pixel_pool(size_t max_idle_bytes);
+		~pixel_pool();
+
+		pixel_pool(const pixel_pool&) = delete;
+		pixel_pool& operator=(const pixel_pool&) = delete;
+
+		// never fails, throws std::bad_alloc like new would
+		pixel_buffer acquire(size_t size);
+
+		// gives every idle buffer back to the os
+		void trim();
+
+		// everything taken from the os and not given back yet, idle or not
+		size_t held_bytes() const;
+		size_t idle_bytes() const;
+
+		// bytes served from idle buffers instead of the os
+		uint64_t reused_bytes() const;
+		uint64_t allocated_bytes() const;
+
+		bool large_pages() const;
+
+		static pixel_pool& shared();
+
+	private:
+		friend class pixel_buffer;
+
+		struct block
+		{
+			uint8_t* data;
+			size_t capacity;
+		};
+
+		void release(uint8_t* data, size_t capacity);
+
+		static size_t size_class(size_t size);
+
+		size_t max_idle_bytes_;
+
+		mutable std::mutex mutex_;
+		std::vector<block> idle_;
+		size_t idle_bytes_ = 0;
+
+		std::atomic<size_t> held_bytes_{ 0 };
+		std::atomic<uint64_t> reused_bytes_{ 0 };
+		std::atomic<uint64_t> allocated_bytes_{ 0 };
+	};
+}
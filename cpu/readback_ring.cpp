@@ -0,0 +1,221 @@
+#include <algorithm>
+
+#include "readback_ring.hpp"
+
+namespace cpu
+{
+	readback_ring::readback_ring(readback_device& device, unsigned int depth, unsigned int max_sizes, int bucket) :
+		device_(device), depth_(depth), bucket_(std::max(bucket, 1)), max_sizes_(max_sizes)
+	{
+	}
+
+	readback_ring::~readback_ring()
+	{
+		clear();
+	}
+
+	void* readback_ring::acquire(int width, int height, uint32_t format)
+	{
+		width = bucketed(width);
+		height = bucketed(height);
+
+		std::lock_guard lock{ mutex_ };
+
+		acquires_++;
+		clock_++;
+
+		entry* idle = nullptr;
+
+		for (auto& e : entries_)
+		{
+			if (e.width != width || e.height != height || e.format != format)
+				continue;
+
+			if (!e.in_flight && (!idle || e.last_used < idle->last_used))
+				idle = &e;
+		}
+
+		// an in flight texture may still hold pixels nobody has read yet, so
+		// the ring grows past depth while that many are needed at once
+		if (idle)
+		{
+			reuses_++;
+
+			idle->last_used = clock_;
+			idle->in_flight = true;
+			return idle->texture;
+		}
+
+		auto* texture = device_.create_staging(width, height, format);
+		if (!texture)
+			return nullptr;
+
+		entries_.push_back({ texture, width, height, format, clock_, true, false });
+		evict_sizes();
+
+		return texture;
+	}
+
+	readback_device::map_status readback_ring::try_map(void* texture, mapped_view& mapped)
+	{
+		std::lock_guard lock{ mutex_ };
+
+		auto* e = find(texture);
+		if (!e)
+			return readback_device::map_status::failed;
+
+		const auto status = device_.map(texture, true, mapped);
+
+		if (status == readback_device::map_status::busy)
+			busy_maps_++;
+
+		e->mapped = status == readback_device::map_status::ok;
+		return status;
+	}
+
+	readback_device::map_status readback_ring::map(void* texture, mapped_view& mapped)
+	{
+		auto status = try_map(texture, mapped);
+
+		// blocking with the lock held would stall every other thread's readback
+		if (status == readback_device::map_status::busy)
+		{
+			status = device_.map(texture, false, mapped);
+
+			std::lock_guard lock{ mutex_ };
+			find(texture)->mapped = status == readback_device::map_status::ok;
+		}
+
+		return status;
+	}
+
+	void readback_ring::unmap(void* texture)
+	{
+		std::lock_guard lock{ mutex_ };
+
+		auto* e = find(texture);
+		if (!e)
+			return;
+
+		if (e->mapped)
+			device_.unmap(texture);
+
+		e->mapped = false;
+		e->in_flight = false;
+
+		// and shrinks back to depth once they are returned
+		const auto count = std::count_if(entries_.begin(), entries_.end(), [&](const entry& other)
+		{
+			return other.width == e->width && other.height == e->height && other.format == e->format;
+		});
+
+		if (count > depth_)
+		{
+			device_.release_staging(texture);
+			entries_.erase(entries_.begin() + (e - entries_.data()));
+		}
+	}
+
+	void readback_ring::clear()
+	{
+		std::lock_guard lock{ mutex_ };
+
+		for (auto& e : entries_)
+		{
+			if (e.mapped)
+				device_.unmap(e.texture);
+
+			device_.release_staging(e.texture);
+		}
+
+		entries_.clear();
+	}
+
+	uint64_t readback_ring::acquires() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return acquires_;
+	}
+
+	uint64_t readback_ring::reuses() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return reuses_;
+	}
+
+	uint64_t readback_ring::busy_maps() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return busy_maps_;
+	}
+
+	int readback_ring::bucketed(int size) const
+	{
+		// 16384, the largest d3d11 texture, stays a multiple of the default
+		return (size + bucket_ - 1) / bucket_ * bucket_;
+	}
+
+	readback_ring::entry* readback_ring::find(void* texture)
+	{
+		const auto it = std::find_if(entries_.begin(), entries_.end(), [&](const entry& e) { return e.texture == texture; });
+		return it != entries_.end() ? &*it : nullptr;
+	}
+
+	void readback_ring::evict_sizes()
+	{
+		const auto same_size = [](const entry& a, const entry& b)
+		{
+			return a.width == b.width && a.height == b.height && a.format == b.format;
+		};
+
+		while (true)
+		{
+			unsigned int sizes = 0;
+			const entry* victim = nullptr;
+			uint64_t victim_used = 0;
+
+			for (size_t i = 0; i < entries_.size(); i++)
+			{
+				const auto& e = entries_[i];
+
+				// only look at the first entry of every size
+				if (std::any_of(entries_.begin(), entries_.begin() + i, [&](const entry& other) { return same_size(e, other); }))
+					continue;
+
+				sizes++;
+
+				uint64_t used = 0;
+				bool busy = false;
+
+				for (const auto& other : entries_)
+				{
+					if (!same_size(e, other))
+						continue;
+
+					used = std::max(used, other.last_used);
+					busy |= other.in_flight;
+				}
+
+				if (!busy && (!victim || used < victim_used))
+				{
+					victim = &e;
+					victim_used = used;
+				}
+			}
+
+			if (sizes <= max_sizes_ || !victim)
+				return;
+
+			const entry size = *victim;
+
+			std::erase_if(entries_, [&](const entry& e)
+			{
+				if (!same_size(e, size))
+					return false;
+
+				device_.release_staging(e.texture);
+				return true;
+			});
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cpu
+{
+	struct mapped_view
+	{
+		const uint8_t* data = nullptr;
+		ptrdiff_t pitch = 0;
+	};
+
+	// the part of d3d11 readback_ring drives, so the ring can run against an
+	// in-memory fake. textures are opaque handles owned by the device
+	class readback_device
+	{
+	public:
+		enum class map_status
+		{
+			ok,
+			busy, // the copy into the texture is still in flight
+			failed,
+		};
+
+		virtual ~readback_device() = default;
+
+		virtual void* create_staging(int width, int height, uint32_t format) = 0;
+		virtual void release_staging(void* texture) = 0;
+
+		// with do_not_wait set the device answers busy instead of blocking
+		virtual map_status map(void* texture, bool do_not_wait, mapped_view& mapped) = 0;
+		virtual void unmap(void* texture) = 0;
+	};
+
+	// keeps up to depth staging textures per size around so readbacks neither
+	// create textures nor wait on a texture the previous frame still uses.
+	// sizes are rounded up to a multiple of bucket, so requests that differ by a
+	// few pixels, like a loupe following the cursor, share textures. a texture
+	// is in flight from acquire until it is unmapped. safe to use from several
+	// threads as long as the device is
+	class readback_ring
+	{
+	public:
+		explicit readback_ring(readback_device& device, unsigned int depth = 3, unsigned int max_sizes = 8, int bucket = 256);
+		~readback_ring();
+
+		readback_ring(const readback_ring&) = delete;
+		readback_ring& operator=(const readback_ring&) = delete;
+
+		// an idle texture of at least this size to copy into, the least recently
+		// used one of its bucket. only when all of them are in flight a new one
+		// is made, textures beyond depth are released again when unmapped.
+		// callers copy into and read back the top left width x height
+		void* acquire(int width, int height, uint32_t format);
+
+		// maps without waiting, busy means the copy has not landed yet and the
+		// caller can go do something else first
+		readback_device::map_status try_map(void* texture, mapped_view& mapped);
+
+		// try_map, then blocks if the copy still has not landed
+		readback_device::map_status map(void* texture, mapped_view& mapped);
+
+		void unmap(void* texture);
+
+		// releases every texture, none may be mapped
+		void clear();
+
+		uint64_t acquires() const;
+		uint64_t reuses() const;
+		uint64_t busy_maps() const;
+
+	private:
+		struct entry
+		{
+			void* texture;
+			int width;
+			int height;
+			uint32_t format;
+			uint64_t last_used;
+			bool in_flight;
+			bool mapped;
+		};
+
+		entry* find(void* texture);
+		void evict_sizes();
+
+		int bucketed(int size) const;
+
+		readback_device& device_;
+		unsigned int depth_;
+		int bucket_;
+
+		mutable std::mutex mutex_;
+		unsigned int max_sizes_;
+
+		std::vector<entry> entries_;
+		uint64_t clock_ = 0;
+
+		uint64_t acquires_ = 0;
+		uint64_t reuses_ = 0;
+		uint64_t busy_maps_ = 0;
+	};
+}
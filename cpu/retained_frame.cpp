@@ -0,0 +1,211 @@
+#include <cstring>
+
+#include "retained_frame.hpp"
+#include "kernels.hpp"
+#include "rotate.hpp"
+#include "thread_pool.hpp"
+#include "tile_cache.hpp"
+
+namespace cpu
+{
+	void retained_frame::prepare(int width, int height, pixel_format format, float white_level)
+	{
+		if (width != width_ || height != height_)
+		{
+			width_ = width;
+			height_ = height;
+
+			pixels_.resize(static_cast<size_t>(width) * height * 4);
+			dirty_.resize(width, height);
+		}
+
+		if (format != format_ || white_level != white_level_)
+		{
+			format_ = format;
+			white_level_ = white_level;
+
+			dirty_.mark_all();
+		}
+	}
+
+	void retained_frame::damage(const rect& r)
+	{
+		dirty_.mark(r);
+	}
+
+	void retained_frame::damage_all()
+	{
+		dirty_.mark_all();
+	}
+
+	void retained_frame::move(const rect& dest, int src_x, int src_y)
+	{
+		const int dx = dest.left - src_x;
+		const int dy = dest.top - src_y;
+
+		// both ends have to be inside the image
+		const auto to = intersect(intersect(dest, { 0, 0, width_, height_ }), { dx, dy, width_ + dx, height_ + dy });
+
+		if (to.left != dest.left || to.top != dest.top || to.right != dest.right || to.bottom != dest.bottom)
+			dirty_.mark(dest);
+
+		if (to.empty())
+			return;
+
+		const rect from{ to.left - dx, to.top - dy, to.right - dx, to.bottom - dy };
+
+		const ptrdiff_t pitch = width_ * 4;
+		const size_t row_size = static_cast<size_t>(to.width()) * 4;
+
+		const auto copy_row = [&](int y)
+		{
+			std::memmove(
+				pixels_.data() + pitch * (to.top + y) + to.left * 4,
+				pixels_.data() + pitch * (from.top + y) + from.left * 4,
+				row_size
+			);
+		};
+
+		// moving down reads rows the upwards order would already have overwritten
+		if (dy > 0)
+		{
+			for (int y = to.height() - 1; y >= 0; y--)
+				copy_row(y);
+		}
+		else
+		{
+			for (int y = 0; y < to.height(); y++)
+				copy_row(y);
+		}
+
+		// stale pixels stay stale wherever they were moved to
+		if (dirty_.any(from))
+			dirty_.mark(to);
+	}
+
+	void retained_frame::pending(const rect& region, std::vector<rect>& out) const
+	{
+		dirty_.collect(region, out);
+	}
+
+	void retained_frame::update(const image_view& src, const rect& region, thread_pool& pool, tile_cache* cache)
+	{
+		std::vector<rect> stale;
+		pending(region, stale);
+
+		if (stale.empty())
+			return;
+
+		std::vector<rect> tiles;
+		split_tiles(stale, tiles);
+
+		pool.parallel_for(static_cast<uint32_t>(tiles.size()), [&](uint32_t i)
+		{
+			update_tile(src, region, tiles[i], cache);
+		});
+
+		finish(region);
+	}
+
+	void retained_frame::compose(const rect& region, const placement& sub, const bitmap_view& dest, thread_pool& pool) const
+	{
+		pool.parallel_for(tile_rows(region), [&](uint32_t row)
+		{
+			compose_row(region, sub, static_cast<int>(row), dest);
+		});
+	}
+
+	int retained_frame::tile_rows(const rect& region) const
+	{
+		if (region.empty())
+			return 0;
+
+		return (region.bottom - 1) / tile_size - region.top / tile_size + 1;
+	}
+
+	void retained_frame::update_row(const image_view& src, const rect& region, int row, tile_cache* cache)
+	{
+		std::vector<rect> stale;
+		pending(row_of(region, row), stale);
+
+		std::vector<rect> tiles;
+		split_tiles(stale, tiles);
+
+		for (const auto& area : tiles)
+			update_tile(src, region, area, cache);
+	}
+
+	void retained_frame::compose_row(const rect& region, const placement& sub, int row, const bitmap_view& dest) const
+	{
+		const ptrdiff_t pitch = width_ * 4;
+		const auto r = row_of(region, row);
+
+		// rows of region relative to region, which is what sub places
+		const rect rows{ 0, r.top - region.top, region.width(), r.bottom - region.top };
+		const auto target = to_dest(sub, rows);
+
+		rotate_copy(
+			pixels_.data() + pitch * r.top + region.left * 4, pitch,
+			rows.width(), rows.height(),
+			dest.data + dest.pitch * target.top + target.left * 4, dest.pitch,
+			sub.rotation
+		);
+	}
+
+	void retained_frame::finish(const rect& region)
+	{
+		// tiles cut by region keep their bit, the part outside was not updated
+		dirty_.clear(region);
+	}
+
+	rect retained_frame::row_of(const rect& region, int row)
+	{
+		const int top = (region.top / tile_size + row) * tile_size;
+
+		return intersect(region, { region.left, top, region.right, top + tile_size });
+	}
+
+	void retained_frame::split_tiles(const std::vector<rect>& stale, std::vector<rect>& out)
+	{
+		// stale rects are made of whole tiles, except where region cuts them
+		for (const auto& r : stale)
+		{
+			for (int ty = r.top / tile_size * tile_size; ty < r.bottom; ty += tile_size)
+			{
+				for (int tx = r.left / tile_size * tile_size; tx < r.right; tx += tile_size)
+					out.push_back(intersect(r, { tx, ty, tx + tile_size, ty + tile_size }));
+			}
+		}
+	}
+
+	void retained_frame::update_tile(const image_view& src, const rect& region, const rect& area, tile_cache* cache)
+	{
+		const auto& kernels = select_row_kernels();
+		const auto kernel = src.format == pixel_format::r16g16b16a16_float ? kernels.hdr : kernels.sdr;
+		const int bpp = bytes_per_pixel(src.format);
+		const ptrdiff_t pitch = width_ * 4;
+
+		// an sdr tile is just a swizzle, hashing it costs about as much
+		if (src.format != pixel_format::r16g16b16a16_float)
+			cache = nullptr;
+
+		const auto* in = src.data + src.pitch * (area.top - region.top) + (area.left - region.left) * bpp;
+		auto* out = pixels_.data() + pitch * area.top + area.left * 4;
+
+		tile_cache::key key;
+
+		if (cache)
+		{
+			key = { kernels.hash(in, src.pitch, area.width() * bpp, area.height()), area.width(), area.height(), src.format, white_level_ };
+
+			if (cache->lookup(key, out, pitch))
+				return;
+		}
+
+		for (int y = 0; y < area.height(); y++)
+			kernel(in + src.pitch * y, reinterpret_cast<uint32_t*>(out + pitch * y), area.width(), white_level_);
+
+		if (cache)
+			cache->insert(key, out, pitch);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "geometry.hpp"
+#include "tile_bitmap.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	class tile_cache;
+
+	// the last tonemapped output of one monitor, kept in source orientation so
+	// desktop duplication dirty rects apply to it directly. only tiles damaged
+	// since they were last tonemapped have to be read back and tonemapped again
+	class retained_frame
+	{
+	public:
+		// throws the retained output away when any of these changed
+		void prepare(int width, int height, pixel_format format, float white_level);
+
+		// r is in source pixels
+		void damage(const rect& r);
+		void damage_all();
+
+		// content of the frame that was shifted to dest from (src_x, src_y), the
+		// retained output is shifted the same way instead of being tonemapped
+		// again. moves have to be applied in the order they were reported and
+		// before the dirty rects of the same frame
+		void move(const rect& dest, int src_x, int src_y);
+
+		// stale parts of region, these are what update needs valid in src
+		void pending(const rect& region, std::vector<rect>& out) const;
+
+		// src holds the source pixels of region, at least the pending parts.
+		// with a cache, stale hdr tiles whose content was tonemapped before at
+		// the same white level are copied out of it instead
+		void update(const image_view& src, const rect& region, thread_pool& pool, tile_cache* cache = nullptr);
+
+		// writes region to dest at sub, which is what crop returned for region
+		void compose(const rect& region, const placement& sub, const bitmap_view& dest, thread_pool& pool) const;
+
+		// update and compose split into rows of tiles, so the rows of several
+		// frames can be run as one job. rows of region may be updated and composed
+		// concurrently, finish has to follow once all of them are updated
+		int tile_rows(const rect& region) const;
+		void update_row(const image_view& src, const rect& region, int row, tile_cache* cache = nullptr);
+		void compose_row(const rect& region, const placement& sub, int row, const bitmap_view& dest) const;
+		void finish(const rect& region);
+
+	private:
+		static rect row_of(const rect& region, int row);
+		static void split_tiles(const std::vector<rect>& stale, std::vector<rect>& out);
+
+		void update_tile(const image_view& src, const rect& region, const rect& area, tile_cache* cache);
+
+		int width_ = 0;
+		int height_ = 0;
+		pixel_format format_ = pixel_format::r8g8b8a8_unorm;
+		float white_level_ = 0.0f;
+
+		tile_bitmap dirty_;
+		std::vector<uint8_t> pixels_;
+	};
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define ROTATE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "rotate.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		// 16 pixels = one 64 byte line per block row
+		constexpr int block_size = 16;
+
+		uint32_t load(const uint8_t* row, int x)
+		{
+			uint32_t px;
+			std::memcpy(&px, row + x * 4, sizeof(px));
+			return px;
+		}
+
+		void store(uint8_t* row, int x, uint32_t px)
+		{
+			std::memcpy(row + x * 4, &px, sizeof(px));
+		}
+
+		template <bool Clockwise>
+		void transpose_scalar(const uint8_t* src, ptrdiff_t src_pitch, int width, int height, uint8_t* dest, ptrdiff_t dest_pitch,
+							  int r0, int r1, int c0, int c1)
+		{
+			for (int r = r0; r < r1; r++)
+			{
+				auto* out = dest + dest_pitch * r;
+
+				for (int c = c0; c < c1; c++)
+				{
+					// 90: dest[r][c] = src[h - 1 - c][r], 270: dest[r][c] = src[c][w - 1 - r]
+					if constexpr (Clockwise)
+						store(out, c, load(src + src_pitch * (height - 1 - c), r));
+					else
+						store(out, c, load(src + src_pitch * c, width - 1 - r));
+				}
+			}
+		}
+
+#ifdef ROTATE_SSE2
+		// dest rows r..r+3, columns c..c+3
+		template <bool Clockwise>
+		void transpose4x4(const uint8_t* src, ptrdiff_t src_pitch, int width, int height, uint8_t* dest, ptrdiff_t dest_pitch, int r, int c)
+		{
+			__m128i q[4];
+
+			for (int j = 0; j < 4; j++)
+			{
+				const auto* in = Clockwise
+					? src + src_pitch * (height - 1 - c - j) + r * 4
+					: src + src_pitch * (c + j) + (width - 4 - r) * 4;
+
+				q[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+			}
+
+			const __m128i t0 = _mm_unpacklo_epi32(q[0], q[1]);
+			const __m128i t1 = _mm_unpacklo_epi32(q[2], q[3]);
+			const __m128i t2 = _mm_unpackhi_epi32(q[0], q[1]);
+			const __m128i t3 = _mm_unpackhi_epi32(q[2], q[3]);
+
+			const __m128i rows[4] =
+			{
+				_mm_unpacklo_epi64(t0, t1),
+				_mm_unpackhi_epi64(t0, t1),
+				_mm_unpacklo_epi64(t2, t3),
+				_mm_unpackhi_epi64(t2, t3),
+			};
+
+			for (int k = 0; k < 4; k++)
+			{
+				// counter clockwise reads the source right to left
+				const auto& row = Clockwise ? rows[k] : rows[3 - k];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + dest_pitch * (r + k) + c * 4), row);
+			}
+		}
+#endif
+
+		// walks the destination in block_size squares so both the source lines read
+		// and the destination lines written stay in l1 for the whole block
+		template <bool Clockwise>
+		void transpose(const uint8_t* src, ptrdiff_t src_pitch, int width, int height, uint8_t* dest, ptrdiff_t dest_pitch)
+		{
+			// destination is height x width
+			for (int r0 = 0; r0 < width; r0 += block_size)
+			{
+				const int r1 = std::min(r0 + block_size, width);
+
+				for (int c0 = 0; c0 < height; c0 += block_size)
+				{
+					const int c1 = std::min(c0 + block_size, height);
+
+#ifdef ROTATE_SSE2
+					const int r4 = r0 + (r1 - r0) / 4 * 4;
+					const int c4 = c0 + (c1 - c0) / 4 * 4;
+
+					for (int r = r0; r < r4; r += 4)
+					{
+						for (int c = c0; c < c4; c += 4)
+							transpose4x4<Clockwise>(src, src_pitch, width, height, dest, dest_pitch, r, c);
+					}
+
+					transpose_scalar<Clockwise>(src, src_pitch, width, height, dest, dest_pitch, r0, r4, c4, c1);
+					transpose_scalar<Clockwise>(src, src_pitch, width, height, dest, dest_pitch, r4, r1, c0, c1);
+#else
+					transpose_scalar<Clockwise>(src, src_pitch, width, height, dest, dest_pitch, r0, r1, c0, c1);
+#endif
+				}
+			}
+		}
+
+		void flip(const uint8_t* src, ptrdiff_t src_pitch, int width, int height, uint8_t* dest, ptrdiff_t dest_pitch)
+		{
+			for (int r = 0; r < height; r++)
+			{
+				const auto* in = src + src_pitch * (height - 1 - r);
+				auto* out = dest + dest_pitch * r;
+
+				for (int c = 0; c < width; c++)
+					store(out, c, load(in, width - 1 - c));
+			}
+		}
+	}
+
+	void rotate_copy(const uint8_t* src, ptrdiff_t src_pitch, int width, int height,
+					 uint8_t* dest, ptrdiff_t dest_pitch, rotation_t rotation)
+	{
+		switch (rotation)
+		{
+		case rotation_t::rotate90:
+			transpose<true>(src, src_pitch, width, height, dest, dest_pitch);
+			break;
+		case rotation_t::rotate180:
+			flip(src, src_pitch, width, height, dest, dest_pitch);
+			break;
+		case rotation_t::rotate270:
+			transpose<false>(src, src_pitch, width, height, dest, dest_pitch);
+			break;
+		default:
+			for (int r = 0; r < height; r++)
+				std::memcpy(dest + dest_pitch * r, src + src_pitch * r, width * 4);
+			break;
+		}
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+#include "geometry.hpp"
+
+namespace cpu
+{
+	// copies width x height B8G8R8A8 pixels from src to dest rotated by rotation,
+	// dest points at the top left of the rotated block (height x width for 90/270)
+	// the transposing cases run in blocks so every store fills whole cache lines
+	void rotate_copy(const uint8_t* src, ptrdiff_t src_pitch, int width, int height,
+					 uint8_t* dest, ptrdiff_t dest_pitch, rotation_t rotation);
+}
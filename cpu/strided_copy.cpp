@@ -0,0 +1,123 @@
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define STRIDED_COPY_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "strided_copy.hpp"
+#include "kernels.hpp"
+#include "thread_pool.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		// what one worker copies at a time, small enough to balance well and
+		// large enough that picking up the next band is noise
+		constexpr size_t band_bytes = 256 << 10;
+
+		void copy_span(uint8_t* dest, const uint8_t* src, size_t size, bool stream)
+		{
+#ifdef STRIDED_COPY_SSE2
+			if (stream && size >= 256)
+			{
+				// streaming stores need 16 byte aligned destinations
+				const size_t head = (16 - (reinterpret_cast<uintptr_t>(dest) & 15)) & 15;
+				std::memcpy(dest, src, head);
+
+				dest += head;
+				src += head;
+				size -= head;
+
+				size_t i = 0;
+				for (; i + 64 <= size; i += 64)
+				{
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+					const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+					const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dest + i), a);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 16), b);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 32), c);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(dest + i + 48), d);
+				}
+
+				std::memcpy(dest + i, src + i, size - i);
+				return;
+			}
+#endif
+
+			std::memcpy(dest, src, size);
+		}
+
+		void finish_streaming(bool stream)
+		{
+#ifdef STRIDED_COPY_SSE2
+			// streaming stores are weakly ordered, make them visible before the
+			// pool reports the band as done
+			if (stream)
+				_mm_sfence();
+#endif
+		}
+	}
+
+	void strided_copy(const uint8_t* src, ptrdiff_t src_pitch, uint8_t* dest, ptrdiff_t dest_pitch,
+					  size_t row_bytes, int rows, thread_pool& pool)
+	{
+		if (rows <= 0 || row_bytes == 0)
+			return;
+
+		if (src == dest && src_pitch == dest_pitch)
+			return;
+
+		const size_t total = row_bytes * rows;
+		const bool stream = total > last_level_cache_size();
+
+		// tightly packed on both ends, the rows are one block
+		if (src_pitch == dest_pitch && src_pitch == static_cast<ptrdiff_t>(row_bytes))
+		{
+			const auto bands = static_cast<uint32_t>((total + band_bytes - 1) / band_bytes);
+
+			if (bands == 1)
+			{
+				std::memcpy(dest, src, total);
+				return;
+			}
+
+			pool.parallel_for(bands, [&](uint32_t band)
+			{
+				const size_t offset = band * band_bytes;
+				const size_t size = total - offset < band_bytes ? total - offset : band_bytes;
+
+				copy_span(dest + offset, src + offset, size, stream);
+				finish_streaming(stream);
+			});
+
+			return;
+		}
+
+		const int rows_per_band = row_bytes >= band_bytes ? 1 : static_cast<int>(band_bytes / row_bytes);
+		const auto bands = static_cast<uint32_t>((rows + rows_per_band - 1) / rows_per_band);
+
+		const auto copy_band = [&](uint32_t band)
+		{
+			const int first = static_cast<int>(band) * rows_per_band;
+			const int last = first + rows_per_band < rows ? first + rows_per_band : rows;
+
+			for (int y = first; y < last; y++)
+				copy_span(dest + dest_pitch * y, src + src_pitch * y, row_bytes, stream);
+
+			finish_streaming(stream);
+		};
+
+		if (bands == 1)
+		{
+			copy_band(0);
+			return;
+		}
+
+		pool.parallel_for(bands, copy_band);
+	}
+}
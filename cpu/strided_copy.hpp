@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace cpu
+{
+	class thread_pool;
+
+	// copies rows of row_bytes between two pitched images, split into bands
+	// across pool. copies bigger than the last level cache use streaming stores
+	// so the frame does not push everything else out on its way through.
+	// when both pitches equal row_bytes it is done as one contiguous block,
+	// and nothing is copied when src and dest are the same memory
+	void strided_copy(const uint8_t* src, ptrdiff_t src_pitch, uint8_t* dest, ptrdiff_t dest_pitch,
+					  size_t row_bytes, int rows, thread_pool& pool);
+}
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <utility>
+
+#include "thread_pool.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		thread_local const thread_pool* current_pool = nullptr;
+
+		uint64_t pack(uint32_t begin, uint32_t end)
+		{
+			return begin | (static_cast<uint64_t>(end) << 32);
+		}
+
+		uint32_t range_begin(uint64_t range) { return static_cast<uint32_t>(range); }
+		uint32_t range_end(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+	}
+
+	thread_pool::thread_pool(unsigned int threads)
+	{
+		if (!threads)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+
+		size_ = threads;
+		slots_ = std::make_unique<slot[]>(size_);
+
+		// slot 0 belongs to whoever calls parallel_for
+		threads_.reserve(size_ - 1);
+		for (unsigned int i = 1; i < size_; i++)
+			threads_.emplace_back(&thread_pool::worker_main, this, i);
+	}
+
+	thread_pool::~thread_pool()
+	{
+		{
+			std::lock_guard lock{ mutex_ };
+			stop_ = true;
+		}
+
+		wake_.notify_all();
+
+		for (auto& thread : threads_)
+			thread.join();
+	}
+
+	unsigned int thread_pool::size() const
+	{
+		return size_;
+	}
+
+	void thread_pool::parallel_for(uint32_t count, const std::function<void(uint32_t)>& fn)
+	{
+		if (!count)
+			return;
+
+		if (size_ == 1 || count == 1 || current_pool == this)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				fn(i);
+
+			return;
+		}
+
+		std::lock_guard submit{ submit_mutex_ };
+
+		fn_ = &fn;
+		remaining_.store(count, std::memory_order_relaxed);
+		failed_.store(false, std::memory_order_relaxed);
+
+		for (unsigned int i = 0; i < size_; i++)
+		{
+			const auto begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * i / size_);
+			const auto end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (i + 1) / size_);
+
+			slots_[i].range.store(pack(begin, end), std::memory_order_release);
+		}
+
+		{
+			std::lock_guard lock{ mutex_ };
+			generation_++;
+		}
+
+		wake_.notify_all();
+
+		current_pool = this;
+		run(0);
+		current_pool = nullptr;
+
+		std::unique_lock lock{ mutex_ };
+		done_.wait(lock, [this]
+		{
+			return remaining_.load(std::memory_order_acquire) == 0 && busy_ == 0;
+		});
+
+		fn_ = nullptr;
+
+		if (error_)
+			std::rethrow_exception(std::exchange(error_, nullptr));
+	}
+
+	thread_pool& thread_pool::shared()
+	{
+		// never destroyed, joining workers from a dll detach is asking for trouble
+		static auto* pool = new thread_pool{};
+		return *pool;
+	}
+
+	void thread_pool::worker_main(unsigned int index)
+	{
+		current_pool = this;
+		uint64_t seen = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock lock{ mutex_ };
+				wake_.wait(lock, [&]
+				{
+					return stop_ || generation_ != seen;
+				});
+
+				if (stop_)
+					return;
+
+				seen = generation_;
+				busy_++;
+			}
+
+			run(index);
+
+			{
+				std::lock_guard lock{ mutex_ };
+				busy_--;
+			}
+
+			done_.notify_all();
+		}
+	}
+
+	void thread_pool::run(unsigned int index)
+	{
+		uint32_t item;
+
+		while (pop(index, item) || steal(index, item))
+		{
+			// once an index threw the rest are only counted off
+			if (!failed_.load(std::memory_order_relaxed))
+			{
+				try
+				{
+					(*fn_)(item);
+				}
+				catch (...)
+				{
+					std::lock_guard lock{ mutex_ };
+
+					if (!error_)
+						error_ = std::current_exception();
+
+					failed_.store(true, std::memory_order_relaxed);
+				}
+			}
+
+			if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				std::lock_guard lock{ mutex_ };
+				done_.notify_all();
+			}
+		}
+	}
+
+	bool thread_pool::pop(unsigned int index, uint32_t& item)
+	{
+		auto& range = slots_[index].range;
+		auto value = range.load(std::memory_order_acquire);
+
+		while (true)
+		{
+			const auto begin = range_begin(value);
+			const auto end = range_end(value);
+
+			if (begin >= end)
+				return false;
+
+			if (range.compare_exchange_weak(value, pack(begin + 1, end), std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				item = begin;
+				return true;
+			}
+		}
+	}
+
+	bool thread_pool::steal(unsigned int index, uint32_t& item)
+	{
+		for (unsigned int i = 1; i < size_; i++)
+		{
+			auto& victim = slots_[(index + i) % size_].range;
+			auto value = victim.load(std::memory_order_acquire);
+
+			while (true)
+			{
+				const auto begin = range_begin(value);
+				const auto end = range_end(value);
+
+				if (begin >= end)
+					break;
+
+				// take the back half, the owner keeps walking the front
+				const auto mid = begin + (end - begin) / 2;
+
+				if (victim.compare_exchange_weak(value, pack(begin, mid), std::memory_order_acq_rel, std::memory_order_acquire))
+				{
+					item = mid;
+					slots_[index].range.store(pack(mid + 1, end), std::memory_order_release);
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+}
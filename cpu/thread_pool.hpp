@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpu
+{
+	// persistent workers running index ranges, every worker owns a slice of the
+	// range and steals half of someone else's remaining slice once it runs dry
+	class thread_pool
+	{
+	public:
+		explicit thread_pool(unsigned int threads = 0);
+		~thread_pool();
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		// number of threads taking part in a job, including the caller
+		unsigned int size() const;
+
+		// runs fn(i) for every i in [0, count) and blocks until all of them finished
+		// the calling thread works too, nested calls from inside a job run inline.
+		// the first exception fn threw is rethrown here once no thread is in fn
+		// any more, the indices nobody had started by then are skipped
+		void parallel_for(uint32_t count, const std::function<void(uint32_t)>& fn);
+
+		static thread_pool& shared();
+
+	private:
+		struct alignas(64) slot
+		{
+			// begin in the low half, end in the high half
+			std::atomic<uint64_t> range{ 0 };
+		};
+
+		void worker_main(unsigned int index);
+		void run(unsigned int index);
+
+		bool pop(unsigned int index, uint32_t& item);
+		bool steal(unsigned int index, uint32_t& item);
+
+		std::vector<std::thread> threads_;
+		std::unique_ptr<slot[]> slots_;
+		unsigned int size_;
+
+		std::mutex submit_mutex_;
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		uint64_t generation_ = 0;
+		unsigned int busy_ = 0;
+		bool stop_ = false;
+
+		const std::function<void(uint32_t)>* fn_ = nullptr;
+		std::atomic<uint32_t> remaining_{ 0 };
+
+		std::atomic<bool> failed_{ false };
+		std::exception_ptr error_;
+	};
+}
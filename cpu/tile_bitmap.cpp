@@ -0,0 +1,162 @@
+#include <algorithm>
+
+#include "tile_bitmap.hpp"
+
+namespace cpu
+{
+	void tile_bitmap::resize(int width, int height)
+	{
+		width_ = width;
+		height_ = height;
+		tiles_x_ = (width + tile_size - 1) / tile_size;
+		tiles_y_ = (height + tile_size - 1) / tile_size;
+		words_per_row_ = (tiles_x_ + 63) / 64;
+
+		bits_.assign(static_cast<size_t>(words_per_row_) * tiles_y_, 0);
+		mark_all();
+	}
+
+	int tile_bitmap::width() const
+	{
+		return width_;
+	}
+
+	int tile_bitmap::height() const
+	{
+		return height_;
+	}
+
+	rect tile_bitmap::tile_span(const rect& r, bool inner) const
+	{
+		const auto area = intersect(r, { 0, 0, width_, height_ });
+		if (area.empty())
+			return {};
+
+		if (!inner)
+		{
+			return
+			{
+				area.left / tile_size,
+				area.top / tile_size,
+				(area.right + tile_size - 1) / tile_size,
+				(area.bottom + tile_size - 1) / tile_size,
+			};
+		}
+
+		return
+		{
+			(area.left + tile_size - 1) / tile_size,
+			(area.top + tile_size - 1) / tile_size,
+			area.right == width_ ? tiles_x_ : area.right / tile_size,
+			area.bottom == height_ ? tiles_y_ : area.bottom / tile_size,
+		};
+	}
+
+	void tile_bitmap::mark(const rect& r)
+	{
+		const auto span = tile_span(r, false);
+
+		for (int ty = span.top; ty < span.bottom; ty++)
+		{
+			auto* row = bits_.data() + static_cast<size_t>(words_per_row_) * ty;
+
+			for (int tx = span.left; tx < span.right; tx++)
+				row[tx / 64] |= uint64_t{ 1 } << (tx % 64);
+		}
+	}
+
+	void tile_bitmap::mark_all()
+	{
+		mark({ 0, 0, width_, height_ });
+	}
+
+	void tile_bitmap::clear(const rect& r)
+	{
+		const auto span = tile_span(r, true);
+
+		for (int ty = span.top; ty < span.bottom; ty++)
+		{
+			auto* row = bits_.data() + static_cast<size_t>(words_per_row_) * ty;
+
+			for (int tx = span.left; tx < span.right; tx++)
+				row[tx / 64] &= ~(uint64_t{ 1 } << (tx % 64));
+		}
+	}
+
+	bool tile_bitmap::dirty(int tile_x, int tile_y) const
+	{
+		return (bits_[static_cast<size_t>(words_per_row_) * tile_y + tile_x / 64] >> (tile_x % 64)) & 1;
+	}
+
+	bool tile_bitmap::any() const
+	{
+		return std::any_of(bits_.begin(), bits_.end(), [](uint64_t word) { return word != 0; });
+	}
+
+	bool tile_bitmap::any(const rect& r) const
+	{
+		const auto span = tile_span(r, false);
+
+		for (int ty = span.top; ty < span.bottom; ty++)
+		{
+			for (int tx = span.left; tx < span.right; tx++)
+			{
+				if (dirty(tx, ty))
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+	void tile_bitmap::collect(const rect& bounds, std::vector<rect>& out) const
+	{
+		const auto area = intersect(bounds, { 0, 0, width_, height_ });
+		const auto span = tile_span(area, false);
+
+		// runs still growing downwards, in tiles
+		std::vector<rect> open;
+		std::vector<rect> next;
+
+		const auto emit = [&](const rect& tiles)
+		{
+			out.push_back(intersect(area,
+			{
+				tiles.left * tile_size, tiles.top * tile_size,
+				tiles.right * tile_size, tiles.bottom * tile_size,
+			}));
+		};
+
+		for (int ty = span.top; ty <= span.bottom; ty++)
+		{
+			next.clear();
+
+			for (int tx = span.left; ty < span.bottom && tx < span.right; tx++)
+			{
+				if (!dirty(tx, ty))
+					continue;
+
+				const int begin = tx;
+				while (tx < span.right && dirty(tx, ty))
+					tx++;
+
+				next.push_back({ begin, ty, tx, ty + 1 });
+			}
+
+			// both lists are sorted by column, so one pass pairs up equal spans
+			auto it = next.begin();
+			for (const auto& run : open)
+			{
+				while (it != next.end() && it->left < run.left)
+					++it;
+
+				if (it != next.end() && it->left == run.left && it->right == run.right)
+					it->top = run.top;
+				else
+					emit(run);
+			}
+
+			open.swap(next);
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "geometry.hpp"
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	// one bit per tile_size x tile_size tile of a width x height image, used to
+	// remember which parts of a retained frame went stale
+	class tile_bitmap
+	{
+	public:
+		// drops all state, every tile starts out dirty
+		void resize(int width, int height);
+
+		int width() const;
+		int height() const;
+
+		// marks every tile r touches, r is clipped to the image
+		void mark(const rect& r);
+		void mark_all();
+
+		// clears the tiles that lie completely inside r, tiles cut by the right
+		// or bottom edge of the image count as inside when r reaches that edge
+		void clear(const rect& r);
+
+		bool dirty(int tile_x, int tile_y) const;
+		bool any() const;
+
+		// whether any tile r touches is dirty
+		bool any(const rect& r) const;
+
+		// dirty tiles inside bounds as few rects as possible: runs of tiles on a
+		// tile row are joined, then runs spanning the same columns on consecutive
+		// rows. rects are clipped to bounds and appended to out
+		void collect(const rect& bounds, std::vector<rect>& out) const;
+
+	private:
+		rect tile_span(const rect& r, bool inner) const;
+
+		int width_ = 0;
+		int height_ = 0;
+		int tiles_x_ = 0;
+		int tiles_y_ = 0;
+		int words_per_row_ = 0;
+
+		std::vector<uint64_t> bits_;
+	};
+}
@@ -0,0 +1,114 @@
+#include <cstring>
+
+#include "tile_cache.hpp"
+
+namespace cpu
+{
+	tile_cache::tile_cache(size_t capacity) :
+		capacity_(capacity)
+	{
+	}
+
+	size_t tile_cache::capacity() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return capacity_;
+	}
+
+	void tile_cache::set_capacity(size_t capacity)
+	{
+		std::lock_guard lock{ mutex_ };
+
+		capacity_ = capacity;
+		evict();
+	}
+
+	bool tile_cache::lookup(const key& k, uint8_t* dest, ptrdiff_t pitch)
+	{
+		std::lock_guard lock{ mutex_ };
+
+		const auto it = index_.find(k);
+		if (it == index_.end())
+		{
+			misses_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		lru_.splice(lru_.begin(), lru_, it->second);
+
+		const size_t row_size = static_cast<size_t>(k.width) * 4;
+		const auto* src = it->second->pixels.data();
+
+		for (int y = 0; y < k.height; y++)
+			std::memcpy(dest + pitch * y, src + row_size * y, row_size);
+
+		hits_.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void tile_cache::insert(const key& k, const uint8_t* src, ptrdiff_t pitch)
+	{
+		const size_t row_size = static_cast<size_t>(k.width) * 4;
+
+		// copy outside the lock, workers insert tiles concurrently
+		std::vector<uint8_t> pixels(row_size * k.height);
+		for (int y = 0; y < k.height; y++)
+			std::memcpy(pixels.data() + row_size * y, src + pitch * y, row_size);
+
+		std::lock_guard lock{ mutex_ };
+
+		if (pixels.size() > capacity_)
+			return;
+
+		const auto it = index_.find(k);
+		if (it != index_.end())
+		{
+			// two workers raced on the same content
+			lru_.splice(lru_.begin(), lru_, it->second);
+			return;
+		}
+
+		size_ += pixels.size();
+		lru_.push_front({ k, std::move(pixels) });
+		index_.emplace(k, lru_.begin());
+
+		evict();
+	}
+
+	void tile_cache::clear()
+	{
+		std::lock_guard lock{ mutex_ };
+
+		index_.clear();
+		lru_.clear();
+		size_ = 0;
+	}
+
+	size_t tile_cache::size() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return size_;
+	}
+
+	uint64_t tile_cache::hits() const
+	{
+		return hits_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t tile_cache::misses() const
+	{
+		return misses_.load(std::memory_order_relaxed);
+	}
+
+	void tile_cache::evict()
+	{
+		while (size_ > capacity_ && !lru_.empty())
+		{
+			auto& oldest = lru_.back();
+
+			size_ -= oldest.pixels.size();
+			index_.erase(oldest.k);
+			lru_.pop_back();
+		}
+	}
+}
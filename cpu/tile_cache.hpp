@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "tonemapper.hpp"
+
+namespace cpu
+{
+	// tonemapped tiles looked up by the hash of their source pixels, shared by
+	// all monitors. bounded by the bytes of tile data it holds, the least
+	// recently used tiles are dropped first
+	class tile_cache
+	{
+	public:
+		struct key
+		{
+			uint64_t hash = 0;
+			int width = 0;
+			int height = 0;
+			pixel_format format = pixel_format::r8g8b8a8_unorm;
+			float white_level = 0.0f;
+
+			bool operator==(const key& other) const = default;
+		};
+
+		explicit tile_cache(size_t capacity);
+
+		size_t capacity() const;
+		void set_capacity(size_t capacity);
+
+		// copies the cached tile to dest on a hit
+		bool lookup(const key& k, uint8_t* dest, ptrdiff_t pitch);
+		void insert(const key& k, const uint8_t* src, ptrdiff_t pitch);
+
+		void clear();
+
+		size_t size() const;
+		uint64_t hits() const;
+		uint64_t misses() const;
+
+	private:
+		struct entry
+		{
+			key k;
+			std::vector<uint8_t> pixels;
+		};
+
+		struct key_hash
+		{
+			size_t operator()(const key& k) const { return static_cast<size_t>(k.hash); }
+		};
+
+		void evict();
+
+		mutable std::mutex mutex_;
+
+		// most recently used first
+		std::list<entry> lru_;
+		std::unordered_map<key, std::list<entry>::iterator, key_hash> index_;
+
+		size_t capacity_;
+		size_t size_ = 0;
+
+		std::atomic<uint64_t> hits_{ 0 };
+		std::atomic<uint64_t> misses_{ 0 };
+	};
+}
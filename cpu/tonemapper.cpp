@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "tonemapper.hpp"
+#include "kernels.hpp"
+#include "thread_pool.hpp"
+#include "rotate.hpp"
+
+namespace cpu
+{
+	namespace
+	{
+		float3 operator+(float3 a, float3 b) { return { a.r + b.r, a.g + b.g, a.b + b.b }; }
+		float3 operator-(float3 a, float3 b) { return { a.r - b.r, a.g - b.g, a.b - b.b }; }
+		float3 operator*(float3 a, float s) { return { a.r * s, a.g * s, a.b * s }; }
+		float3 operator/(float3 a, float s) { return { a.r / s, a.g / s, a.b / s }; }
+
+		float3 lerp(float3 x, float3 y, float s)
+		{
+			return x + (y - x) * s;
+		}
+
+		float saturate(float x)
+		{
+			// also maps NaN to 0 like the gpu does
+			return x > 0.0f ? (x < 1.0f ? x : 1.0f) : 0.0f;
+		}
+
+		template <typename Fn>
+		float3 per_channel(float3 x, Fn&& fn)
+		{
+			return { fn(x.r), fn(x.g), fn(x.b) };
+		}
+
+		struct tile_job;
+		using tile_fn_t = void(*)(const tile_job& tj, uint32_t tile, const bitmap_view& dest);
+
+		struct tile_job
+		{
+			const render_job* job;
+			placement place;
+			rect clip; // source pixels that land inside dest
+			row_kernel_t kernel;
+			tile_fn_t fn;
+			int tiles_x;
+			uint32_t first_tile;
+		};
+
+		template <pixel_format Format, rotation_t Rotation>
+		void tonemap_tile(const tile_job& tj, uint32_t tile, const bitmap_view& dest)
+		{
+			const auto& job = *tj.job;
+			const auto& src = job.src;
+
+			const int tx = static_cast<int>(tile % tj.tiles_x) * tile_size;
+			const int ty = static_cast<int>(tile / tj.tiles_x) * tile_size;
+
+			const auto area = intersect(tj.clip, { tx, ty, tx + tile_size, ty + tile_size });
+			if (area.empty())
+				return;
+
+			const auto target = to_dest(tj.place, area);
+
+			const auto* in = src.data + src.pitch * area.top + area.left * bytes_per_pixel(Format);
+			auto* out = dest.data + dest.pitch * target.top + target.left * 4;
+
+			if constexpr (Rotation == rotation_t::identity)
+			{
+				for (int y = 0; y < area.height(); y++)
+					tj.kernel(in + src.pitch * y, reinterpret_cast<uint32_t*>(out + dest.pitch * y), area.width(), job.white_level);
+			}
+			else
+			{
+				// tonemap into l1 first, then rotate the whole block out in one go
+				uint32_t block[tile_size * tile_size];
+
+				for (int y = 0; y < area.height(); y++)
+					tj.kernel(in + src.pitch * y, block + tile_size * y, area.width(), job.white_level);
+
+				rotate_copy(reinterpret_cast<const uint8_t*>(block), tile_size * 4, area.width(), area.height(), out, dest.pitch, Rotation);
+			}
+		}
+
+		template <pixel_format Format>
+		constexpr tile_fn_t tile_fns[] =
+		{
+			tonemap_tile<Format, rotation_t::identity>,
+			tonemap_tile<Format, rotation_t::rotate90>,
+			tonemap_tile<Format, rotation_t::rotate180>,
+			tonemap_tile<Format, rotation_t::rotate270>,
+		};
+
+		tile_fn_t select_tile_fn(pixel_format format, rotation_t rotation)
+		{
+			const auto index = static_cast<size_t>(rotation);
+
+			if (format == pixel_format::r16g16b16a16_float)
+				return tile_fns<pixel_format::r16g16b16a16_float>[index];
+
+			return tile_fns<pixel_format::r8g8b8a8_unorm>[index];
+		}
+	}
+
+	float half_to_float(uint16_t value)
+	{
+		const uint32_t sign = (value & 0x8000u) << 16;
+		uint32_t exponent = (value >> 10) & 0x1f;
+		uint32_t mantissa = value & 0x3ff;
+
+		uint32_t bits;
+
+		if (exponent == 0x1f)
+		{
+			// inf / nan
+			bits = sign | 0x7f800000u | (mantissa << 13);
+		}
+		else if (exponent)
+		{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+		else if (mantissa)
+		{
+			// denormal, renormalize it
+			exponent = 113;
+			while (!(mantissa & 0x400))
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+
+			bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+		}
+		else
+		{
+			bits = sign;
+		}
+
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	float3 soft_clip(float3 x)
+	{
+		return per_channel(x, [](float v)
+		{
+			return saturate((1.0f + v - std::sqrt(1.0f - 1.99f * v + v * v)) / 1.995f);
+		});
+	}
+
+	float3 linear_tonemap(float3 x)
+	{
+		constexpr float z = 0.8f;
+		constexpr float d = 2.5f;
+
+		return per_channel(x, [](float v)
+		{
+			return v >= z ? (v - z) / d + z : v;
+		});
+	}
+
+	float3 bt2020_inv_gamma(float3 x)
+	{
+		return per_channel(x, [](float v)
+		{
+			return v > 0.00313066844250063f ? 1.055f * std::pow(std::clamp(v, 0.0f, 10000.0f), 1.0f / 2.4f) - 0.055f : 12.92f * v;
+		});
+	}
+
+	float rgb_to_luma(float3 x)
+	{
+		return 0.213f * x.r + 0.715f * x.g + 0.072f * x.b;
+	}
+
+	// Khronos PBR Neutral Tone Mapper
+	// https://github.com/KhronosGroup/ToneMapping/tree/main/PBR_Neutral
+	float3 neutral(float3 color)
+	{
+		constexpr float start_compression = 0.8f - 0.04f;
+		constexpr float desaturation = 0.15f;
+
+		const float x = std::min(color.r, std::min(color.g, color.b));
+		const float offset = x < 0.08f ? x - 6.25f * x * x : 0.04f;
+		color = color - float3{ offset, offset, offset };
+
+		const float peak = std::max(color.r, std::max(color.g, color.b));
+		if (peak < start_compression)
+			return color;
+
+		constexpr float d = 1.0f - start_compression;
+		const float new_peak = 1.0f - d * d / (peak + d - start_compression);
+		color = color * (new_peak / peak);
+
+		const float g = 1.0f - 1.0f / (desaturation * (peak - new_peak) + 1.0f);
+		return lerp(color, { new_peak, new_peak, new_peak }, g);
+	}
+
+	float3 tonemap_hdr(float3 src_color, float white_level)
+	{
+		const auto input_color = per_channel(src_color, [](float v) { return std::clamp(v, 0.0f, 10000.0f); }) / (white_level / 80.0f);
+		const auto linear_color = bt2020_inv_gamma(input_color);
+
+		const auto linear_result = linear_tonemap(linear_color);
+		const auto neutral_result = neutral(linear_color);
+
+		const float linear_luma = rgb_to_luma(linear_result);
+		if (linear_luma < 0.8f)
+			return linear_result;
+
+		const float neutral_luma = rgb_to_luma(neutral_result);
+		return neutral_result / neutral_luma * linear_luma;
+	}
+
+	uint32_t pack_bgra(float3 color)
+	{
+		const auto to_unorm = [](float v)
+		{
+			return static_cast<uint32_t>(saturate(v) * 255.0f + 0.5f);
+		};
+
+		return to_unorm(color.b) | (to_unorm(color.g) << 8) | (to_unorm(color.r) << 16) | 0xff000000u;
+	}
+
+	void tonemap(std::span<const render_job> jobs, const bitmap_view& dest, thread_pool& pool)
+	{
+		const auto& kernels = select_row_kernels();
+
+		std::vector<tile_job> tile_jobs;
+		tile_jobs.reserve(jobs.size());
+
+		uint32_t total_tiles = 0;
+
+		for (const auto& job : jobs)
+		{
+			const auto& src = job.src;
+
+			if (src.width <= 0 || src.height <= 0)
+				continue;
+
+			tile_job tj;
+			tj.job = &job;
+			tj.place = { src.width, src.height, job.x, job.y, job.rotation };
+			tj.clip = to_source(tj.place, intersect(to_dest(tj.place, { 0, 0, src.width, src.height }), { 0, 0, dest.width, dest.height }));
+			tj.kernel = src.format == pixel_format::r16g16b16a16_float ? kernels.hdr : kernels.sdr;
+			tj.fn = select_tile_fn(src.format, job.rotation);
+			tj.tiles_x = (src.width + tile_size - 1) / tile_size;
+			tj.first_tile = total_tiles;
+
+			total_tiles += tj.tiles_x * ((src.height + tile_size - 1) / tile_size);
+			tile_jobs.push_back(tj);
+		}
+
+		pool.parallel_for(total_tiles, [&](uint32_t tile)
+		{
+			const auto it = std::upper_bound(tile_jobs.begin(), tile_jobs.end(), tile, [](uint32_t t, const tile_job& tj)
+			{
+				return t < tj.first_tile;
+			}) - 1;
+
+			it->fn(*it, tile - it->first_tile, dest);
+		});
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+#include "geometry.hpp"
+
+// CPU port of tonemapper.hlsl, used when the compute shader path is unavailable.
+// Everything in here is plain C++ so it can be built and checked without a GPU.
+namespace cpu
+{
+	class thread_pool;
+
+	enum class pixel_format
+	{
+		r8g8b8a8_unorm,
+		r16g16b16a16_float,
+	};
+
+	constexpr int bytes_per_pixel(pixel_format format)
+	{
+		return format == pixel_format::r16g16b16a16_float ? 8 : 4;
+	}
+
+	// a mapped desktop duplication frame
+	struct image_view
+	{
+		const uint8_t* data = nullptr;
+		int width = 0;
+		int height = 0;
+		ptrdiff_t pitch = 0;
+		pixel_format format = pixel_format::r8g8b8a8_unorm;
+	};
+
+	// B8G8R8A8 destination, same layout as the virtual desktop texture
+	struct bitmap_view
+	{
+		uint8_t* data = nullptr;
+		int width = 0;
+		int height = 0;
+		ptrdiff_t pitch = 0;
+	};
+
+	// one monitor worth of work
+	struct render_job
+	{
+		image_view src;
+		int x = 0;
+		int y = 0;
+		rotation_t rotation = rotation_t::identity;
+		float white_level = 200.0f;
+	};
+
+	// the cpu counterpart of a dispatch group, sized to keep a tile of source and
+	// output in l2 while a worker is on it
+	constexpr int tile_size = 64;
+
+	struct float3
+	{
+		float r, g, b;
+	};
+
+	float half_to_float(uint16_t value);
+
+	float3 soft_clip(float3 x);
+	float3 linear_tonemap(float3 x);
+	float3 bt2020_inv_gamma(float3 x);
+	float rgb_to_luma(float3 x);
+	float3 neutral(float3 color);
+
+	// body of the shader's main for a single hdr pixel
+	float3 tonemap_hdr(float3 src_color, float white_level);
+
+	uint32_t pack_bgra(float3 color);
+
+	// tonemaps all jobs into dest at (x, y), rotated the same way calc_dest_pos does
+	// and dropping whatever falls outside of dest. every job is split into tiles,
+	// all the tiles are run as a single job on pool
+	void tonemap(std::span<const render_job> jobs, const bitmap_view& dest, thread_pool& pool);
+}
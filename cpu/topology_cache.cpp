@@ -0,0 +1,64 @@
+#include "topology_cache.hpp"
+
+namespace cpu
+{
+	topology_cache::topology_cache(topology_provider& provider) :
+		provider_(provider)
+	{
+	}
+
+	bool topology_cache::get(size_t output, output_info& info)
+	{
+		std::lock_guard lock{ mutex_ };
+
+		if (entries_.size() <= output)
+			entries_.resize(output + 1);
+
+		auto& e = entries_[output];
+
+		// read before querying, an invalidate that races the query leaves the
+		// entry stale instead of marking old info current
+		const auto generation = generation_.load(std::memory_order_acquire);
+
+		if (e.valid && e.generation == generation)
+		{
+			hits_.fetch_add(1, std::memory_order_relaxed);
+			info = e.info;
+			return true;
+		}
+
+		misses_.fetch_add(1, std::memory_order_relaxed);
+
+		if (!provider_.query(output, e.info))
+		{
+			e.valid = false;
+			return false;
+		}
+
+		e.generation = generation;
+		e.valid = true;
+
+		info = e.info;
+		return true;
+	}
+
+	void topology_cache::invalidate()
+	{
+		generation_.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	uint64_t topology_cache::generation() const
+	{
+		return generation_.load(std::memory_order_acquire);
+	}
+
+	uint64_t topology_cache::hits() const
+	{
+		return hits_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t topology_cache::misses() const
+	{
+		return misses_.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace cpu
+{
+	// where an output sits on the virtual desktop and how it shows sdr content
+	struct output_info
+	{
+		rect area;
+		rotation_t rotation = rotation_t::identity;
+		bool hdr = false;
+		float sdr_white_level = 200.0f;
+	};
+
+	// asks the os about an output, which is slow enough to keep out of every capture
+	class topology_provider
+	{
+	public:
+		virtual ~topology_provider() = default;
+
+		// false when the output could not be queried, nothing is cached then
+		virtual bool query(size_t output, output_info& info) = 0;
+	};
+
+	// output_info of every output, queried once and then kept until the
+	// topology is invalidated by a display change or a new set of outputs
+	class topology_cache
+	{
+	public:
+		explicit topology_cache(topology_provider& provider);
+
+		// from the cache, or from the provider when the cached info is older
+		// than the last invalidate
+		bool get(size_t output, output_info& info);
+
+		// safe to call from any thread, e.g. a window procedure
+		void invalidate();
+		uint64_t generation() const;
+
+		uint64_t hits() const;
+		uint64_t misses() const;
+
+	private:
+		struct entry
+		{
+			output_info info;
+			uint64_t generation = 0;
+			bool valid = false;
+		};
+
+		topology_provider& provider_;
+
+		std::mutex mutex_;
+		std::vector<entry> entries_;
+
+		// starts at 1 so a fresh entry is never current
+		std::atomic<uint64_t> generation_{ 1 };
+
+		std::atomic<uint64_t> hits_{ 0 };
+		std::atomic<uint64_t> misses_{ 0 };
+	};
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "view_cache.hpp"
+
+namespace cpu
+{
+	view_cache::view_cache(view_device& device, unsigned int max_idle) :
+		device_(device), max_idle_(max_idle)
+	{
+	}
+
+	view_cache::~view_cache()
+	{
+		clear();
+	}
+
+	void* view_cache::get(void* texture, uint32_t format, view_device::view_kind kind)
+	{
+		std::lock_guard lock{ mutex_ };
+
+		// the view holds on to its texture, no other texture can show up at the
+		// same address while the entry is around
+		const auto it = std::find_if(entries_.begin(), entries_.end(), [&](const entry& e)
+		{
+			return e.texture == texture && e.format == format && e.kind == kind;
+		});
+
+		if (it != entries_.end())
+		{
+			hits_++;
+			it->last_used = epoch_;
+			return it->view;
+		}
+
+		auto* view = device_.create_view(texture, format, kind);
+		if (!view)
+			return nullptr;
+
+		creations_++;
+		entries_.push_back({ texture, format, kind, view, epoch_ });
+		return view;
+	}
+
+	void view_cache::forget(void* texture)
+	{
+		std::lock_guard lock{ mutex_ };
+
+		std::erase_if(entries_, [&](const entry& e)
+		{
+			if (e.texture != texture)
+				return false;
+
+			device_.release_view(e.view);
+			return true;
+		});
+	}
+
+	void view_cache::trim()
+	{
+		std::lock_guard lock{ mutex_ };
+
+		epoch_++;
+
+		std::erase_if(entries_, [&](const entry& e)
+		{
+			if (epoch_ - e.last_used <= max_idle_)
+				return false;
+
+			device_.release_view(e.view);
+			return true;
+		});
+	}
+
+	void view_cache::clear()
+	{
+		std::lock_guard lock{ mutex_ };
+
+		for (const auto& e : entries_)
+			device_.release_view(e.view);
+
+		entries_.clear();
+	}
+
+	size_t view_cache::size() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return entries_.size();
+	}
+
+	uint64_t view_cache::hits() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return hits_;
+	}
+
+	uint64_t view_cache::creations() const
+	{
+		std::lock_guard lock{ mutex_ };
+		return creations_;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cpu
+{
+	// the part of d3d11 view_cache drives, so the cache can run against a fake
+	// that counts what it makes. textures and views are opaque handles
+	class view_device
+	{
+	public:
+		enum class view_kind
+		{
+			shader_resource,
+			unordered_access,
+		};
+
+		virtual ~view_device() = default;
+
+		// null when the view could not be made. a view keeps its texture alive
+		virtual void* create_view(void* texture, uint32_t format, view_kind kind) = 0;
+		virtual void release_view(void* view) = 0;
+	};
+
+	// views of the textures that are rendered from and to on every capture,
+	// made once per texture, format and kind instead of per render. a cached
+	// view keeps its texture alive, so views that were not asked for during
+	// the last max_idle trims are let go of. safe to use from several threads
+	// as long as the device is
+	class view_cache
+	{
+	public:
+		explicit view_cache(view_device& device, unsigned int max_idle = 8);
+		~view_cache();
+
+		view_cache(const view_cache&) = delete;
+		view_cache& operator=(const view_cache&) = delete;
+
+		// the cached view, or a new one. null when the device failed to make it
+		void* get(void* texture, uint32_t format, view_device::view_kind kind);
+
+		// releases the views of texture, for a texture that is about to be dropped
+		void forget(void* texture);
+
+		// once per capture, releases the views left idle for too long
+		void trim();
+
+		// releases every view, none may be bound anymore
+		void clear();
+
+		size_t size() const;
+		uint64_t hits() const;
+		uint64_t creations() const;
+
+	private:
+		struct entry
+		{
+			void* texture;
+			uint32_t format;
+			view_device::view_kind kind;
+			void* view;
+			uint64_t last_used;
+		};
+
+		view_device& device_;
+		unsigned int max_idle_;
+
+		mutable std::mutex mutex_;
+		std::vector<entry> entries_;
+		uint64_t epoch_ = 0;
+
+		uint64_t hits_ = 0;
+		uint64_t creations_ = 0;
+	};
+}
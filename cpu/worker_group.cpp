@@ -0,0 +1,132 @@
+#include <utility>
+
+#include "worker_group.hpp"
+
+namespace cpu
+{
+	worker_group::~worker_group()
+	{
+		{
+			std::lock_guard lock{ mutex_ };
+			stop_ = true;
+		}
+
+		wake_.notify_all();
+
+		for (auto& thread : threads_)
+			thread.join();
+	}
+
+	void worker_group::run(uint32_t count, const std::function<void(uint32_t)>& fn)
+	{
+		if (!count)
+			return;
+
+		if (count == 1)
+		{
+			fn(0);
+			return;
+		}
+
+		std::lock_guard submit{ submit_mutex_ };
+
+		// job 0 is the caller's, worker n runs job n + 1
+		while (threads_.size() < count - 1)
+			threads_.emplace_back(&worker_group::worker_main, this, static_cast<uint32_t>(threads_.size() + 1));
+
+		{
+			std::lock_guard lock{ mutex_ };
+
+			fn_ = &fn;
+			count_ = count;
+			pending_ = count;
+			error_ = nullptr;
+			generation_++;
+		}
+
+		wake_.notify_all();
+
+		std::exception_ptr error;
+
+		try
+		{
+			fn(0);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		finish(error);
+
+		std::unique_lock lock{ mutex_ };
+		done_.wait(lock, [this] { return pending_ == 0; });
+
+		fn_ = nullptr;
+
+		if (error_)
+			std::rethrow_exception(std::exchange(error_, nullptr));
+	}
+
+	worker_group& worker_group::shared()
+	{
+		// never destroyed, same as the thread pool
+		static auto* group = new worker_group{};
+		return *group;
+	}
+
+	void worker_group::worker_main(uint32_t index)
+	{
+		uint64_t seen = 0;
+
+		while (true)
+		{
+			const std::function<void(uint32_t)>* fn = nullptr;
+
+			{
+				std::unique_lock lock{ mutex_ };
+				wake_.wait(lock, [&]
+				{
+					return stop_ || generation_ != seen;
+				});
+
+				if (stop_)
+					return;
+
+				seen = generation_;
+
+				if (index >= count_)
+					continue;
+
+				fn = fn_;
+			}
+
+			std::exception_ptr error;
+
+			try
+			{
+				(*fn)(index);
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			finish(error);
+		}
+	}
+
+	void worker_group::finish(std::exception_ptr error)
+	{
+		{
+			std::lock_guard lock{ mutex_ };
+
+			if (error && !error_)
+				error_ = error;
+
+			pending_--;
+		}
+
+		done_.notify_all();
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpu
+{
+	// runs a handful of jobs at the same time, a thread each. unlike thread_pool
+	// a job may block on the gpu or the os for a while, and may hand its own
+	// work to thread_pool. threads are made on first use and then kept
+	class worker_group
+	{
+	public:
+		worker_group() = default;
+		~worker_group();
+
+		worker_group(const worker_group&) = delete;
+		worker_group& operator=(const worker_group&) = delete;
+
+		// runs fn(i) for every i in [0, count) concurrently, fn(0) on the calling
+		// thread, and blocks until all of them finished. the first exception a
+		// job threw is rethrown here once the others are done
+		void run(uint32_t count, const std::function<void(uint32_t)>& fn);
+
+		static worker_group& shared();
+
+	private:
+		void worker_main(uint32_t index);
+		void finish(std::exception_ptr error);
+
+		std::vector<std::thread> threads_;
+
+		std::mutex submit_mutex_;
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		uint64_t generation_ = 0;
+		uint32_t count_ = 0;
+		uint32_t pending_ = 0;
+		bool stop_ = false;
+
+		const std::function<void(uint32_t)>* fn_ = nullptr;
+		std::exception_ptr error_;
+	};
+}
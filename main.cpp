@@ -4,11 +4,18 @@
 #include <dxgi.h>
 #include <dxgi1_6.h>
 #include <d3d11.h>
+#include <d3d11_4.h>
 #include <d3dcompiler.h>
 
+#include <algorithm>
 #include <vector>
 #include <format>
 #include <numbers>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
 
 #include <MinHook.h>
 
@@ -16,6 +23,24 @@
 
 #include "monitor.hpp"
 
+#include "cpu/tonemapper.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/frame_cache.hpp"
+#include "cpu/tile_cache.hpp"
+#include "cpu/readback_ring.hpp"
+#include "cpu/strided_copy.hpp"
+#include "cpu/dib_target.hpp"
+#include "cpu/pixel_pool.hpp"
+#include "cpu/band_stream.hpp"
+#include "cpu/capture_thread.hpp"
+#include "cpu/worker_group.hpp"
+#include "cpu/topology_cache.hpp"
+#include "cpu/monitor_batch.hpp"
+#include "cpu/view_cache.hpp"
+#include "cpu/output_diff.hpp"
+#include "cpu/capture_service.hpp"
+#include "cpu/capture_watchdog.hpp"
+
 #include "utils/com_ptr.hpp"
 #include "utils/trampoline.hpp"
 
@@ -25,24 +50,255 @@ namespace
 	com_ptr<ID3D11DeviceContext> ctx;
 	com_ptr<ID3D11ComputeShader> render_cs;
 	com_ptr<ID3D11Texture2D> virtual_desktop_tex;
+	com_ptr<ID3D11Texture2D> band_tex;
 	com_ptr<ID3D11Buffer> render_const_buffer;
 
 	int w = 0, h = 0;
 
+	// tonemap on the cpu when compute shaders are not available
+	bool use_cpu_backend = false;
+
+	// whether the immediate context may be used from the monitor workers
+	bool concurrent_monitors = false;
+
+	// a row of the shader's parameter table
 	struct render_constant_buffer_t
 	{
 		float white_level = 200.0f;
 		uint32_t is_hdr = 0;
 
-		float __gap[2];
+		uint32_t src_offset[2];
 
 		float transform_matrix[3][4];
-	} render_cb_data;
+
+		uint32_t src_extent[2];
+
+		uint32_t src_size[2];
+	};
+
+	// the most monitors a single dispatch takes, MAX_MONITORS in the shader
+	constexpr size_t max_batched_monitors = 8;
+
+	// tonemap all monitors of a cpu backend request as a single job instead of
+	// a job per monitor
+	constexpr bool batch_monitors = true;
 
 	HINSTANCE self_instance;
 
 	std::vector<std::unique_ptr<monitor>> monitors;
 
+	// the output each of monitors was made for, what the next enumeration is
+	// diffed against
+	std::vector<cpu::output_key> monitor_outputs;
+
+	// start bringing up the device, duplications and shader while the host is
+	// still loading instead of inside its first BitBlt
+	constexpr bool prewarm_at_load = true;
+
+	// resolves once the warm-up is done, nothing may touch the device before.
+	// set from the loader lock or the first BitBlt while other threads may be
+	// reading it, so it is only touched under warm_up_mutex and read as a copy
+	std::mutex warm_up_mutex;
+	std::shared_future<bool> warmed_up;
+
+	// keep the last requested rect captured on a thread of its own, a BitBlt
+	// then only copies out the latest frame. off by default, it costs three
+	// frame buffers and keeps the gpu capturing while requests come in. set it
+	// to true and rebuild to turn it on
+	constexpr bool background_capture = false;
+
+	// the oldest frame the background thread may answer a BitBlt with
+	constexpr auto background_max_age = std::chrono::milliseconds(33);
+
+	// the background thread stops capturing once nobody asked for this long
+	constexpr auto background_idle_after = std::chrono::seconds(2);
+
+	// the device, context and monitors, shared by the hook and the background thread
+	std::mutex device_mutex;
+
+	// started by the warm-up when background_capture is set, never destroyed
+	cpu::capture_thread* background_thread = nullptr;
+
+	// in milliseconds, to compare first capture latency with and without prewarm_at_load
+	struct startup_timing_t
+	{
+		double device = 0;
+		double monitors = 0;
+		double duplication = 0;
+		double shader = 0;
+
+		// how long the first desktop BitBlt waited for the warm-up
+		double wait = 0;
+		// the first desktop BitBlt from entering the hook to returning
+		double first_capture = 0;
+	} startup_timing;
+
+	// the per output queries behind topology
+	class dxgi_topology_provider : public cpu::topology_provider
+	{
+	public:
+		bool query(size_t output, cpu::output_info& info) override
+		{
+			if (output >= monitors.size())
+				return false;
+
+			return monitors[output]->query_info(info);
+		}
+	} topology_provider;
+
+	// invalidated whenever monitors is rebuilt or the display configuration
+	// changes, its generation also keys the frame cache
+	cpu::topology_cache topology{ topology_provider };
+
+	// set by the display listener, the next request enumerates the monitors again
+	std::atomic<bool> displays_changed = false;
+
+	// short enough that a burst of BitBlt calls from one screenshot shares a frame
+	constexpr auto frame_cache_ttl = std::chrono::milliseconds(50);
+	cpu::frame_cache last_frame{ frame_cache_ttl };
+
+	// about two 4k monitors worth of tonemapped tiles
+	constexpr size_t tile_cache_capacity = 64ull << 20;
+	cpu::tile_cache tonemapped_tiles{ tile_cache_capacity };
+
+	// frames bigger than this are produced and delivered a band at a time, so
+	// a capture holds a couple of bands instead of several whole frames
+	constexpr size_t stream_threshold = 128ull << 20;
+
+	// rows per band when streaming, two bands of three 8k monitors in fp16 are
+	// about 50mb
+	constexpr int stream_band_height = 128;
+
+	// staging textures for readback_ring, on the global device and context
+	class d3d11_readback_device : public cpu::readback_device
+	{
+	public:
+		void* create_staging(int width, int height, uint32_t format) override
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			desc.Width = width;
+			desc.Height = height;
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = static_cast<DXGI_FORMAT>(format);
+			desc.SampleDesc.Count = 1;
+			desc.SampleDesc.Quality = 0;
+			desc.Usage = D3D11_USAGE_STAGING;
+			desc.BindFlags = 0;
+			desc.MiscFlags = 0;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+			ID3D11Texture2D* texture = nullptr;
+			HRESULT hr = device->CreateTexture2D(&desc, nullptr, &texture);
+
+			if (FAILED(hr))
+			{
+				printf("create_staging failed, hr = 0x%x\n", hr);
+				return nullptr;
+			}
+
+			return texture;
+		}
+
+		void release_staging(void* texture) override
+		{
+			static_cast<ID3D11Texture2D*>(texture)->Release();
+		}
+
+		map_status map(void* texture, bool do_not_wait, cpu::mapped_view& mapped) override
+		{
+			// a blocking map holds the context lock until the gpu is done, the
+			// other monitor workers could not even issue their copies meanwhile
+			const bool poll = !do_not_wait && concurrent_monitors;
+
+			D3D11_MAPPED_SUBRESOURCE subresource;
+			HRESULT hr = S_OK;
+
+			while (true)
+			{
+				hr = ctx->Map(static_cast<ID3D11Texture2D*>(texture), 0, D3D11_MAP_READ, do_not_wait || poll ? D3D11_MAP_FLAG_DO_NOT_WAIT : 0, &subresource);
+
+				if (hr != DXGI_ERROR_WAS_STILL_DRAWING || !poll)
+					break;
+
+				std::this_thread::yield();
+			}
+
+			if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+				return map_status::busy;
+
+			if (FAILED(hr))
+				return map_status::failed;
+
+			mapped = { reinterpret_cast<const uint8_t*>(subresource.pData), static_cast<ptrdiff_t>(subresource.RowPitch) };
+			return map_status::ok;
+		}
+
+		void unmap(void* texture) override
+		{
+			ctx->Unmap(static_cast<ID3D11Texture2D*>(texture), 0);
+		}
+	} readback_device;
+
+	cpu::readback_ring readbacks{ readback_device };
+
+	class d3d11_view_device : public cpu::view_device
+	{
+	public:
+		void* create_view(void* texture, uint32_t format, view_kind kind) override
+		{
+			auto* resource = static_cast<ID3D11Texture2D*>(texture);
+			HRESULT hr = S_OK;
+
+			if (kind == view_kind::shader_resource)
+			{
+				D3D11_SHADER_RESOURCE_VIEW_DESC desc = {};
+				desc.Format = static_cast<DXGI_FORMAT>(format);
+				desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+				desc.Texture2D.MipLevels = 1;
+
+				ID3D11ShaderResourceView* view = nullptr;
+				hr = device->CreateShaderResourceView(resource, &desc, &view);
+
+				if (SUCCEEDED(hr))
+					return view;
+			}
+			else
+			{
+				D3D11_UNORDERED_ACCESS_VIEW_DESC desc = {};
+				desc.Format = static_cast<DXGI_FORMAT>(format);
+				desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+				desc.Texture2D.MipSlice = 0;
+
+				ID3D11UnorderedAccessView* view = nullptr;
+				hr = device->CreateUnorderedAccessView(resource, &desc, &view);
+
+				if (SUCCEEDED(hr))
+					return view;
+			}
+
+			printf("create_view failed, hr = 0x%x\n", hr);
+			return nullptr;
+		}
+
+		void release_view(void* view) override
+		{
+			static_cast<IUnknown*>(view)->Release();
+		}
+	} view_device;
+
+	cpu::view_cache views{ view_device };
+
+	ID3D11ShaderResourceView* src_view_of(ID3D11Texture2D* texture, DXGI_FORMAT format)
+	{
+		return static_cast<ID3D11ShaderResourceView*>(views.get(texture, format, cpu::view_device::view_kind::shader_resource));
+	}
+
+	ID3D11UnorderedAccessView* dest_view_of(ID3D11Texture2D* texture)
+	{
+		return static_cast<ID3D11UnorderedAccessView*>(views.get(texture, DXGI_FORMAT_B8G8R8A8_UNORM, cpu::view_device::view_kind::unordered_access));
+	}
+
 	bool init_desktop_dup()
 	{
 		if (device && ctx)
@@ -69,72 +325,138 @@ namespace
 
 		if (device->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0)
 		{
-			printf("init_desktop_dup failed at line %d, feature level < 11.0\n", __LINE__);
+			printf("init_desktop_dup feature level < 11.0, using cpu backend\n");
+			use_cpu_backend = true;
+		}
 
-			device = nullptr;
-			ctx = nullptr;
+		// monitors are acquired and read back from several threads at once
+		com_ptr<ID3D11Multithread> multithread = ctx.as<ID3D11Multithread>();
 
-			return false;
+		if (multithread)
+		{
+			multithread->SetMultithreadProtected(TRUE);
+			concurrent_monitors = true;
+		}
+		else
+		{
+			printf("init_desktop_dup no ID3D11Multithread, monitors are captured one by one\n");
 		}
 
 		return true;
 	}
 
-	void enum_monitors()
+	// the attached outputs of the adapter the device was made on
+	class dxgi_output_enumerator : public cpu::output_enumerator
 	{
-		if (monitors.size())
-			monitors.clear();
-
-		com_ptr<IDXGIDevice> dxgi_device = device.as<IDXGIDevice>();
-		
-		if (!dxgi_device)
-			throw std::runtime_error{ "enum_monitors failed to get as IDXGIDevice" };
-
-		com_ptr<IDXGIAdapter> adapter;
-		HRESULT hr = dxgi_device->GetAdapter(adapter);
-
-		if (FAILED(hr))
+	public:
+		void enumerate(std::vector<cpu::output_key>& out) override
 		{
-			auto msg = std::format("enum_monitors failed to GetAdapter: {:x}", hr);
-			throw std::runtime_error{ msg };
-		}
+			com_ptr<IDXGIDevice> dxgi_device = device.as<IDXGIDevice>();
+			
+			if (!dxgi_device)
+				throw std::runtime_error{ "enum_monitors failed to get as IDXGIDevice" };
 
-		auto outputIndex = 0u;
-		while (true)
-		{
-			com_ptr<IDXGIOutput> output;
-			hr = adapter->EnumOutputs(outputIndex++, output);
+			com_ptr<IDXGIAdapter> adapter;
+			HRESULT hr = dxgi_device->GetAdapter(adapter);
 
-			if (hr == DXGI_ERROR_NOT_FOUND)
+			if (FAILED(hr))
 			{
-				break;
+				auto msg = std::format("enum_monitors failed to GetAdapter: {:x}", hr);
+				throw std::runtime_error{ msg };
 			}
 
-			if (FAILED(hr))
+			auto outputIndex = 0u;
+			while (true)
 			{
-				auto msg = std::format("enum_monitors failed to EnumOutputs: {:x}", hr);
-				throw std::runtime_error{ msg };
+				com_ptr<IDXGIOutput> output;
+				hr = adapter->EnumOutputs(outputIndex++, output);
+
+				if (hr == DXGI_ERROR_NOT_FOUND)
+				{
+					break;
+				}
+
+				if (FAILED(hr))
+				{
+					auto msg = std::format("enum_monitors failed to EnumOutputs: {:x}", hr);
+					throw std::runtime_error{ msg };
+				}
+
+				com_ptr<IDXGIOutput6> output6 = output.as<IDXGIOutput6>();
+				if (!output6)
+					throw std::runtime_error{ "enum_monitors failed to get as IDXGIOutput6" };
+
+				DXGI_OUTPUT_DESC1 desc;
+				hr = output6->GetDesc1(&desc);
+
+				if (FAILED(hr))
+				{
+					printf("enum_monitors failed to GetDesc1: %x", hr);
+					continue;
+				}
+
+				if (desc.AttachedToDesktop)
+				{
+					const auto& r = desc.DesktopCoordinates;
+					const auto rotation = desc.Rotation == DXGI_MODE_ROTATION_ROTATE90 ? cpu::rotation_t::rotate90
+						: desc.Rotation == DXGI_MODE_ROTATION_ROTATE180 ? cpu::rotation_t::rotate180
+						: desc.Rotation == DXGI_MODE_ROTATION_ROTATE270 ? cpu::rotation_t::rotate270
+						: cpu::rotation_t::identity;
+
+					const bool hdr = desc.ColorSpace == DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020;
+
+					out.push_back({ desc.DeviceName, { r.left, r.top, r.right, r.bottom }, rotation, hdr, static_cast<uint32_t>(desc.ColorSpace) });
+					outputs_.push_back(output6);
+				}
 			}
+		}
+
+		// the output behind the i-th key enumerate found
+		const com_ptr<IDXGIOutput6>& output(size_t i) const
+		{
+			return outputs_[i];
+		}
 
-			com_ptr<IDXGIOutput6> output6 = output.as<IDXGIOutput6>();
-			if (!output6)
-				throw std::runtime_error{ "enum_monitors failed to get as IDXGIOutput6" };
+	private:
+		std::vector<com_ptr<IDXGIOutput6>> outputs_;
+	};
 
-			DXGI_OUTPUT_DESC1 desc;
-			hr = output6->GetDesc1(&desc);
+	// brings monitors in line with the attached outputs. monitors of outputs
+	// that did not change are kept along with their duplication, only the
+	// outputs that came, went or changed cost a monitor
+	void enum_monitors()
+	{
+		topology.invalidate();
 
-			if (FAILED(hr))
-			{
-				printf("enum_monitors failed to GetDesc1: %x", hr);
-				continue;
-			}
+		dxgi_output_enumerator enumerator;
+		std::vector<cpu::output_key> outputs;
+		enumerator.enumerate(outputs);
+
+		const auto diff = cpu::diff_outputs(monitor_outputs, outputs);
 
-			if (desc.AttachedToDesktop)
+		std::vector<std::unique_ptr<monitor>> next;
+		next.reserve(outputs.size());
+
+		for (size_t i = 0; i < outputs.size(); i++)
+		{
+			const auto from = diff.kept_from[i];
+
+			if (from != cpu::output_diff::npos)
 			{
-				monitors.push_back(std::make_unique<monitor>(output6, device));
-				continue;
+				// the old IDXGIOutput6 may be dead after a display change, later
+				// duplications have to come from the one found now
+				monitors[from]->set_output(enumerator.output(i));
+				next.push_back(std::move(monitors[from]));
 			}
+			else
+				next.push_back(std::make_unique<monitor>(enumerator.output(i), device));
 		}
+
+		// the monitors of removed outputs go with the old vector
+		monitors = std::move(next);
+		monitor_outputs = std::move(outputs);
+
+		printf("enum_monitors: %zu kept, %zu added, %zu removed\n", diff.kept(), diff.added(), diff.removed.size());
 	}
 
 	bool compile_shader()
@@ -217,36 +539,24 @@ namespace
 		return true;
 	}
 
-	bool render(com_ptr<ID3D11Texture2D> input, com_ptr<ID3D11Texture2D> target)
+	// a duplicated frame, the part of it to render and its row of the parameter table
+	struct render_input
+	{
+		ID3D11Texture2D* texture;
+		cpu::rect region;
+		render_constant_buffer_t constants;
+	};
+
+	// renders all inputs into target, a single dispatch for every
+	// max_batched_monitors of them
+	bool render(std::span<const render_input> inputs, com_ptr<ID3D11Texture2D> target)
 	{
 		if (!compile_shader())
 			return false;
 
-		D3D11_TEXTURE2D_DESC desc;
-		input->GetDesc(&desc);
-
-		render_cb_data.is_hdr = desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT;
-
-		com_ptr<ID3D11ShaderResourceView> src_srv;
-		D3D11_SHADER_RESOURCE_VIEW_DESC src_desc = {};
-		src_desc.Format = desc.Format;
-		src_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		src_desc.Texture2D.MipLevels = 1;
-		HRESULT hr = device->CreateShaderResourceView(input, &src_desc, src_srv);
-
-		if (FAILED(hr))
-		{
-			return false;
-		}
-
-		com_ptr<ID3D11UnorderedAccessView> dest_uav;
-		D3D11_UNORDERED_ACCESS_VIEW_DESC dest_desc = {};
-		dest_desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-		dest_desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
-		dest_desc.Texture2D.MipSlice = 0;
-		hr = device->CreateUnorderedAccessView(target, &dest_desc, dest_uav);
+		auto* dest_uav = dest_view_of(target);
 
-		if (FAILED(hr))
+		if (!dest_uav)
 		{
 			return false;
 		}
@@ -254,14 +564,14 @@ namespace
 		if (!render_const_buffer)
 		{
 			D3D11_BUFFER_DESC cb_desc;
-			cb_desc.ByteWidth = sizeof(render_constant_buffer_t);
+			cb_desc.ByteWidth = sizeof(render_constant_buffer_t) * max_batched_monitors;
 			cb_desc.Usage = D3D11_USAGE_DYNAMIC;
 			cb_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 			cb_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 			cb_desc.MiscFlags = 0;
 			cb_desc.StructureByteStride = 0;
 
-			hr = device->CreateBuffer(&cb_desc, nullptr, render_const_buffer);
+			HRESULT hr = device->CreateBuffer(&cb_desc, nullptr, render_const_buffer);
 
 			if (FAILED(hr))
 				return false;
@@ -269,190 +579,1231 @@ namespace
 			ctx->CSSetConstantBuffers(0, 1, render_const_buffer);
 		}
 
-		D3D11_MAPPED_SUBRESOURCE mapped_cb;
-		ctx->Map(render_const_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_cb);
-		memcpy(mapped_cb.pData, &render_cb_data, sizeof(render_constant_buffer_t));
-		ctx->Unmap(render_const_buffer, 0);
+		for (size_t first = 0; first < inputs.size(); first += max_batched_monitors)
+		{
+			const auto count = inputs.size() - first < max_batched_monitors ? inputs.size() - first : max_batched_monitors;
+
+			render_constant_buffer_t table[max_batched_monitors] = {};
+			ID3D11ShaderResourceView* src_srvs[max_batched_monitors] = {};
+
+			// as big as the biggest part, smaller parts return early
+			UINT groups_x = 0;
+			UINT groups_y = 0;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& input = inputs[first + i];
+				const auto& region = input.region;
+
+				D3D11_TEXTURE2D_DESC desc;
+				input.texture->GetDesc(&desc);
+
+				auto& row = table[i];
+				row = input.constants;
+				row.is_hdr = desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT;
+				row.src_offset[0] = region.left;
+				row.src_offset[1] = region.top;
+				row.src_extent[0] = region.width();
+				row.src_extent[1] = region.height();
+				row.src_size[0] = desc.Width;
+				row.src_size[1] = desc.Height;
 
-		ctx->CSSetShader(render_cs, nullptr, 0);
-		ctx->CSSetShaderResources(0, 1, src_srv);
-		ctx->CSSetUnorderedAccessViews(0, 1, dest_uav, nullptr);
-		ctx->Dispatch((desc.Width + 15) / 16, (desc.Height + 15) / 16, 1);
+				src_srvs[i] = src_view_of(input.texture, desc.Format);
 
-		ctx->CSSetShader(nullptr, nullptr, 0);
+				if (!src_srvs[i])
+				{
+					return false;
+				}
 
-		src_srv = nullptr;
-		ctx->CSSetShaderResources(0, 1, src_srv);
+				const UINT x = (region.width() + 15) / 16;
+				const UINT y = (region.height() + 15) / 16;
 
-		dest_uav = nullptr;
-		ctx->CSSetUnorderedAccessViews(0, 1, dest_uav, nullptr);
+				if (x > groups_x)
+					groups_x = x;
+
+				if (y > groups_y)
+					groups_y = y;
+			}
+
+			D3D11_MAPPED_SUBRESOURCE mapped_cb;
+			ctx->Map(render_const_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_cb);
+			memcpy(mapped_cb.pData, table, sizeof(table));
+			ctx->Unmap(render_const_buffer, 0);
+
+			ctx->CSSetShader(render_cs, nullptr, 0);
+			ctx->CSSetShaderResources(0, static_cast<UINT>(count), src_srvs);
+			ctx->CSSetUnorderedAccessViews(0, 1, &dest_uav, nullptr);
+			ctx->Dispatch(groups_x, groups_y, static_cast<UINT>(count));
+
+			ctx->CSSetShader(nullptr, nullptr, 0);
+
+			ID3D11ShaderResourceView* const no_views[max_batched_monitors] = {};
+			ctx->CSSetShaderResources(0, static_cast<UINT>(count), no_views);
+		}
+
+		ID3D11UnorderedAccessView* const no_uav = nullptr;
+		ctx->CSSetUnorderedAccessViews(0, 1, &no_uav, nullptr);
 
 		return true;
 	}
 
-	void capture_frame(std::vector<uint8_t>& buffer, int width, int height, int origin_x, int origin_y)
+	// where the duplicated frame of monitor lands on the requested rect
+	cpu::placement placement_of(const monitor& monitor, const D3D11_TEXTURE2D_DESC& desc, int origin_x, int origin_y)
 	{
-		HRESULT hr = S_OK;
+		const auto [x, y] = monitor.virtual_position();
 
-		if (width != w || height != h)
+		return
 		{
-			if (virtual_desktop_tex)
-			{
-				virtual_desktop_tex = nullptr;
-			}
+			static_cast<int>(desc.Width), static_cast<int>(desc.Height),
+			x - origin_x, y - origin_y,
+			cpu::rotation_from_degrees(monitor.rotation()),
+		};
+	}
 
-			enum_monitors();
+	cpu::pixel_format format_of(const D3D11_TEXTURE2D_DESC& desc)
+	{
+		return desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT ? cpu::pixel_format::r16g16b16a16_float : cpu::pixel_format::r8g8b8a8_unorm;
+	}
 
-			w = width;
-			h = height;
-		}
+	// fills the row of the parameter table of monitor, whose unrotated top left
+	// lands at (offset_x, offset_y) of the render target
+	void set_monitor_constants(render_constant_buffer_t& constants, const monitor& monitor, int offset_x, int offset_y)
+	{
+		const auto rotation = monitor.rotation();
+		const auto rad = rotation * (std::numbers::pi_v<float> / 180.f);
 
-		if (!virtual_desktop_tex)
+		const auto sin_r = std::sinf(rad);
+		const auto cos_r = std::cosf(rad);
+
+		/*
+		*      cos() -sin() Tx
+		* Mt = sin()  cos() Ty
+		*      0       0      1
+		*/
+		constants.transform_matrix[0][0] = cos_r;
+		constants.transform_matrix[0][1] = -sin_r;
+		constants.transform_matrix[0][2] = static_cast<float>(offset_x);
+
+		constants.transform_matrix[1][0] = sin_r;
+		constants.transform_matrix[1][1] = cos_r;
+		constants.transform_matrix[1][2] = static_cast<float>(offset_y);
+
+		constants.transform_matrix[2][0] = 0;
+		constants.transform_matrix[2][1] = 0;
+		constants.transform_matrix[2][2] = 1;
+
+#if _DEBUG
+		printf("transform matrix: \n%.6f %.6f %.6f\n%.6f %.6f %.6f\n%.6f %.6f %.6f\n",
+			   constants.transform_matrix[0][0], constants.transform_matrix[0][1], constants.transform_matrix[0][2],
+			   constants.transform_matrix[1][0], constants.transform_matrix[1][1], constants.transform_matrix[1][2],
+			   constants.transform_matrix[2][0], constants.transform_matrix[2][1], constants.transform_matrix[2][2]
+		);
+#endif
+
+		constants.white_level = monitor.sdr_white_level();
+	}
+
+	// the monitors overlapping the requested rect, their output desc and white
+	// level only queried again after a display change
+	std::vector<monitor*> monitors_in_request(int origin_x, int origin_y)
+	{
+		std::vector<monitor*> result;
+		result.reserve(monitors.size());
+
+		const cpu::rect request{ origin_x, origin_y, origin_x + w, origin_y + h };
+
+		for (size_t i = 0; i < monitors.size(); i++)
 		{
-			D3D11_TEXTURE2D_DESC desc;
-			desc.Width = w;
-			desc.Height = h;
-			desc.MipLevels = 1;
-			desc.ArraySize = 1;
-			desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-			desc.SampleDesc.Count = 1;
-			desc.SampleDesc.Quality = 0;
-			desc.Usage = D3D11_USAGE_DEFAULT;
-			desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
-			desc.MiscFlags = 0;
-			desc.CPUAccessFlags = 0;
+			cpu::output_info info;
 
-			hr = device->CreateTexture2D(&desc, nullptr, virtual_desktop_tex);
-			if (FAILED(hr))
-			{
-				auto msg = std::format("failed to create virtual desktop texture: {:x}", hr);
-				throw std::runtime_error{ msg };
-			}
+			if (topology.get(i, info) && !cpu::intersect(info.area, request).empty())
+				result.push_back(monitors[i].get());
 		}
 
-		for (const auto& monitor : monitors)
+#if _DEBUG
+		printf("topology cache: %llu hits, %llu misses\n", topology.hits(), topology.misses());
+#endif
+
+		return result;
+	}
+
+	// the virtual desktop as the outputs currently span it
+	cpu::rect desktop_bounds()
+	{
+		cpu::rect bounds;
+
+		for (size_t i = 0; i < monitors.size(); i++)
 		{
-			monitor->update_output_desc();
-			const auto [x, y] = monitor->virtual_position();
-			const auto rotation = monitor->rotation();
-			const auto rad = rotation * (std::numbers::pi_v<float> / 180.f);
-
-			const auto sin_r = std::sinf(rad);
-			const auto cos_r = std::cosf(rad);
-
-			/*
-			*      cos() -sin() Tx
-			* Mt = sin()  cos() Ty
-			*      0       0      1
-			*/
-			render_cb_data.transform_matrix[0][0] = cos_r;
-			render_cb_data.transform_matrix[0][1] = -sin_r;
-			render_cb_data.transform_matrix[0][2] = static_cast<float>(x - origin_x);
-
-			render_cb_data.transform_matrix[1][0] = sin_r;
-			render_cb_data.transform_matrix[1][1] = cos_r;
-			render_cb_data.transform_matrix[1][2] = static_cast<float>(y - origin_y);
-
-			render_cb_data.transform_matrix[2][0] = 0;
-			render_cb_data.transform_matrix[2][1] = 0;
-			render_cb_data.transform_matrix[2][2] = 1;
-
-			printf("transform matrix: \n%.6f %.6f %.6f\n%.6f %.6f %.6f\n%.6f %.6f %.6f\n",
-				   render_cb_data.transform_matrix[0][0], render_cb_data.transform_matrix[0][1], render_cb_data.transform_matrix[0][2],
-				   render_cb_data.transform_matrix[1][0], render_cb_data.transform_matrix[1][1], render_cb_data.transform_matrix[1][2],
-				   render_cb_data.transform_matrix[2][0], render_cb_data.transform_matrix[2][1], render_cb_data.transform_matrix[2][2]
-			);
-
-			render_cb_data.white_level = monitor->sdr_white_level();
-
-			auto screenshot = monitor->take_screenshot();
-			if (!render(screenshot, virtual_desktop_tex)) [[unlikely]]
-			{
-				auto name = monitor->name();
-				printf("failed to render monitor %s to virtual desktop texture\n", name.data());
-			}
+			cpu::output_info info;
+
+			if (topology.get(i, info))
+				bounds = cpu::unite(bounds, info.area);
 		}
 
-		D3D11_TEXTURE2D_DESC staging_desc;
-		virtual_desktop_tex->GetDesc(&staging_desc);
-		staging_desc.Usage = D3D11_USAGE_STAGING;
-		staging_desc.BindFlags = 0;
-		staging_desc.MiscFlags = 0;
-		staging_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		return bounds;
+	}
 
-		com_ptr<ID3D11Texture2D> staging_tex;
-		hr = device->CreateTexture2D(&staging_desc, nullptr, staging_tex);
-		if (FAILED(hr))
+	// runs fn(i) for count monitors on workers of their own, so a monitor
+	// waiting for its next frame or its readback does not hold up the others
+	void for_each_monitor(size_t count, const std::function<void(uint32_t)>& fn)
+	{
+		if (concurrent_monitors)
 		{
-			auto msg = std::format("failed to create staging texture: {:x}", hr);
-			throw std::runtime_error{ msg };
+			cpu::worker_group::shared().run(static_cast<uint32_t>(count), fn);
+			return;
 		}
 
-		ctx->CopyResource(staging_tex, virtual_desktop_tex);
-
-		D3D11_MAPPED_SUBRESOURCE mapped;
-		ctx->Map(staging_tex, 0, D3D11_MAP_READ, 0, &mapped);
+		for (uint32_t i = 0; i < count; i++)
+			fn(i);
+	}
 
-		buffer.resize(staging_desc.Width * staging_desc.Height * 4);
+	std::vector<com_ptr<ID3D11Texture2D>> take_screenshots(const std::vector<monitor*>& sources)
+	{
+		std::vector<com_ptr<ID3D11Texture2D>> screenshots(sources.size());
 
-		for (size_t i = 0; i < staging_desc.Height; i++)
+		for_each_monitor(sources.size(), [&](uint32_t i)
 		{
-			const auto* src = reinterpret_cast<uint8_t*>(mapped.pData) + mapped.RowPitch * i;
-			auto* dest = buffer.data() + (staging_desc.Width * 4 * i);
-
-			std::memcpy(dest, src, staging_desc.Width * 4);
-		}
+			screenshots[i] = sources[i]->take_screenshot();
+		});
 
-		ctx->Unmap(staging_tex, 0);
+		return screenshots;
 	}
 
-	trampoline<decltype(BitBlt)> bitblt;
-	BOOL WINAPI bitblt_hook(HDC hdc, int x, int y, int cx, int cy, HDC hdcSrc, int x1, int y1, DWORD rop)
+	// a monitor whose stale tiles are being copied into a staging texture
+	struct monitor_readback
 	{
-		printf("bitblt called\n");
+		monitor* source;
+		cpu::monitor_params params;
+		ID3D11Texture2D* staging_tex;
+	};
+
+	// brings the retained output of monitor up to date inside the requested rect,
+	// only the tiles damaged since the last capture are copied out of the frame.
+	// the copy is only issued here, finish_monitor_cpu picks it up
+	bool begin_monitor_cpu(monitor& monitor, int origin_x, int origin_y, monitor_readback& readback)
+	{
+		auto screenshot = monitor.take_screenshot();
 
-		static bool inited = init_desktop_dup();
+		D3D11_TEXTURE2D_DESC desc;
+		screenshot->GetDesc(&desc);
 
-		if (!inited)
-			return bitblt(hdc, x, y, cx, cy, hdcSrc, x1, y1, rop);
+		readback.source = &monitor;
+		readback.staging_tex = nullptr;
 
-		auto src_window = WindowFromDC(hdcSrc);
-		auto desktop_window = GetDesktopWindow();
+		if (!cpu::make_monitor_params(placement_of(monitor, desc, origin_x, origin_y), format_of(desc), monitor.sdr_white_level(), w, h, readback.params))
+			return false;
 
-		if (src_window != desktop_window)
-			return bitblt(hdc, x, y, cx, cy, hdcSrc, x1, y1, rop);
+		const auto& params = readback.params;
+		const auto& region = params.region;
 
-		std::vector<uint8_t> buffer;
+		auto& retained = monitor.retained();
+		retained.prepare(params.place.width, params.place.height, params.format, params.white_level);
 
-		try
+		std::vector<cpu::rect> stale;
+		retained.pending(region, stale);
+
+		if (stale.empty())
+			return true;
+
+		readback.staging_tex = static_cast<ID3D11Texture2D*>(readbacks.acquire(region.width(), region.height(), desc.Format));
+		if (!readback.staging_tex)
 		{
-			capture_frame(buffer, cx, cy, x1, y1);
+			auto msg = std::format("failed to create cpu staging texture for monitor {}", monitor.name());
+			throw std::runtime_error{ msg };
 		}
-		catch (std::runtime_error e)
+
+		for (const auto& r : stale)
 		{
-			printf("failed to capture_frame, error: \n%s\n", e.what());
-			return bitblt(hdc, x, y, cx, cy, hdcSrc, x1, y1, rop);
+			const D3D11_BOX box
+			{
+				static_cast<UINT>(r.left), static_cast<UINT>(r.top), 0,
+				static_cast<UINT>(r.right), static_cast<UINT>(r.bottom), 1,
+			};
+
+			ctx->CopySubresourceRegion(readback.staging_tex, 0, r.left - region.left, r.top - region.top, 0, screenshot, 0, &box);
 		}
 
-		HBITMAP map = CreateBitmap(cx, cy, 1, 32, buffer.data());
-		HDC src = CreateCompatibleDC(hdc);
-		SelectObject(src, map);
+		return true;
+	}
 
-		auto result = bitblt(hdc, x, y, cx, cy, src, 0, 0, rop & ~CAPTUREBLT);
+	// the stale tiles begin_monitor_cpu copied out, no data when there were none
+	cpu::image_view map_monitor_cpu(const monitor_readback& readback)
+	{
+		if (!readback.staging_tex)
+			return {};
 
-		DeleteDC(src);
-		DeleteObject(map);
+		cpu::mapped_view mapped;
+		if (readbacks.map(readback.staging_tex, mapped) != cpu::readback_device::map_status::ok)
+		{
+			readbacks.unmap(readback.staging_tex);
 
-		return result;
+			auto msg = std::format("failed to map cpu staging texture for monitor {}", readback.source->name());
+			throw std::runtime_error{ msg };
+		}
+
+		const auto& region = readback.params.region;
+		return { mapped.data, region.width(), region.height(), mapped.pitch, readback.params.format };
 	}
 
-	void free_desktop_dup()
+	void finish_monitor_cpu(const monitor_readback& readback, const cpu::bitmap_view& dest)
 	{
-		monitors.clear();
+		auto& retained = readback.source->retained();
+		const auto& params = readback.params;
 
-		render_const_buffer = nullptr;
-		virtual_desktop_tex = nullptr;
-		render_cs = nullptr;
+		if (readback.staging_tex)
+		{
+			retained.update(map_monitor_cpu(readback), params.region, cpu::thread_pool::shared(), &tonemapped_tiles);
+			readbacks.unmap(readback.staging_tex);
+
+#if _DEBUG
+			printf("tile cache %llu hits / %llu misses, %zu bytes\n", tonemapped_tiles.hits(), tonemapped_tiles.misses(), tonemapped_tiles.size());
+#endif
+		}
+
+		retained.compose(params.region, params.visible, dest, cpu::thread_pool::shared());
+	}
+
+	// capture_frame_cpu as one job over all monitors: they are acquired and their
+	// stale tiles copied out on workers of their own, then all of them are
+	// tonemapped and composed in a single pass over the parameter table
+	void capture_frame_cpu_batched(const std::vector<monitor*>& sources, const cpu::bitmap_view& dest, int origin_x, int origin_y)
+	{
+		std::vector<monitor_readback> pending(sources.size());
+
+		// not vector<bool>, the workers write it concurrently
+		std::vector<char> visible(sources.size());
+
+		const auto release = [&]
+		{
+			for (const auto& readback : pending)
+			{
+				if (readback.staging_tex)
+					readbacks.unmap(readback.staging_tex);
+			}
+		};
+
+		try
+		{
+			for_each_monitor(sources.size(), [&](uint32_t i)
+			{
+				visible[i] = begin_monitor_cpu(*sources[i], origin_x, origin_y, pending[i]);
+			});
+
+			ctx->Flush();
+
+			std::vector<cpu::monitor_params> table;
+			std::vector<cpu::retained_frame*> frames;
+			std::vector<cpu::image_view> stale;
+
+			for (size_t i = 0; i < sources.size(); i++)
+			{
+				if (!visible[i])
+					continue;
+
+				table.push_back(pending[i].params);
+				frames.push_back(&sources[i]->retained());
+				stale.push_back(map_monitor_cpu(pending[i]));
+			}
+
+			cpu::render_batch(table, frames, stale, dest, cpu::thread_pool::shared(), &tonemapped_tiles);
+		}
+		catch (...)
+		{
+			release();
+			throw;
+		}
+
+		release();
+
+#if _DEBUG
+		printf("tile cache %llu hits / %llu misses, %zu bytes\n", tonemapped_tiles.hits(), tonemapped_tiles.misses(), tonemapped_tiles.size());
+#endif
+	}
+
+	// whether the monitors leave no part of the requested rect uncovered
+	bool covers_request(int origin_x, int origin_y)
+	{
+		int64_t covered = 0;
+
+		for (const auto& monitor : monitors)
+		{
+			const auto [x, y] = monitor->virtual_position();
+			const auto [width, height] = monitor->resolution();
+
+			const auto area = cpu::intersect({ x, y, x + width, y + height }, { origin_x, origin_y, origin_x + w, origin_y + h });
+			if (!area.empty())
+				covered += static_cast<int64_t>(area.width()) * area.height();
+		}
+
+		return covered >= static_cast<int64_t>(w) * h;
+	}
+
+	void capture_frame_cpu(const cpu::bitmap_view& dest, int origin_x, int origin_y)
+	{
+		const auto sources = monitors_in_request(origin_x, origin_y);
+
+		// dest may be the caller's bitmap, whatever no monitor covers is black.
+		// cleared before the monitors start writing their parts of it
+		if (!covers_request(origin_x, origin_y))
+		{
+			for (int y = 0; y < dest.height; y++)
+				std::memset(dest.data + dest.pitch * y, 0, dest.width * 4);
+		}
+
+		if (batch_monitors)
+		{
+			capture_frame_cpu_batched(sources, dest, origin_x, origin_y);
+			return;
+		}
+
+		// every monitor is acquired, read back and tonemapped on its own, they
+		// land on disjoint parts of dest
+		for_each_monitor(sources.size(), [&](uint32_t i)
+		{
+			monitor_readback readback;
+			if (!begin_monitor_cpu(*sources[i], origin_x, origin_y, readback))
+				return;
+
+			ctx->Flush();
+			finish_monitor_cpu(readback, dest);
+		});
+	}
+
+	// picks up a change of the displays and of the backend. a new request size
+	// costs neither the duplications nor the virtual desktop texture
+	void begin_request(int width, int height)
+	{
+		views.trim();
+
+		if (monitors.empty() || displays_changed.exchange(false))
+			enum_monitors();
+
+		w = width;
+		h = height;
+
+		if (!use_cpu_backend && !compile_shader())
+		{
+			printf("compile_shader failed, falling back to cpu backend\n");
+			use_cpu_backend = true;
+		}
+	}
+
+	void render_frame(const cpu::bitmap_view& dest, int origin_x, int origin_y)
+	{
+		HRESULT hr = S_OK;
+
+		begin_request(dest.width, dest.height);
+
+		if (use_cpu_backend)
+		{
+			capture_frame_cpu(dest, origin_x, origin_y);
+			return;
+		}
+
+		// the virtual desktop texture spans every output, requests of any size
+		// and position render into it and read back their part
+		const auto bounds = desktop_bounds();
+
+		if (bounds.empty())
+		{
+			for (int y = 0; y < dest.height; y++)
+				std::memset(dest.data + dest.pitch * y, 0, dest.width * 4);
+
+			return;
+		}
+
+		if (virtual_desktop_tex)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			virtual_desktop_tex->GetDesc(&desc);
+
+			if (desc.Width != static_cast<UINT>(bounds.width()) || desc.Height != static_cast<UINT>(bounds.height()))
+			{
+				views.forget(virtual_desktop_tex.get());
+				virtual_desktop_tex = nullptr;
+			}
+		}
+
+		if (!virtual_desktop_tex)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			desc.Width = bounds.width();
+			desc.Height = bounds.height();
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.SampleDesc.Quality = 0;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+			desc.MiscFlags = 0;
+			desc.CPUAccessFlags = 0;
+
+			hr = device->CreateTexture2D(&desc, nullptr, virtual_desktop_tex);
+			if (FAILED(hr))
+			{
+				auto msg = std::format("failed to create virtual desktop texture: {:x}", hr);
+				throw std::runtime_error{ msg };
+			}
+
+			// nothing ever renders to the gaps between outputs
+			if (auto* uav = dest_view_of(virtual_desktop_tex))
+			{
+				const UINT zero[4] = {};
+				ctx->ClearUnorderedAccessViewUint(uav, zero);
+			}
+		}
+
+		const auto sources = monitors_in_request(origin_x, origin_y);
+		const auto screenshots = take_screenshots(sources);
+
+		std::vector<render_input> inputs;
+
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			auto* monitor = sources[i];
+			const auto& screenshot = screenshots[i];
+
+			D3D11_TEXTURE2D_DESC desc;
+			screenshot->GetDesc(&desc);
+
+			cpu::monitor_params params;
+			if (!cpu::make_monitor_params(placement_of(*monitor, desc, origin_x, origin_y), format_of(desc), monitor->sdr_white_level(), w, h, params))
+				continue;
+
+			render_input input{ screenshot, params.region };
+
+			const auto [x, y] = monitor->virtual_position();
+			set_monitor_constants(input.constants, *monitor, x - bounds.left, y - bounds.top);
+
+			inputs.push_back(input);
+		}
+
+		if (!render(inputs, virtual_desktop_tex)) [[unlikely]]
+			printf("failed to render monitors to virtual desktop texture\n");
+
+		// whatever of the request lies outside the virtual desktop is black
+		const auto area = cpu::intersect({ origin_x, origin_y, origin_x + w, origin_y + h }, bounds);
+
+		if (area.width() != w || area.height() != h)
+		{
+			for (int y = 0; y < h; y++)
+				std::memset(dest.data + dest.pitch * y, 0, w * 4);
+		}
+
+		if (area.empty())
+			return;
+
+		auto* staging_tex = static_cast<ID3D11Texture2D*>(readbacks.acquire(area.width(), area.height(), DXGI_FORMAT_B8G8R8A8_UNORM));
+		if (!staging_tex)
+			throw std::runtime_error{ "failed to create staging texture" };
+
+		const D3D11_BOX box
+		{
+			static_cast<UINT>(area.left - bounds.left), static_cast<UINT>(area.top - bounds.top), 0,
+			static_cast<UINT>(area.right - bounds.left), static_cast<UINT>(area.bottom - bounds.top), 1,
+		};
+
+		ctx->CopySubresourceRegion(staging_tex, 0, 0, 0, 0, virtual_desktop_tex, 0, &box);
+		ctx->Flush();
+
+		cpu::mapped_view mapped;
+		if (readbacks.map(staging_tex, mapped) != cpu::readback_device::map_status::ok)
+		{
+			readbacks.unmap(staging_tex);
+			throw std::runtime_error{ "failed to map staging texture" };
+		}
+
+		auto* const target = dest.data + dest.pitch * (area.top - origin_y) + (area.left - origin_x) * 4;
+		cpu::strided_copy(mapped.data, mapped.pitch, target, dest.pitch, area.width() * 4, area.height(), cpu::thread_pool::shared());
+
+		readbacks.unmap(staging_tex);
+	}
+
+	// the newest frame any capture has acquired on the monitors under request
+	int64_t latest_present_time(const cpu::rect& request)
+	{
+		int64_t result = 0;
+
+		for (size_t i = 0; i < monitors.size(); i++)
+		{
+			cpu::output_info info;
+
+			if (!topology.get(i, info) || cpu::intersect(info.area, request).empty())
+				continue;
+
+			if (monitors[i]->last_present_time() > result)
+				result = monitors[i]->last_present_time();
+		}
+
+		return result;
+	}
+
+	// dest is width x height, either our own buffer or the caller's dib section
+	void capture_frame(const cpu::bitmap_view& dest, int origin_x, int origin_y)
+	{
+		const cpu::rect request{ origin_x, origin_y, origin_x + dest.width, origin_y + dest.height };
+
+		// a capture of another rect since may have seen newer frames on these monitors
+		if (last_frame.lookup(request, topology.generation(), latest_present_time(request), dest))
+		{
+#if _DEBUG
+			printf("frame cache hit, %llu hits / %llu misses\n", last_frame.hits(), last_frame.misses());
+#endif
+			return;
+		}
+
+		render_frame(dest, origin_x, origin_y);
+		last_frame.store(request, topology.generation(), latest_present_time(request), dest.data, dest.pitch);
+	}
+
+	// capture_frame from any thread, failures are printed and return false
+	bool capture_frame_locked(const cpu::rect& area, const cpu::bitmap_view& dest)
+	{
+		std::lock_guard lock{ device_mutex };
+
+		try
+		{
+			capture_frame(dest, area.left, area.top);
+			return true;
+		}
+		catch (std::runtime_error e)
+		{
+			printf("failed to capture_frame, error: \n%s\n", e.what());
+			return false;
+		}
+	}
+
+	// BitBlt callers on other threads asking this close together, or while a
+	// capture is running, share one capture and get their own part of it
+	constexpr auto coalesce_window = std::chrono::milliseconds(1);
+
+	cpu::capture_service captures{ capture_frame_locked, coalesce_window };
+
+	// how long a BitBlt waits for the hdr capture before it falls back to the
+	// original BitBlt, the capture still finishes and warms the caches
+	constexpr auto capture_budget = std::chrono::milliseconds(50);
+
+	// started by the warm-up, never destroyed
+	cpu::capture_watchdog* watchdog = nullptr;
+
+	// how long ExitProcess waits for late captures before it leaves the device
+	// to the process teardown rather than freeing it under them
+	constexpr auto exit_capture_wait = std::chrono::milliseconds(500);
+
+	// reads the monitors of a streamed capture back through readbacks, a band
+	// sized region at a time
+	class monitor_band_reader : public cpu::band_reader
+	{
+	public:
+		void add(com_ptr<ID3D11Texture2D> screenshot)
+		{
+			screenshots_.push_back(std::move(screenshot));
+		}
+
+		void* request(size_t source, const cpu::rect& region) override
+		{
+			auto& screenshot = screenshots_[source];
+
+			D3D11_TEXTURE2D_DESC desc;
+			screenshot->GetDesc(&desc);
+
+			auto* staging_tex = static_cast<ID3D11Texture2D*>(readbacks.acquire(region.width(), region.height(), desc.Format));
+			if (!staging_tex)
+				throw std::runtime_error{ "failed to create band staging texture" };
+
+			const D3D11_BOX box
+			{
+				static_cast<UINT>(region.left), static_cast<UINT>(region.top), 0,
+				static_cast<UINT>(region.right), static_cast<UINT>(region.bottom), 1,
+			};
+
+			ctx->CopySubresourceRegion(staging_tex, 0, 0, 0, 0, screenshot, 0, &box);
+
+			requests_.push_back({ staging_tex, region.width(), region.height(), format_of(desc) });
+			return staging_tex;
+		}
+
+		cpu::image_view wait(void* request) override
+		{
+			const auto it = std::find_if(requests_.begin(), requests_.end(), [&](const pending& p) { return p.texture == request; });
+
+			cpu::mapped_view mapped;
+			if (it == requests_.end() || readbacks.map(request, mapped) != cpu::readback_device::map_status::ok)
+				throw std::runtime_error{ "failed to map band staging texture" };
+
+			return { mapped.data, it->width, it->height, mapped.pitch, it->format };
+		}
+
+		void release(void* request) override
+		{
+			readbacks.unmap(request);
+			std::erase_if(requests_, [&](const pending& p) { return p.texture == request; });
+		}
+
+	private:
+		struct pending
+		{
+			void* texture;
+			int width;
+			int height;
+			cpu::pixel_format format;
+		};
+
+		std::vector<com_ptr<ID3D11Texture2D>> screenshots_;
+		std::vector<pending> requests_;
+	};
+
+	void capture_frame_cpu_streamed(cpu::band_sink& sink, int origin_x, int origin_y)
+	{
+		const auto monitors_used = monitors_in_request(origin_x, origin_y);
+		auto screenshots = take_screenshots(monitors_used);
+
+		monitor_band_reader reader;
+		std::vector<cpu::band_source> sources;
+
+		for (size_t i = 0; i < monitors_used.size(); i++)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			screenshots[i]->GetDesc(&desc);
+
+			sources.push_back({ placement_of(*monitors_used[i], desc, origin_x, origin_y), monitors_used[i]->sdr_white_level() });
+			reader.add(std::move(screenshots[i]));
+		}
+
+		cpu::stream_bands(sources, w, h, stream_band_height, reader, sink, cpu::thread_pool::shared());
+	}
+
+	// a band that was rendered into band_tex and is being copied to staging_tex
+	struct band_readback
+	{
+		cpu::rect band;
+		ID3D11Texture2D* staging_tex = nullptr;
+	};
+
+	void deliver_band(band_readback& readback, cpu::band_sink& sink)
+	{
+		cpu::mapped_view mapped;
+		if (readbacks.map(readback.staging_tex, mapped) != cpu::readback_device::map_status::ok)
+			throw std::runtime_error{ "failed to map band staging texture" };
+
+		const auto pixels = sink.begin(readback.band);
+		cpu::strided_copy(mapped.data, mapped.pitch, pixels.data, pixels.pitch, w * 4, readback.band.height(), cpu::thread_pool::shared());
+
+		readbacks.unmap(readback.staging_tex);
+		readback.staging_tex = nullptr;
+
+		sink.end(readback.band, pixels);
+	}
+
+	// render_frame a band at a time, every band is rendered into band_tex and
+	// read back while the next one renders
+	void render_frame_streamed(cpu::band_sink& sink, int origin_x, int origin_y)
+	{
+		HRESULT hr = S_OK;
+
+		// the whole frame texture is what streaming does without
+		if (virtual_desktop_tex)
+		{
+			views.forget(virtual_desktop_tex.get());
+			virtual_desktop_tex = nullptr;
+		}
+
+		if (band_tex)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			band_tex->GetDesc(&desc);
+
+			if (desc.Width != static_cast<UINT>(w))
+			{
+				views.forget(band_tex.get());
+				band_tex = nullptr;
+			}
+		}
+
+		if (!band_tex)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			desc.Width = w;
+			desc.Height = stream_band_height;
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.SampleDesc.Quality = 0;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+			desc.MiscFlags = 0;
+			desc.CPUAccessFlags = 0;
+
+			hr = device->CreateTexture2D(&desc, nullptr, band_tex);
+			if (FAILED(hr))
+			{
+				auto msg = std::format("failed to create band texture: {:x}", hr);
+				throw std::runtime_error{ msg };
+			}
+		}
+
+		auto* const band_uav = dest_view_of(band_tex);
+		if (!band_uav)
+			throw std::runtime_error{ "failed to create band texture view" };
+
+		const auto sources = monitors_in_request(origin_x, origin_y);
+		const auto screenshots = take_screenshots(sources);
+
+		std::vector<cpu::placement> places;
+
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			screenshots[i]->GetDesc(&desc);
+
+			places.push_back(placement_of(*sources[i], desc, origin_x, origin_y));
+		}
+
+		band_readback ready;
+		band_readback next;
+
+		try
+		{
+			cpu::for_each_band(places, w, h, stream_band_height, [&](const cpu::rect& band, std::span<const cpu::band_part> parts)
+			{
+				// band_tex still holds the previous band
+				if (!cpu::covers(band, parts))
+				{
+					const UINT zero[4] = {};
+					ctx->ClearUnorderedAccessViewUint(band_uav, zero);
+				}
+
+				std::vector<render_input> inputs;
+
+				for (const auto& part : parts)
+				{
+					const auto& monitor = *sources[part.source];
+					const auto [x, y] = monitor.virtual_position();
+
+					render_input input{ screenshots[part.source], part.region };
+					set_monitor_constants(input.constants, monitor, x - origin_x, y - origin_y - band.top);
+
+					inputs.push_back(input);
+				}
+
+				if (!render(inputs, band_tex)) [[unlikely]]
+					printf("failed to render band %d to band texture\n", band.top);
+
+				next.band = band;
+				next.staging_tex = static_cast<ID3D11Texture2D*>(readbacks.acquire(w, band.height(), DXGI_FORMAT_B8G8R8A8_UNORM));
+				if (!next.staging_tex)
+					throw std::runtime_error{ "failed to create band staging texture" };
+
+				const D3D11_BOX box{ 0, 0, 0, static_cast<UINT>(w), static_cast<UINT>(band.height()), 1 };
+				ctx->CopySubresourceRegion(next.staging_tex, 0, 0, 0, 0, band_tex, 0, &box);
+				ctx->Flush();
+
+				if (ready.staging_tex)
+					deliver_band(ready, sink);
+
+				std::swap(ready, next);
+			});
+
+			if (ready.staging_tex)
+				deliver_band(ready, sink);
+		}
+		catch (...)
+		{
+			if (ready.staging_tex)
+				readbacks.unmap(ready.staging_tex);
+
+			if (next.staging_tex)
+				readbacks.unmap(next.staging_tex);
+
+			throw;
+		}
+	}
+
+	// capture_frame for frames too big to hold more than once, they are made and
+	// handed to sink a band at a time and never go through the frame cache
+	void capture_frame_streamed(cpu::band_sink& sink, int width, int height, int origin_x, int origin_y)
+	{
+		begin_request(width, height);
+
+		if (use_cpu_backend)
+			capture_frame_cpu_streamed(sink, origin_x, origin_y);
+		else
+			render_frame_streamed(sink, origin_x, origin_y);
+	}
+
+	// delivers the bands of a streamed capture with SetDIBitsToDevice, so neither
+	// a frame sized buffer nor a frame sized bitmap is needed
+	class gdi_band_sink : public cpu::band_sink
+	{
+	public:
+		gdi_band_sink(HDC hdc, int x, int y, int width) :
+			hdc_(hdc), x_(x), y_(y),
+			buffer_(cpu::pixel_pool::shared().acquire(static_cast<size_t>(width) * stream_band_height * 4))
+		{
+		}
+
+		cpu::bitmap_view begin(const cpu::rect& band) override
+		{
+			return { buffer_.data(), band.width(), band.height(), band.width() * 4 };
+		}
+
+		void end(const cpu::rect& band, const cpu::bitmap_view& pixels) override
+		{
+			BITMAPINFO info = {};
+			info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+			info.bmiHeader.biWidth = pixels.width;
+			info.bmiHeader.biHeight = -pixels.height; // top down
+			info.bmiHeader.biPlanes = 1;
+			info.bmiHeader.biBitCount = 32;
+			info.bmiHeader.biCompression = BI_RGB;
+
+			if (!SetDIBitsToDevice(hdc_, x_, y_ + band.top, pixels.width, pixels.height, 0, 0, 0, pixels.height, pixels.data, &info, DIB_RGB_COLORS))
+				throw std::runtime_error{ "SetDIBitsToDevice failed" };
+		}
+
+	private:
+		HDC hdc_;
+		int x_;
+		int y_;
+		cpu::pixel_buffer buffer_;
+	};
+
+	// when hdc has a 32bpp dib section selected and the blit is a plain copy to
+	// device pixels, the frame can be written straight into the dib bits
+	bool dib_target_of(HDC hdc, int x, int y, int width, int height, DWORD rop, cpu::bitmap_view& target)
+	{
+		if ((rop & ~CAPTUREBLT) != SRCCOPY)
+			return false;
+
+		if (GetMapMode(hdc) != MM_TEXT || GetGraphicsMode(hdc) != GM_COMPATIBLE)
+			return false;
+
+		// a clip region would have to be honoured pixel by pixel
+		HRGN clip = CreateRectRgn(0, 0, 0, 0);
+		const int has_clip = GetClipRgn(hdc, clip);
+		DeleteObject(clip);
+
+		if (has_clip != 0)
+			return false;
+
+		DIBSECTION dib;
+		auto* const bitmap = GetCurrentObject(hdc, OBJ_BITMAP);
+
+		if (!bitmap || GetObject(bitmap, sizeof(dib), &dib) != sizeof(dib))
+			return false;
+
+		if (dib.dsBm.bmBitsPixel != 32)
+			return false;
+
+		const bool bgra = dib.dsBmih.biCompression == BI_RGB
+			|| (dib.dsBmih.biCompression == BI_BITFIELDS
+				&& dib.dsBitfields[0] == 0x00ff0000 && dib.dsBitfields[1] == 0x0000ff00 && dib.dsBitfields[2] == 0x000000ff);
+
+		if (!bgra)
+			return false;
+
+		POINT origin{ x, y };
+		LPtoDP(hdc, &origin, 1);
+
+		const cpu::dib_desc desc
+		{
+			static_cast<uint8_t*>(dib.dsBm.bmBits),
+			dib.dsBm.bmWidth, dib.dsBm.bmHeight,
+			dib.dsBm.bmWidthBytes,
+			dib.dsBmih.biHeight > 0,
+		};
+
+		if (!cpu::dib_target(desc, origin.x, origin.y, width, height, target))
+			return false;
+
+		// gdi may still be drawing into the bits
+		GdiFlush();
+		return true;
+	}
+
+	double elapsed_ms(std::chrono::steady_clock::time_point since)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+	}
+
+	LRESULT CALLBACK display_listener_proc(HWND window, UINT message, WPARAM wparam, LPARAM lparam)
+	{
+		// hdr and sdr white level changes come as WM_SETTINGCHANGE, not always
+		// with a WM_DISPLAYCHANGE
+		if (message == WM_DISPLAYCHANGE || message == WM_SETTINGCHANGE)
+			topology.invalidate();
+
+		if (message == WM_DISPLAYCHANGE)
+			displays_changed = true;
+
+		return DefWindowProcW(window, message, wparam, lparam);
+	}
+
+	// a hidden top level window on a thread of its own, message-only windows
+	// do not get the display broadcasts
+	void start_display_listener()
+	{
+		std::thread{ []
+		{
+			WNDCLASSEXW wc = {};
+			wc.cbSize = sizeof(wc);
+			wc.lpfnWndProc = display_listener_proc;
+			wc.hInstance = self_instance;
+			wc.lpszClassName = L"bitblt-hdr-display-listener";
+
+			if (!RegisterClassExW(&wc))
+			{
+				printf("start_display_listener failed to RegisterClassExW: %lu\n", GetLastError());
+				return;
+			}
+
+			if (!CreateWindowExW(0, wc.lpszClassName, L"", 0, 0, 0, 0, 0, nullptr, nullptr, self_instance, nullptr))
+			{
+				printf("start_display_listener failed to CreateWindowExW: %lu\n", GetLastError());
+				return;
+			}
+
+			MSG msg;
+			while (GetMessageW(&msg, nullptr, 0, 0) > 0)
+				DispatchMessageW(&msg);
+		} }.detach();
+	}
+
+	// everything the first capture would otherwise pay for. false only when
+	// there is no device, the later stages are retried by the capture itself
+	bool warm_up()
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		if (!init_desktop_dup())
+			return false;
+
+		startup_timing.device = elapsed_ms(start);
+
+		start_display_listener();
+
+		try
+		{
+			start = std::chrono::steady_clock::now();
+			enum_monitors();
+			startup_timing.monitors = elapsed_ms(start);
+
+			start = std::chrono::steady_clock::now();
+			for (const auto& monitor : monitors)
+				monitor->start_duplication();
+			startup_timing.duplication = elapsed_ms(start);
+		}
+		catch (std::runtime_error e)
+		{
+			printf("warm_up failed to duplicate outputs, error: \n%s\n", e.what());
+		}
+
+		if (!use_cpu_backend)
+		{
+			start = std::chrono::steady_clock::now();
+			compile_shader();
+			startup_timing.shader = elapsed_ms(start);
+		}
+
+#if _DEBUG
+		printf("warm up: device %.2f ms, monitors %.2f ms, duplication %.2f ms, shader %.2f ms\n",
+			   startup_timing.device, startup_timing.monitors, startup_timing.duplication, startup_timing.shader);
+#endif
+
+		if (background_capture)
+		{
+			background_thread = new cpu::capture_thread(capture_frame_locked, background_max_age, background_idle_after);
+		}
+
+		watchdog = new cpu::capture_watchdog([](const cpu::rect& area, const cpu::bitmap_view& dest)
+		{
+			return captures.capture(area, dest);
+		}, capture_budget);
+
+		return true;
+	}
+
+	// called from hook_autoinit under the loader lock, the thread only gets to
+	// run once the host is done loading us and must never be waited on here
+	void start_warm_up()
+	{
+		std::promise<bool> promise;
+		std::lock_guard lock{ warm_up_mutex };
+
+		warmed_up = promise.get_future().share();
+
+		try
+		{
+			std::thread{ [promise = std::move(promise)]() mutable
+			{
+				try
+				{
+					promise.set_value(warm_up());
+				}
+				catch (...)
+				{
+					promise.set_value(false);
+				}
+			} }.detach();
+		}
+		catch (std::system_error e)
+		{
+			printf("failed to start warm up thread, error: \n%s\n", e.what());
+			warmed_up = {};
+		}
+	}
+
+	// the warm-up future, without a warm-up thread the first caller creates a
+	// deferred one that runs on whichever thread waits on it first
+	std::shared_future<bool> warm_up_future()
+	{
+		std::lock_guard lock{ warm_up_mutex };
+
+		if (!warmed_up.valid())
+			warmed_up = std::async(std::launch::deferred, warm_up).share();
+
+		return warmed_up;
+	}
+
+	// only blocks while the warm-up is still in flight, without one the first
+	// call does it inline
+	bool wait_for_warm_up()
+	{
+		const auto ready = warm_up_future();
+
+		if (ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready) [[likely]]
+			return ready.get();
+
+		const auto start = std::chrono::steady_clock::now();
+		const bool result = ready.get();
+		startup_timing.wait = elapsed_ms(start);
+
+#if _DEBUG
+		printf("waited %.2f ms for warm up\n", startup_timing.wait);
+#endif
+		return result;
+	}
+
+	void note_first_capture(std::chrono::steady_clock::time_point start)
+	{
+		if (startup_timing.first_capture)
+			return;
+
+		startup_timing.first_capture = elapsed_ms(start);
+
+#if _DEBUG
+		printf("first capture took %.2f ms, %.2f ms of it waiting for warm up\n", startup_timing.first_capture, startup_timing.wait);
+#endif
+	}
+
+	trampoline<decltype(BitBlt)> bitblt;
+	BOOL WINAPI bitblt_hook(HDC hdc, int x, int y, int cx, int cy, HDC hdcSrc, int x1, int y1, DWORD rop)
+	{
+		printf("bitblt called\n");
+
+		auto src_window = WindowFromDC(hdcSrc);
+		auto desktop_window = GetDesktopWindow();
+
+		if (src_window != desktop_window)
+			return bitblt(hdc, x, y, cx, cy, hdcSrc, x1, y1, rop);
+
+		const auto start = std::chrono::steady_clock::now();
+
+		if (!wait_for_warm_up())
+			return bitblt(hdc, x, y, cx, cy, hdcSrc, x1, y1, rop);
+
+		cpu::bitmap_view target;
+		const bool direct = dib_target_of(hdc, x, y, cx, cy, rop, target);
+
+		// only a plain copy can be delivered a band at a time
+		if (static_cast<size_t>(cx) * cy * 4 > stream_threshold && (direct || (rop & ~CAPTUREBLT) == SRCCOPY))
+		{
+			try
+			{
+				std::lock_guard lock{ device_mutex };
+
+				if (direct)
+				{
+					cpu::bitmap_sink sink{ target };
+					capture_frame_streamed(sink, cx, cy, x1, y1);
+				}
+				else
+				{
+					gdi_band_sink sink{ hdc, x, y, cx };
+					capture_frame_streamed(sink, cx, cy, x1, y1);
+				}
+			}
+			catch (std::runtime_error e)
+			{
+				printf("failed to capture_frame_streamed, error: \n%s\n", e.what());
+				return bitblt(hdc, x, y, cx, cy, hdcSrc, x1, y1, rop);
+			}
+
+			note_first_capture(start);
+			return TRUE;
+		}
+
+		cpu::pixel_buffer buffer;
+
+		if (!direct)
+		{
+			buffer = cpu::pixel_pool::shared().acquire(static_cast<size_t>(cx) * cy * 4);
+			target = { buffer.data(), cx, cy, cx * 4 };
+		}
+
+		const cpu::rect request{ x1, y1, x1 + cx, y1 + cy };
+
+		if (!background_thread || !background_thread->try_get(request, target))
+		{
+			const auto outcome = watchdog->capture(request, target);
+
+			if (outcome == cpu::capture_watchdog::outcome::timed_out)
+			{
+				printf("capture took longer than %lld ms, falling back to BitBlt (%llu timed out, %llu cancelled, %llu late)\n",
+					   static_cast<long long>(capture_budget.count()), watchdog->timed_out(), watchdog->cancelled(), watchdog->late());
+			}
+
+			if (outcome != cpu::capture_watchdog::outcome::captured)
+				return bitblt(hdc, x, y, cx, cy, hdcSrc, x1, y1, rop);
+		}
+
+		if (direct)
+		{
+			note_first_capture(start);
+			return TRUE;
+		}
+
+		HBITMAP map = CreateBitmap(cx, cy, 1, 32, buffer.data());
+		HDC src = CreateCompatibleDC(hdc);
+		SelectObject(src, map);
+
+		auto result = bitblt(hdc, x, y, cx, cy, src, 0, 0, rop & ~CAPTUREBLT);
+
+		DeleteDC(src);
+		DeleteObject(map);
+
+		note_first_capture(start);
+		return result;
+	}
+
+	void free_desktop_dup()
+	{
+		monitors.clear();
+		monitor_outputs.clear();
+
+		last_frame.invalidate();
+		tonemapped_tiles.clear();
+		readbacks.clear();
+		cpu::pixel_pool::shared().trim();
+
+		views.clear();
+
+		render_const_buffer = nullptr;
+		virtual_desktop_tex = nullptr;
+		band_tex = nullptr;
+		render_cs = nullptr;
 		ctx = nullptr;
 		device = nullptr;
 	}
@@ -460,7 +1811,23 @@ namespace
 	trampoline<void WINAPI(UINT)> exit_process;
 	void exit_process_hook(UINT code)
 	{
-		free_desktop_dup();
+		// the warm-up thread may still be creating what is about to be freed
+		std::shared_future<bool> ready;
+		{
+			std::lock_guard lock{ warm_up_mutex };
+			ready = warmed_up;
+		}
+
+		if (ready.valid())
+			ready.wait();
+
+		if (background_thread)
+			background_thread->stop();
+
+		// a late capture may still be using the device
+		if (!watchdog || watchdog->stop(exit_capture_wait))
+			free_desktop_dup();
+
 		exit_process(code);
 	}
 
@@ -489,6 +1856,9 @@ namespace
 			MH_CreateHookApi(L"gdi32.dll", "BitBlt", bitblt_hook, &bitblt);
 			MH_CreateHookApi(L"kernel32.dll", "ExitProcess", exit_process_hook, &exit_process);
 			MH_EnableHook(MH_ALL_HOOKS);
+
+			if (prewarm_at_load)
+				start_warm_up();
 		}
 	} hook;
 }
@@ -6,6 +6,14 @@
 
 #include "monitor.hpp"
 
+// how long take_screenshot waits for a new frame before settling for the
+// retained copy, a static desktop presents nothing at all
+constexpr auto fresh_frame_wait = std::chrono::milliseconds(1);
+
+// without a retained copy there is nothing to settle for, a new duplication
+// hands out its first frame right away so this only runs out when it is broken
+constexpr auto first_frame_wait = std::chrono::milliseconds(1000);
+
 // https://chromium.googlesource.com/chromium/src/+/c71f15ab1ace78c7efeeeda9f8552b4af9db2877/ui/display/win/screen_win.cc#112
 bool get_path_info(HMONITOR monitor, DISPLAYCONFIG_PATH_INFO* path_info)
 {
@@ -63,13 +71,16 @@ bool get_path_info(HMONITOR monitor, DISPLAYCONFIG_PATH_INFO* path_info)
 }
 
 monitor::monitor(com_ptr<IDXGIOutput6> output, com_ptr<ID3D11Device> device) :
-	output_(output), device_(device)
+	output_(output), device_(device), acquirer_(fresh_frame_wait, first_frame_wait)
 {
 	memset(&desc_, 0, sizeof(DXGI_OUTPUT_DESC1));
 }
 
 monitor::~monitor()
 {
+	if (frame_)
+		release();
+
 	last_tex_ = nullptr;
 	dup_ = nullptr;
 	output_ = nullptr;
@@ -126,6 +137,27 @@ vec2_t monitor::resolution() const
 }
 
 float monitor::sdr_white_level() const
+{
+	return white_level_;
+}
+
+bool monitor::query_info(cpu::output_info& info)
+{
+	update_output_desc();
+	white_level_ = query_sdr_white_level();
+
+	const auto [x, y] = virtual_position();
+	const auto [width, height] = resolution();
+
+	info.area = { x, y, x + width, y + height };
+	info.rotation = cpu::rotation_from_degrees(rotation());
+	info.hdr = hdr_on();
+	info.sdr_white_level = white_level_;
+
+	return true;
+}
+
+float monitor::query_sdr_white_level() const
 {
 	const float default_white_level = 200.0f;
 
@@ -144,71 +176,147 @@ float monitor::sdr_white_level() const
 	return white_level.SDRWhiteLevel * 80.0f / 1000.0f;
 }
 
-com_ptr<ID3D11Texture2D> monitor::take_screenshot()
+int64_t monitor::last_present_time() const
+{
+	return last_present_time_;
+}
+
+cpu::retained_frame& monitor::retained()
+{
+	return retained_;
+}
+
+void monitor::start_duplication()
 {
 	if (!dup_) recreate_output_duplication();
+}
 
-	if (last_tex_)
+com_ptr<ID3D11Texture2D> monitor::take_screenshot()
+{
+	start_duplication();
+
+	const auto result = acquirer_.acquire(*this);
+
+	if (result == cpu::frame_acquirer::result::failed) [[unlikely]]
 	{
-		last_tex_ = nullptr;
+		auto msg = std::format("failed to acquire next frame on monitor {}: {:x}", name(), last_error_);
+		throw std::runtime_error{ msg };
 	}
 
+#if _DEBUG
+	const auto& waits = acquirer_.waits();
+	printf("acquired %s frame on monitor %s in %.3f ms, p99 %.3f ms\n",
+		   result == cpu::frame_acquirer::result::fresh ? "a new" : "the retained", name().data(), waits.last(), waits.percentile(0.99));
+#endif
+
+	return last_tex_;
+}
+
+const cpu::wait_stats& monitor::acquire_waits() const
+{
+	return acquirer_.waits();
+}
+
+cpu::duplication_source::acquire_status monitor::acquire(unsigned int timeout_ms, bool& presented)
+{
 	DXGI_OUTDUPL_FRAME_INFO frame_info{ 0 };
 	com_ptr<IDXGIResource> resource;
 
-	HRESULT hr = S_OK;
-	while (!frame_info.LastPresentTime.QuadPart)
+	HRESULT hr = dup_->AcquireNextFrame(timeout_ms, &frame_info, resource);
+
+	// the previous frame is still held, a capture threw before releasing it
+	if (hr == DXGI_ERROR_INVALID_CALL) [[unlikely]]
 	{
-		hr = dup_->AcquireNextFrame(0, &frame_info, resource);
+		release();
+		hr = dup_->AcquireNextFrame(timeout_ms, &frame_info, resource);
+	}
 
-		if (hr == DXGI_ERROR_INVALID_CALL) [[likely]]
-		{
-			hr = dup_->ReleaseFrame();
+	if (hr == DXGI_ERROR_WAIT_TIMEOUT)
+		return acquire_status::timeout;
 
-			if (hr == DXGI_ERROR_ACCESS_LOST) [[unlikely]]
-			{
-				recreate_output_duplication();
-				continue;
-			}
+	if (hr == DXGI_ERROR_ACCESS_LOST) [[unlikely]]
+		return acquire_status::access_lost;
 
-			if (FAILED(hr)) [[unlikely]]
-			{
-				auto msg = std::format("failed to release frame on monitor {}: {:x}", name(), hr);
-				throw std::runtime_error{ msg };
-			}
+	if (FAILED(hr)) [[unlikely]]
+	{
+		last_error_ = hr;
+		return acquire_status::failed;
+	}
 
-			continue;
-		}
+	frame_ = resource.as<ID3D11Texture2D>();
 
-		if (hr == DXGI_ERROR_ACCESS_LOST) [[unlikely]]
-		{
-			recreate_output_duplication();
-			continue;
-		}
+	if (!frame_) [[unlikely]]
+	{
+		dup_->ReleaseFrame();
 
-		if (hr == DXGI_ERROR_WAIT_TIMEOUT)
-		{
-			Sleep(20);
-			continue;
-		}
+		last_error_ = E_NOINTERFACE;
+		return acquire_status::failed;
+	}
+
+	collect_damage(frame_info);
+
+	frame_present_time_ = frame_info.LastPresentTime.QuadPart;
+	presented = frame_present_time_ != 0;
+
+	return acquire_status::frame;
+}
+
+void monitor::retain()
+{
+	D3D11_TEXTURE2D_DESC desc;
+	frame_->GetDesc(&desc);
+
+	if (last_tex_)
+	{
+		D3D11_TEXTURE2D_DESC last_desc;
+		last_tex_->GetDesc(&last_desc);
+
+		if (last_desc.Width != desc.Width || last_desc.Height != desc.Height || last_desc.Format != desc.Format)
+			last_tex_ = nullptr;
+	}
 
-		if (FAILED(hr)) [[unlikely]]
+	if (!last_tex_)
+	{
+		desc.MipLevels = 1;
+		desc.ArraySize = 1;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+
+		auto hr = device_->CreateTexture2D(&desc, nullptr, last_tex_);
+
+		if (FAILED(hr))
 		{
-			auto msg = std::format("failed to acquire next frame on monitor {}: {:x}", name(), hr);
+			auto msg = std::format("failed to create retained frame texture on monitor {}: {:x}", name(), hr);
 			throw std::runtime_error{ msg };
 		}
 	}
 
-	com_ptr<ID3D11Texture2D> tex = resource.as<ID3D11Texture2D>();
+	com_ptr<ID3D11DeviceContext> ctx;
+	device_->GetImmediateContext(ctx);
+	ctx->CopyResource(last_tex_, frame_);
 
-	if (!tex)
-	{
-		auto msg = std::format("failed to get texture from resource on monitor {}", name());
-		throw std::runtime_error{ msg };
-	}
+	last_present_time_ = frame_present_time_;
+}
+
+void monitor::release()
+{
+	frame_ = nullptr;
+
+	// access lost shows up again on the next acquire
+	dup_->ReleaseFrame();
+}
+
+void monitor::set_output(com_ptr<IDXGIOutput6> output)
+{
+	output_ = output;
+}
 
-	last_tex_ = tex;
-	return tex;
+void monitor::recreate()
+{
+	last_tex_ = nullptr;
+	recreate_output_duplication();
 }
 
 void monitor::recreate_output_duplication()
@@ -232,9 +340,57 @@ void monitor::recreate_output_duplication()
 		throw std::runtime_error{ msg };
 	}
 
+	// a new duplication does not know what the old one reported
+	retained_.damage_all();
+
 	update_output_desc();
 }
 
+void monitor::collect_damage(const DXGI_OUTDUPL_FRAME_INFO& frame_info)
+{
+	if (!frame_info.TotalMetadataBufferSize)
+		return;
+
+	if (metadata_.size() < frame_info.TotalMetadataBufferSize)
+		metadata_.resize(frame_info.TotalMetadataBufferSize);
+
+	const auto buffer_size = static_cast<UINT>(metadata_.size());
+	UINT size = 0;
+
+	// moves come first, the dirty rects describe the frame after them
+	auto hr = dup_->GetFrameMoveRects(buffer_size, reinterpret_cast<DXGI_OUTDUPL_MOVE_RECT*>(metadata_.data()), &size);
+
+	if (FAILED(hr)) [[unlikely]]
+	{
+		printf("GetFrameMoveRects failed on monitor %s: %x\n", name().data(), hr);
+		retained_.damage_all();
+		return;
+	}
+
+	const auto* moves = reinterpret_cast<const DXGI_OUTDUPL_MOVE_RECT*>(metadata_.data());
+	for (UINT i = 0; i < size / sizeof(DXGI_OUTDUPL_MOVE_RECT); i++)
+	{
+		const auto& r = moves[i].DestinationRect;
+		retained_.move({ r.left, r.top, r.right, r.bottom }, moves[i].SourcePoint.x, moves[i].SourcePoint.y);
+	}
+
+	hr = dup_->GetFrameDirtyRects(buffer_size, reinterpret_cast<RECT*>(metadata_.data()), &size);
+
+	if (FAILED(hr)) [[unlikely]]
+	{
+		printf("GetFrameDirtyRects failed on monitor %s: %x\n", name().data(), hr);
+		retained_.damage_all();
+		return;
+	}
+
+	const auto* dirty = reinterpret_cast<const RECT*>(metadata_.data());
+	for (UINT i = 0; i < size / sizeof(RECT); i++)
+	{
+		const auto& r = dirty[i];
+		retained_.damage({ r.left, r.top, r.right, r.bottom });
+	}
+}
+
 void monitor::update_output_desc()
 {
 	auto hr = output_->GetDesc1(&desc_);
@@ -2,11 +2,15 @@
 #include <tuple>
 #include <dxgi1_6.h>
 #include <d3d11.h>
+#include <vector>
+#include "cpu/frame_acquirer.hpp"
+#include "cpu/retained_frame.hpp"
+#include "cpu/topology_cache.hpp"
 #include "utils/com_ptr.hpp"
 
 using vec2_t = std::tuple<int, int>;
 
-class monitor
+class monitor : private cpu::duplication_source
 {
 public:
 	monitor(com_ptr<IDXGIOutput6> output, com_ptr<ID3D11Device> device);
@@ -17,20 +21,62 @@ public:
 	vec2_t virtual_position() const;
 	float rotation() const;
 	vec2_t resolution() const;
+	// as of the last query_info
 	float sdr_white_level() const;
+	int64_t last_present_time() const;
 
+	// tonemapped output of the cpu backend, take_screenshot marks what changed
+	cpu::retained_frame& retained();
+
+	// creates the output duplication ahead of the first take_screenshot
+	void start_duplication();
+
+	// the output a new enumeration found for this display, the current
+	// duplication stays and the next one is made from it
+	void set_output(com_ptr<IDXGIOutput6> output);
+
+	// a copy of the latest presented frame, waiting at most fresh_frame_wait
+	// for a new one once there is a copy
 	com_ptr<ID3D11Texture2D> take_screenshot();
 	void update_output_desc();
 
+	// refreshes the output desc and the sdr white level, both are slow to
+	// ask for and only change with the display configuration
+	bool query_info(cpu::output_info& info);
+
+	// how long take_screenshot spent acquiring
+	const cpu::wait_stats& acquire_waits() const;
+
 private:
 	void recreate_output_duplication();
+	float query_sdr_white_level() const;
+	void collect_damage(const DXGI_OUTDUPL_FRAME_INFO& frame_info);
+
+	acquire_status acquire(unsigned int timeout_ms, bool& presented) override;
+	void retain() override;
+	void release() override;
+	void recreate() override;
 
 	com_ptr<IDXGIOutput6> output_;
 	com_ptr<IDXGIOutputDuplication> dup_;
 	com_ptr<ID3D11Device> device_;
+
+	// held between acquire and release
+	com_ptr<ID3D11Texture2D> frame_;
+	int64_t frame_present_time_ = 0;
+
+	// the retained copy of the last presented frame
 	com_ptr<ID3D11Texture2D> last_tex_;
 
+	cpu::frame_acquirer acquirer_;
+	HRESULT last_error_ = S_OK;
+
 	DXGI_OUTPUT_DESC1 desc_;
+	int64_t last_present_time_ = 0;
+	float white_level_ = 200.0f;
+
+	cpu::retained_frame retained_;
+	std::vector<uint8_t> metadata_;
 
 	std::string name_;
 };
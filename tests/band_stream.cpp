@@ -0,0 +1,238 @@
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/band_stream.hpp"
+#include "cpu/thread_pool.hpp"
+
+namespace
+{
+	struct source_image
+	{
+		int width;
+		int height;
+		cpu::pixel_format format;
+		std::vector<uint8_t> pixels;
+
+		cpu::image_view view() const
+		{
+			const int bpp = cpu::bytes_per_pixel(format);
+			return { pixels.data(), width, height, static_cast<ptrdiff_t>(width) * bpp, format };
+		}
+	};
+
+	source_image make_image(int width, int height, cpu::pixel_format format, std::mt19937& rng)
+	{
+		source_image image{ width, height, format, {} };
+		image.pixels.resize(static_cast<size_t>(width) * height * cpu::bytes_per_pixel(format));
+
+		if (format == cpu::pixel_format::r16g16b16a16_float)
+		{
+			// finite halves up to about 2.0
+			for (size_t i = 0; i < image.pixels.size(); i += 2)
+			{
+				const auto half = static_cast<uint16_t>(0x3000 + rng() % 0x1800);
+				std::memcpy(&image.pixels[i], &half, 2);
+			}
+		}
+		else
+		{
+			for (auto& b : image.pixels)
+				b = static_cast<uint8_t>(rng());
+		}
+
+		return image;
+	}
+
+	// reads straight out of whole source images, and keeps count of what is
+	// requested and not released yet
+	struct memory_reader : cpu::band_reader
+	{
+		struct request_t
+		{
+			size_t source;
+			cpu::rect region;
+		};
+
+		const std::vector<source_image>& images;
+		int live = 0;
+		int peak = 0;
+		int fail_at = -1;
+		int waits = 0;
+
+		explicit memory_reader(const std::vector<source_image>& images) :
+			images(images)
+		{
+		}
+
+		void* request(size_t source, const cpu::rect& region) override
+		{
+			peak = ++live > peak ? live : peak;
+			return new request_t{ source, region };
+		}
+
+		cpu::image_view wait(void* request) override
+		{
+			if (waits++ == fail_at)
+				throw std::runtime_error{ "read failed" };
+
+			const auto* r = static_cast<request_t*>(request);
+			const auto& image = images[r->source];
+			const int bpp = cpu::bytes_per_pixel(image.format);
+
+			return
+			{
+				image.pixels.data() + (static_cast<size_t>(r->region.top) * image.width + r->region.left) * bpp,
+				r->region.width(), r->region.height(), static_cast<ptrdiff_t>(image.width) * bpp, image.format,
+			};
+		}
+
+		void release(void* request) override
+		{
+			live--;
+			delete static_cast<request_t*>(request);
+		}
+	};
+
+	struct layout
+	{
+		int width;
+		int height;
+		std::vector<source_image> images;
+		std::vector<cpu::band_source> sources;
+		std::vector<cpu::render_job> jobs;
+	};
+
+	// up to three monitors roughly side by side, some hanging off the frame
+	layout random_layout(std::mt19937& rng)
+	{
+		layout l;
+		l.width = 64 + static_cast<int>(rng() % 300);
+		l.height = 64 + static_cast<int>(rng() % 300);
+
+		const int count = 1 + static_cast<int>(rng() % 3);
+		int next_x = 0;
+
+		for (int i = 0; i < count; i++)
+		{
+			const int w = 20 + static_cast<int>(rng() % 200);
+			const int h = 20 + static_cast<int>(rng() % 200);
+			const auto format = rng() % 2 ? cpu::pixel_format::r16g16b16a16_float : cpu::pixel_format::r8g8b8a8_unorm;
+			const auto rotation = static_cast<cpu::rotation_t>(rng() % 4);
+			const bool transposed = rotation == cpu::rotation_t::rotate90 || rotation == cpu::rotation_t::rotate270;
+
+			const int x = next_x + static_cast<int>(rng() % 30) - (i == 0 ? 30 : 0);
+			const int y = static_cast<int>(rng() % 80) - 30;
+			next_x = x + (transposed ? h : w);
+
+			const float white_level = 100.0f + i * 50.0f;
+
+			l.images.push_back(make_image(w, h, format, rng));
+			l.sources.push_back({ { w, h, x, y, rotation }, white_level });
+		}
+
+		for (size_t i = 0; i < l.images.size(); i++)
+		{
+			const auto& p = l.sources[i].place;
+			l.jobs.push_back({ l.images[i].view(), p.x, p.y, p.rotation, l.sources[i].white_level });
+		}
+
+		return l;
+	}
+}
+
+TEST(streamed_frames_match_a_whole_frame_tonemap)
+{
+	std::mt19937 rng{ 1 };
+	cpu::thread_pool pool{ 3 };
+
+	for (int i = 0; i < 300; i++)
+	{
+		const auto l = random_layout(rng);
+		const size_t size = static_cast<size_t>(l.width) * l.height * 4;
+
+		std::vector<uint8_t> expected(size, 0);
+		cpu::tonemap(l.jobs, { expected.data(), l.width, l.height, l.width * 4 }, pool);
+
+		// into a bottom up frame half of the time
+		const bool bottom_up = rng() % 2;
+		std::vector<uint8_t> out(size, 0xcd);
+		const cpu::bitmap_view frame = bottom_up
+			? cpu::bitmap_view{ out.data() + size - l.width * 4, l.width, l.height, -l.width * 4 }
+			: cpu::bitmap_view{ out.data(), l.width, l.height, l.width * 4 };
+
+		memory_reader reader{ l.images };
+		cpu::bitmap_sink sink{ frame };
+		cpu::stream_bands(l.sources, l.width, l.height, 1 + static_cast<int>(rng() % 100), reader, sink, pool);
+
+		bool same = true;
+		for (int y = 0; y < l.height; y++)
+			same &= std::memcmp(frame.data + frame.pitch * y, &expected[static_cast<size_t>(y) * l.width * 4], l.width * 4) == 0;
+
+		CHECK(same);
+
+		// every request released, and at most two bands of them alive at once
+		CHECK(reader.live == 0);
+		CHECK(reader.peak <= 2 * static_cast<int>(l.sources.size()));
+	}
+}
+
+TEST(a_failed_read_still_releases_every_request)
+{
+	std::mt19937 rng{ 2 };
+	cpu::thread_pool pool{ 2 };
+
+	for (int i = 0; i < 50; i++)
+	{
+		const auto l = random_layout(rng);
+		std::vector<uint8_t> out(static_cast<size_t>(l.width) * l.height * 4);
+
+		memory_reader reader{ l.images };
+		reader.fail_at = static_cast<int>(rng() % 6);
+
+		cpu::bitmap_sink sink{ { out.data(), l.width, l.height, l.width * 4 } };
+
+		bool threw = false;
+		try
+		{
+			cpu::stream_bands(l.sources, l.width, l.height, 16, reader, sink, pool);
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+
+		CHECK(threw == (reader.waits > reader.fail_at));
+		CHECK(reader.live == 0);
+	}
+}
+
+TEST(bands_cover_the_frame_once_top_to_bottom)
+{
+	const cpu::placement sources[] =
+	{
+		{ 100, 80, 0, 0, cpu::rotation_t::identity },
+		{ 80, 100, 100, -10, cpu::rotation_t::rotate90 },
+	};
+
+	int next_top = 0;
+	std::vector<bool> covered;
+
+	cpu::for_each_band(sources, 200, 90, 32, [&](const cpu::rect& band, std::span<const cpu::band_part> parts)
+	{
+		CHECK(band.top == next_top && band.left == 0 && band.right == 200);
+		CHECK(parts.size() == 2);
+
+		next_top = band.bottom;
+		covered.push_back(cpu::covers(band, parts));
+	});
+
+	// the second monitor ends at row 70 and the first at 80
+	CHECK(next_top == 90);
+	CHECK((covered == std::vector<bool>{ true, true, false }));
+}
+
+TEST_MAIN()
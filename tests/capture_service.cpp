@@ -0,0 +1,293 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/capture_service.hpp"
+
+namespace
+{
+	using namespace std::chrono_literals;
+
+	uint32_t pattern(int x, int y)
+	{
+		return (static_cast<uint32_t>(x) * 2654435761u) ^ (static_cast<uint32_t>(y) * 40503u);
+	}
+
+	// a desktop where every pixel is derived from its position. the first
+	// capture can be held until the test lets go, so requests pile up behind it
+	struct fake_desktop
+	{
+		std::atomic<int> inside{ 0 };
+		std::atomic<bool> reentered{ false };
+		std::atomic<bool> fail{ false };
+		std::atomic<bool> hold{ false };
+		std::atomic<bool> held{ false };
+
+		std::mutex mutex;
+		std::vector<cpu::rect> captured;
+		std::vector<const uint8_t*> targets;
+
+		bool capture(const cpu::rect& area, const cpu::bitmap_view& dest)
+		{
+			reentered = reentered || inside++;
+
+			{
+				std::lock_guard lock{ mutex };
+				captured.push_back(area);
+				targets.push_back(dest.data);
+			}
+
+			held = true;
+			while (hold)
+				std::this_thread::sleep_for(1ms);
+
+			for (int y = 0; y < area.height(); y++)
+			{
+				auto* row = reinterpret_cast<uint32_t*>(dest.data + dest.pitch * y);
+
+				for (int x = 0; x < area.width(); x++)
+					row[x] = pattern(area.left + x, area.top + y);
+			}
+
+			inside--;
+			return !fail;
+		}
+
+		cpu::capture_service::capture_fn fn()
+		{
+			return [this](const cpu::rect& area, const cpu::bitmap_view& dest) { return capture(area, dest); };
+		}
+	};
+
+	struct request
+	{
+		cpu::rect area;
+		std::vector<uint32_t> pixels;
+		bool ok = false;
+
+		explicit request(const cpu::rect& area) :
+			area(area), pixels(static_cast<size_t>(area.width()) * area.height())
+		{
+		}
+
+		cpu::bitmap_view dest()
+		{
+			return { reinterpret_cast<uint8_t*>(pixels.data()), area.width(), area.height(), area.width() * 4 };
+		}
+
+		bool correct() const
+		{
+			bool same = true;
+
+			for (int y = 0; y < area.height(); y++)
+			{
+				for (int x = 0; x < area.width(); x++)
+					same &= pixels[static_cast<size_t>(y) * area.width() + x] == pattern(area.left + x, area.top + y);
+			}
+
+			return same;
+		}
+	};
+
+	// runs requests on threads of their own while the first capture is held
+	void behind_a_held_capture(cpu::capture_service& service, fake_desktop& desktop, request& first, std::vector<request>& rest)
+	{
+		desktop.hold = true;
+
+		std::thread leader{ [&] { first.ok = service.capture(first.area, first.dest()); } };
+		while (!desktop.held)
+			std::this_thread::sleep_for(1ms);
+
+		std::vector<std::thread> threads;
+		for (auto& r : rest)
+			threads.emplace_back([&] { r.ok = service.capture(r.area, r.dest()); });
+
+		while (service.requests() < 1 + rest.size())
+			std::this_thread::sleep_for(1ms);
+
+		// for the last of them to join their batch
+		std::this_thread::sleep_for(50ms);
+		desktop.hold = false;
+
+		leader.join();
+		for (auto& t : threads)
+			t.join();
+	}
+}
+
+TEST(a_lone_request_is_captured_straight_into_its_destination)
+{
+	fake_desktop desktop;
+	cpu::capture_service service{ desktop.fn(), 0ms };
+
+	request r{ { 10, 20, 110, 70 } };
+	CHECK(service.capture(r.area, r.dest()));
+
+	CHECK(r.correct());
+	CHECK(desktop.targets.size() == 1 && desktop.targets[0] == r.dest().data);
+	CHECK(service.captures() == 1 && service.requests() == 1);
+}
+
+TEST(requests_waiting_on_a_capture_are_folded_into_one)
+{
+	fake_desktop desktop;
+	cpu::capture_service service{ desktop.fn(), 0ms };
+
+	request first{ { 0, 0, 1920, 1080 } };
+	std::vector<request> quarters;
+	quarters.emplace_back(cpu::rect{ 0, 0, 100, 50 });
+	quarters.emplace_back(cpu::rect{ 0, 50, 100, 100 });
+	quarters.emplace_back(cpu::rect{ 100, 0, 200, 50 });
+	quarters.emplace_back(cpu::rect{ 100, 50, 200, 100 });
+
+	behind_a_held_capture(service, desktop, first, quarters);
+
+	CHECK(first.ok && first.correct());
+	for (const auto& r : quarters)
+		CHECK(r.ok && r.correct());
+
+	// the held one and the bounding rect of the others
+	CHECK(service.captures() == 2 && service.requests() == 5);
+	CHECK(desktop.captured.size() == 2);
+
+	const auto& bounds = desktop.captured[1];
+	CHECK(bounds.left == 0 && bounds.top == 0 && bounds.right == 200 && bounds.bottom == 100);
+	CHECK(!desktop.reentered);
+}
+
+TEST(far_apart_requests_are_captured_apart)
+{
+	fake_desktop desktop;
+	cpu::capture_service service{ desktop.fn(), 0ms };
+
+	request first{ { 0, 0, 16, 16 } };
+	std::vector<request> corners;
+	corners.emplace_back(cpu::rect{ 0, 0, 10, 10 });
+	corners.emplace_back(cpu::rect{ 1000, 1000, 1010, 1010 });
+
+	behind_a_held_capture(service, desktop, first, corners);
+
+	for (const auto& r : corners)
+		CHECK(r.ok && r.correct());
+
+	CHECK(service.captures() == 3);
+	CHECK(!desktop.reentered);
+}
+
+TEST(a_failed_capture_fails_every_request_folded_into_it)
+{
+	fake_desktop desktop;
+	cpu::capture_service service{ desktop.fn(), 0ms };
+
+	request first{ { 0, 0, 16, 16 } };
+	std::vector<request> rest;
+	rest.emplace_back(cpu::rect{ 0, 0, 8, 8 });
+	rest.emplace_back(cpu::rect{ 8, 8, 16, 16 });
+
+	desktop.fail = true;
+	behind_a_held_capture(service, desktop, first, rest);
+
+	CHECK(!first.ok);
+	for (const auto& r : rest)
+		CHECK(!r.ok);
+}
+
+TEST(an_exception_reaches_the_leader_and_fails_the_rest)
+{
+	std::atomic<bool> hold{ true };
+	std::atomic<int> calls{ 0 };
+
+	cpu::capture_service service{ [&](const cpu::rect&, const cpu::bitmap_view&) -> bool
+	{
+		if (calls++ == 0)
+		{
+			while (hold)
+				std::this_thread::sleep_for(1ms);
+
+			return true;
+		}
+
+		throw std::runtime_error{ "device lost" };
+	}, 0ms };
+
+	std::vector<uint32_t> px(64 * 64);
+	const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(px.data()), 8, 8, 8 * 4 };
+
+	std::thread first{ [&] { service.capture({ 0, 0, 8, 8 }, dest); } };
+	while (!calls)
+		std::this_thread::sleep_for(1ms);
+
+	std::atomic<int> threw{ 0 };
+	std::atomic<int> failed{ 0 };
+	std::vector<std::thread> rest;
+
+	for (int i = 0; i < 3; i++)
+	{
+		rest.emplace_back([&, i]
+		{
+			std::vector<uint32_t> own(64);
+			try
+			{
+				failed += !service.capture({ i, 0, i + 8, 8 }, { reinterpret_cast<uint8_t*>(own.data()), 8, 8, 8 * 4 });
+			}
+			catch (const std::runtime_error&)
+			{
+				threw++;
+			}
+		});
+	}
+
+	while (service.requests() < 4)
+		std::this_thread::sleep_for(1ms);
+
+	std::this_thread::sleep_for(50ms);
+	hold = false;
+
+	first.join();
+	for (auto& t : rest)
+		t.join();
+
+	CHECK(threw == 1 && failed == 2);
+}
+
+TEST(many_threads_never_reenter_the_capture)
+{
+	fake_desktop desktop;
+	cpu::capture_service service{ desktop.fn(), 1ms };
+
+	std::atomic<int> wrong{ 0 };
+	std::vector<std::thread> threads;
+
+	for (int t = 0; t < 8; t++)
+	{
+		threads.emplace_back([&, t]
+		{
+			std::mt19937 rng{ static_cast<uint32_t>(t) };
+
+			for (int i = 0; i < 20; i++)
+			{
+				const int x = static_cast<int>(rng() % 600);
+				const int y = static_cast<int>(rng() % 400);
+				request r{ rng() % 2 ? cpu::rect{ 0, 0, 640, 480 } : cpu::rect{ x, y, x + 16 + static_cast<int>(rng() % 64), y + 16 + static_cast<int>(rng() % 64) } };
+
+				r.ok = service.capture(r.area, r.dest());
+				wrong += !r.ok || !r.correct();
+			}
+		});
+	}
+
+	for (auto& t : threads)
+		t.join();
+
+	CHECK(wrong == 0);
+	CHECK(!desktop.reentered);
+	CHECK(service.requests() == 160 && service.captures() <= 160);
+}
+
+TEST_MAIN()
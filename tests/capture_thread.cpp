@@ -0,0 +1,208 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/capture_thread.hpp"
+
+namespace
+{
+	using namespace std::chrono_literals;
+
+	// every pixel of a capture holds its number, and the left edge of the
+	// captured area in the first pixel of each row
+	bool fill(std::atomic<uint32_t>& number, const cpu::rect& area, const cpu::bitmap_view& dest)
+	{
+		const uint32_t n = ++number;
+
+		for (int y = 0; y < dest.height; y++)
+		{
+			auto* row = reinterpret_cast<uint32_t*>(dest.data + dest.pitch * y);
+
+			for (int x = 0; x < dest.width; x++)
+				row[x] = n;
+
+			row[0] = static_cast<uint32_t>(area.left);
+		}
+
+		return true;
+	}
+
+	// polls until the thread has captured something
+	bool wait_for_capture(const cpu::capture_thread& thread, uint64_t captures = 1)
+	{
+		const auto until = std::chrono::steady_clock::now() + 5s;
+
+		while (thread.captures() < captures)
+		{
+			if (std::chrono::steady_clock::now() > until)
+				return false;
+
+			std::this_thread::sleep_for(1ms);
+		}
+
+		return true;
+	}
+}
+
+TEST(the_first_request_misses_and_later_ones_hit)
+{
+	std::atomic<uint32_t> number{ 0 };
+	cpu::capture_thread thread{ [&](const cpu::rect& area, const cpu::bitmap_view& dest) { return fill(number, area, dest); }, 10s, 10s };
+
+	std::vector<uint32_t> out(32 * 16);
+	const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), 32, 16, 32 * 4 };
+
+	// nothing was captured before the first request, though the thread may
+	// already have caught up by the time it looks
+	thread.try_get({ 0, 0, 32, 16 }, dest);
+	CHECK(wait_for_capture(thread));
+
+	// a part of the captured area is copied out of it
+	CHECK(thread.try_get({ 0, 0, 32, 16 }, dest));
+	CHECK(out[0] == 0 && out[1] != 0 && out[32 * 15 + 31] == out[1]);
+
+	const cpu::bitmap_view part{ reinterpret_cast<uint8_t*>(out.data()), 8, 8, 32 * 4 };
+	CHECK(thread.try_get({ 4, 4, 12, 12 }, part));
+	CHECK(out[0] != 0);
+
+	CHECK(thread.hits() >= 2 && thread.hits() + thread.misses() == 3);
+}
+
+TEST(a_request_outside_the_frame_misses_and_is_captured_next)
+{
+	std::atomic<uint32_t> number{ 0 };
+	cpu::capture_thread thread{ [&](const cpu::rect& area, const cpu::bitmap_view& dest) { return fill(number, area, dest); }, 10s, 10s };
+
+	std::vector<uint32_t> out(16 * 16);
+	const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), 16, 16, 16 * 4 };
+
+	thread.try_get({ 0, 0, 16, 16 }, dest);
+	CHECK(wait_for_capture(thread));
+
+	// switches the thread over, it may not have captured the new area yet
+	bool hit = false;
+	for (int i = 0; i < 1000 && !hit; i++)
+	{
+		hit = thread.try_get({ 100, 0, 116, 16 }, dest);
+		std::this_thread::sleep_for(1ms);
+	}
+
+	CHECK(hit);
+	CHECK(out[0] == 100);
+}
+
+TEST(frames_older_than_max_age_are_not_served)
+{
+	std::atomic<uint32_t> number{ 0 };
+	std::mutex stall;
+
+	cpu::capture_thread thread{ [&](const cpu::rect& area, const cpu::bitmap_view& dest)
+	{
+		// the second capture hangs until the test lets go
+		if (number > 0)
+			std::lock_guard lock{ stall };
+
+		return fill(number, area, dest);
+	}, 30ms, 10s };
+
+	std::vector<uint32_t> out(16 * 16);
+	const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), 16, 16, 16 * 4 };
+
+	{
+		std::lock_guard lock{ stall };
+
+		thread.try_get({ 0, 0, 16, 16 }, dest);
+		CHECK(wait_for_capture(thread));
+
+		std::this_thread::sleep_for(100ms);
+		CHECK(!thread.try_get({ 0, 0, 16, 16 }, dest));
+	}
+
+	thread.stop();
+}
+
+TEST(failed_captures_are_never_served)
+{
+	std::atomic<int> calls{ 0 };
+	cpu::capture_thread thread{ [&](const cpu::rect&, const cpu::bitmap_view&) { calls++; return false; }, 10s, 10s };
+
+	std::vector<uint32_t> out(4);
+	const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), 2, 2, 8 };
+
+	thread.try_get({ 0, 0, 2, 2 }, dest);
+
+	while (!calls)
+		std::this_thread::sleep_for(1ms);
+
+	CHECK(!thread.try_get({ 0, 0, 2, 2 }, dest));
+	CHECK(thread.captures() == 0);
+}
+
+TEST(a_throwing_capture_is_dropped_and_the_thread_keeps_capturing)
+{
+	std::atomic<uint32_t> number{ 0 };
+	std::atomic<int> thrown{ 0 };
+	cpu::capture_thread thread{ [&](const cpu::rect& area, const cpu::bitmap_view& dest)
+	{
+		if (!thrown)
+		{
+			thrown++;
+			throw std::runtime_error("device removed");
+		}
+
+		return fill(number, area, dest);
+	}, 40ms, 10s };
+
+	uint32_t px;
+	thread.try_get({ 0, 0, 1, 1 }, { reinterpret_cast<uint8_t*>(&px), 1, 1, 4 });
+
+	CHECK(wait_for_capture(thread));
+	CHECK(thrown == 1);
+
+	thread.stop();
+}
+
+TEST(capturing_stops_when_nobody_asks)
+{
+	std::atomic<uint32_t> number{ 0 };
+	cpu::capture_thread thread{ [&](const cpu::rect& area, const cpu::bitmap_view& dest) { return fill(number, area, dest); }, 20ms, 50ms };
+
+	uint32_t px;
+	thread.try_get({ 0, 0, 1, 1 }, { reinterpret_cast<uint8_t*>(&px), 1, 1, 4 });
+	CHECK(wait_for_capture(thread));
+
+	std::this_thread::sleep_for(300ms);
+	const auto idle = number.load();
+
+	std::this_thread::sleep_for(200ms);
+	CHECK(number == idle);
+}
+
+TEST(stop_joins_and_later_requests_miss)
+{
+	std::atomic<uint32_t> number{ 0 };
+	cpu::capture_thread thread{ [&](const cpu::rect& area, const cpu::bitmap_view& dest) { return fill(number, area, dest); }, 10s, 10s };
+
+	uint32_t px;
+	const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(&px), 1, 1, 4 };
+
+	thread.try_get({ 0, 0, 1, 1 }, dest);
+	CHECK(wait_for_capture(thread));
+
+	thread.stop();
+	const auto stopped = number.load();
+
+	CHECK(!thread.try_get({ 0, 0, 1, 1 }, dest));
+	std::this_thread::sleep_for(20ms);
+	CHECK(number == stopped);
+
+	// a second stop is fine
+	thread.stop();
+}
+
+TEST_MAIN()
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/capture_watchdog.hpp"
+
+namespace
+{
+	using namespace std::chrono_literals;
+	using outcome = cpu::capture_watchdog::outcome;
+
+	uint32_t pattern(int x, int y)
+	{
+		return (static_cast<uint32_t>(x) * 2654435761u) ^ (static_cast<uint32_t>(y) * 40503u);
+	}
+
+	// a desktop where every pixel is derived from its position. captures can
+	// be held until the test lets go, standing in for a stalled readback
+	struct fake_desktop
+	{
+		std::atomic<bool> hold{ false };
+		std::atomic<bool> fail{ false };
+		std::atomic<bool> fail_hard{ false };
+		std::atomic<int> started{ 0 };
+		std::atomic<int> finished{ 0 };
+
+		bool capture(const cpu::rect& area, const cpu::bitmap_view& dest)
+		{
+			started++;
+
+			while (hold)
+				std::this_thread::sleep_for(1ms);
+
+			for (int y = 0; y < area.height(); y++)
+			{
+				auto* row = reinterpret_cast<uint32_t*>(dest.data + dest.pitch * y);
+
+				for (int x = 0; x < area.width(); x++)
+					row[x] = pattern(area.left + x, area.top + y);
+			}
+
+			finished++;
+
+			if (fail_hard)
+				throw std::runtime_error("device removed");
+
+			return !fail;
+		}
+
+		cpu::capture_watchdog::capture_fn fn()
+		{
+			return [this](const cpu::rect& area, const cpu::bitmap_view& dest) { return capture(area, dest); };
+		}
+
+		void wait_started(int count)
+		{
+			while (started < count)
+				std::this_thread::sleep_for(1ms);
+		}
+	};
+
+	// starts out filled with a value the pattern never produces at its origin
+	struct request
+	{
+		cpu::rect area;
+		std::vector<uint32_t> pixels;
+
+		explicit request(const cpu::rect& area) :
+			area(area), pixels(static_cast<size_t>(area.width()) * area.height(), 0xcccccccc)
+		{
+		}
+
+		cpu::bitmap_view dest()
+		{
+			return { reinterpret_cast<uint8_t*>(pixels.data()), area.width(), area.height(), area.width() * 4 };
+		}
+
+		bool correct() const
+		{
+			bool same = true;
+
+			for (int y = 0; y < area.height(); y++)
+			{
+				for (int x = 0; x < area.width(); x++)
+					same &= pixels[static_cast<size_t>(y) * area.width() + x] == pattern(area.left + x, area.top + y);
+			}
+
+			return same;
+		}
+
+		bool untouched() const
+		{
+			return std::all_of(pixels.begin(), pixels.end(), [](uint32_t pixel) { return pixel == 0xcccccccc; });
+		}
+	};
+}
+
+TEST(an_in_time_capture_is_copied_into_the_destination)
+{
+	fake_desktop desktop;
+	cpu::capture_watchdog watchdog{ desktop.fn(), 5s };
+
+	request r{ { 10, 20, 110, 70 } };
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::captured);
+
+	CHECK(r.correct());
+	CHECK(watchdog.captured() == 1 && watchdog.timed_out() == 0);
+}
+
+TEST(failed_and_throwing_captures_fail)
+{
+	fake_desktop desktop;
+	cpu::capture_watchdog watchdog{ desktop.fn(), 5s };
+
+	request r{ { 0, 0, 16, 16 } };
+
+	desktop.fail = true;
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::failed);
+
+	desktop.fail = false;
+	desktop.fail_hard = true;
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::failed);
+
+	CHECK(r.untouched());
+	CHECK(watchdog.failed() == 2);
+
+	// the worker survived the exception
+	desktop.fail_hard = false;
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::captured);
+	CHECK(r.correct());
+}
+
+TEST(a_stalled_capture_times_out_and_never_touches_the_destination)
+{
+	fake_desktop desktop;
+	cpu::capture_watchdog watchdog{ desktop.fn(), 20ms };
+
+	request r{ { 0, 0, 64, 32 } };
+
+	desktop.hold = true;
+	const auto start = cpu::capture_watchdog::clock::now();
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::timed_out);
+	CHECK(cpu::capture_watchdog::clock::now() - start < 5s);
+
+	desktop.hold = false;
+	while (watchdog.late() < 1)
+		std::this_thread::sleep_for(1ms);
+
+	CHECK(desktop.finished == 1);
+	CHECK(r.untouched());
+	CHECK(watchdog.timed_out() == 1 && watchdog.cancelled() == 0);
+
+	// and the next one goes through the same worker
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::captured);
+	CHECK(r.correct());
+}
+
+TEST(a_request_still_queued_at_its_deadline_is_cancelled)
+{
+	fake_desktop desktop;
+	cpu::capture_watchdog watchdog{ desktop.fn(), 20ms, 1 };
+
+	request first{ { 0, 0, 16, 16 } };
+	request second{ { 16, 0, 32, 16 } };
+
+	desktop.hold = true;
+	CHECK(watchdog.capture(first.area, first.dest()) == outcome::timed_out);
+	desktop.wait_started(1);
+
+	// the only worker is stuck on the first
+	CHECK(watchdog.capture(second.area, second.dest()) == outcome::timed_out);
+	CHECK(watchdog.cancelled() == 1);
+
+	desktop.hold = false;
+	while (watchdog.late() < 1)
+		std::this_thread::sleep_for(1ms);
+
+	CHECK(desktop.started == 1);
+	CHECK(first.untouched() && second.untouched());
+}
+
+TEST(stop_waits_for_a_late_capture_then_fails_new_ones)
+{
+	fake_desktop desktop;
+	cpu::capture_watchdog watchdog{ desktop.fn(), 10ms };
+
+	request r{ { 0, 0, 16, 16 } };
+
+	desktop.hold = true;
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::timed_out);
+	desktop.wait_started(1);
+
+	std::thread release{ [&]
+	{
+		std::this_thread::sleep_for(30ms);
+		desktop.hold = false;
+	} };
+
+	watchdog.stop();
+	release.join();
+
+	CHECK(desktop.finished == 1);
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::failed);
+}
+
+TEST(a_bounded_stop_waits_for_captures_finishing_in_time)
+{
+	fake_desktop desktop;
+	cpu::capture_watchdog watchdog{ desktop.fn(), 10ms };
+
+	request r{ { 0, 0, 16, 16 } };
+
+	// idle workers are done straight away
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::captured);
+
+	desktop.hold = true;
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::timed_out);
+	desktop.wait_started(2);
+
+	std::thread release{ [&]
+	{
+		std::this_thread::sleep_for(30ms);
+		desktop.hold = false;
+	} };
+
+	CHECK(watchdog.stop(10s));
+	release.join();
+
+	CHECK(desktop.finished == 2);
+	CHECK(watchdog.capture(r.area, r.dest()) == outcome::failed);
+}
+
+TEST(a_bounded_stop_gives_up_on_a_stuck_capture)
+{
+	// like the hook's, never destroyed, the detached worker may outlive the test
+	auto* desktop = new fake_desktop;
+	auto* watchdog = new cpu::capture_watchdog{ desktop->fn(), 10ms };
+
+	request r{ { 0, 0, 16, 16 } };
+
+	desktop->hold = true;
+	CHECK(watchdog->capture(r.area, r.dest()) == outcome::timed_out);
+	desktop->wait_started(1);
+
+	const auto start = cpu::capture_watchdog::clock::now();
+	CHECK(!watchdog->stop(20ms));
+	CHECK(cpu::capture_watchdog::clock::now() - start < 5s);
+
+	CHECK(desktop->finished == 0);
+	CHECK(watchdog->capture(r.area, r.dest()) == outcome::failed);
+
+	// the detached worker still finishes, into its own buffer
+	desktop->hold = false;
+	while (watchdog->late() < 1)
+		std::this_thread::sleep_for(1ms);
+
+	CHECK(r.untouched());
+}
+
+TEST(captures_around_the_budget_from_many_threads_are_whole_or_untouched)
+{
+	fake_desktop desktop;
+	cpu::capture_watchdog watchdog{ [&](const cpu::rect& area, const cpu::bitmap_view& dest)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(area.left * 7919 % 8000));
+		return desktop.capture(area, dest);
+	}, 4ms, 4 };
+
+	constexpr int threads = 8;
+	constexpr int per_thread = 40;
+
+	std::atomic<int> bad{ 0 };
+	std::vector<std::thread> callers;
+
+	for (int t = 0; t < threads; t++)
+	{
+		callers.emplace_back([&, t]
+		{
+			for (int i = 0; i < per_thread; i++)
+			{
+				const int left = t * per_thread + i;
+				request r{ { left, 0, left + 16, 8 } };
+
+				const auto result = watchdog.capture(r.area, r.dest());
+
+				if (result == outcome::captured ? !r.correct() : !r.untouched())
+					bad++;
+			}
+		});
+	}
+
+	for (auto& caller : callers)
+		caller.join();
+
+	watchdog.stop();
+
+	CHECK(bad == 0);
+	CHECK(watchdog.captured() + watchdog.timed_out() == threads * per_thread);
+	CHECK(watchdog.late() + watchdog.cancelled() == watchdog.timed_out());
+}
+
+TEST_MAIN()
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// just enough of a test framework for the cpu backend. TEST registers a case,
+// CHECK reports a condition that does not hold and lets the case carry on
+namespace test
+{
+	struct test_case
+	{
+		const char* name;
+		void (*fn)();
+	};
+
+	inline std::vector<test_case>& cases()
+	{
+		static std::vector<test_case> all;
+		return all;
+	}
+
+	inline int& failures()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	struct registrar
+	{
+		registrar(const char* name, void (*fn)())
+		{
+			cases().push_back({ name, fn });
+		}
+	};
+
+	inline void fail(const char* file, int line, const char* condition)
+	{
+		std::printf("%s:%d: CHECK(%s) failed\n", file, line, condition);
+		failures()++;
+	}
+
+	inline int run_all()
+	{
+		for (const auto& c : cases())
+		{
+			const int before = failures();
+			c.fn();
+			std::printf("%s %s\n", failures() == before ? "ok  " : "FAIL", c.name);
+		}
+
+		return failures() ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static const test::registrar name##_registrar{ #name, name }; \
+	static void name()
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+			test::fail(__FILE__, __LINE__, #condition); \
+	} while (false)
+
+#define TEST_MAIN() \
+	int main() \
+	{ \
+		return test::run_all(); \
+	}
@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/dib_target.hpp"
+
+namespace
+{
+	constexpr int width = 10;
+	constexpr int height = 6;
+
+	// a dib whose rows are padded, every pixel holds its own position
+	struct fake_dib
+	{
+		std::vector<uint32_t> bits;
+		cpu::dib_desc desc;
+
+		explicit fake_dib(bool bottom_up) :
+			bits((width + 2) * height)
+		{
+			desc = { reinterpret_cast<uint8_t*>(bits.data()), width, height, (width + 2) * 4, bottom_up };
+
+			// memory row r is image row r top down, or height - 1 - r bottom up
+			for (int r = 0; r < height; r++)
+			{
+				for (int x = 0; x < width; x++)
+					bits[r * (width + 2) + x] = static_cast<uint32_t>(((bottom_up ? height - 1 - r : r) << 8) | x);
+			}
+		}
+	};
+
+	uint32_t pixel(const cpu::bitmap_view& view, int x, int y)
+	{
+		return reinterpret_cast<const uint32_t*>(view.data + view.pitch * y)[x];
+	}
+
+	bool maps_block(const fake_dib& dib, int x, int y, int w, int h)
+	{
+		cpu::bitmap_view view;
+		if (!cpu::dib_target(dib.desc, x, y, w, h, view) || view.width != w || view.height != h)
+			return false;
+
+		bool same = true;
+		for (int row = 0; row < h; row++)
+		{
+			for (int col = 0; col < w; col++)
+				same &= pixel(view, col, row) == static_cast<uint32_t>(((y + row) << 8) | (x + col));
+		}
+
+		return same;
+	}
+}
+
+TEST(top_down_and_bottom_up_blocks_read_top_down)
+{
+	for (const bool bottom_up : { false, true })
+	{
+		const fake_dib dib{ bottom_up };
+
+		CHECK(maps_block(dib, 0, 0, width, height));
+		CHECK(maps_block(dib, 3, 2, 4, 3));
+		CHECK(maps_block(dib, width - 1, height - 1, 1, 1));
+
+		cpu::bitmap_view view;
+		cpu::dib_target(dib.desc, 0, 0, 1, 1, view);
+		CHECK(bottom_up ? view.pitch < 0 : view.pitch > 0);
+	}
+}
+
+TEST(blocks_outside_the_dib_are_refused)
+{
+	const fake_dib dib{ true };
+	cpu::bitmap_view view;
+
+	CHECK(!cpu::dib_target(dib.desc, -1, 0, 2, 2, view));
+	CHECK(!cpu::dib_target(dib.desc, 0, -1, 2, 2, view));
+	CHECK(!cpu::dib_target(dib.desc, 1, 0, width, 1, view));
+	CHECK(!cpu::dib_target(dib.desc, 0, 1, 1, height, view));
+	CHECK(!cpu::dib_target(dib.desc, 0, 0, 0, 1, view));
+	CHECK(!cpu::dib_target(dib.desc, 0, 0, 1, 0, view));
+}
+
+TEST(broken_descriptions_are_refused)
+{
+	fake_dib dib{ false };
+	cpu::bitmap_view view;
+
+	auto no_bits = dib.desc;
+	no_bits.bits = nullptr;
+	CHECK(!cpu::dib_target(no_bits, 0, 0, 1, 1, view));
+
+	auto short_stride = dib.desc;
+	short_stride.stride = width * 4 - 4;
+	CHECK(!cpu::dib_target(short_stride, 0, 0, 1, 1, view));
+}
+
+TEST_MAIN()
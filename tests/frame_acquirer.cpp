@@ -0,0 +1,217 @@
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <utility>
+
+#include "check.hpp"
+#include "cpu/frame_acquirer.hpp"
+
+namespace
+{
+	using namespace std::chrono_literals;
+	using status = cpu::duplication_source::acquire_status;
+	using result = cpu::frame_acquirer::result;
+
+	// answers acquire from a script, a timeout sleeps for the time it was
+	// given like dxgi would. checks that frames are released exactly once
+	// and never held across acquires
+	struct scripted_source : cpu::duplication_source
+	{
+		struct step
+		{
+			status s;
+			bool presented = true;
+		};
+
+		std::deque<step> script;
+		std::deque<unsigned int> timeouts;
+
+		int retains = 0;
+		int releases = 0;
+		int recreates = 0;
+
+		bool held = false;
+		bool misuse = false;
+
+		status acquire(unsigned int timeout_ms, bool& presented) override
+		{
+			misuse |= held;
+			timeouts.push_back(timeout_ms);
+
+			if (script.empty())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+				return status::timeout;
+			}
+
+			const auto next = script.front();
+			script.pop_front();
+
+			if (next.s == status::timeout)
+				std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+
+			held = next.s == status::frame;
+			presented = next.presented;
+			return next.s;
+		}
+
+		void retain() override
+		{
+			misuse |= !held;
+			retains++;
+		}
+
+		void release() override
+		{
+			misuse |= !held;
+			held = false;
+			releases++;
+		}
+
+		void recreate() override
+		{
+			recreates++;
+		}
+	};
+}
+
+TEST(the_first_frame_is_waited_for_and_retained)
+{
+	scripted_source source;
+	source.script = { { status::frame } };
+
+	cpu::frame_acquirer acquirer{ 1ms, 1s };
+
+	CHECK(!acquirer.has_retained());
+	CHECK(acquirer.acquire(source) == result::fresh);
+	CHECK(acquirer.has_retained());
+
+	// the whole first wait was offered
+	CHECK(source.timeouts.front() == 1000);
+	CHECK(source.retains == 1 && source.releases == 1);
+	CHECK(!source.misuse && !source.held);
+}
+
+TEST(a_static_desktop_settles_for_the_retained_frame)
+{
+	scripted_source source;
+	source.script = { { status::frame } };
+
+	cpu::frame_acquirer acquirer{ 2ms, 1s };
+	acquirer.acquire(source);
+
+	for (int i = 0; i < 20; i++)
+		CHECK(acquirer.acquire(source) == result::retained);
+
+	// only the short wait for a fresh frame, never the first one
+	source.timeouts.pop_front();
+	for (const auto timeout : source.timeouts)
+		CHECK(timeout <= 2);
+
+	CHECK(acquirer.waits().recorded() == 21);
+	CHECK(acquirer.waits().percentile(0.5) < 100.0);
+	CHECK(!source.misuse);
+}
+
+TEST(pointer_only_frames_are_released_and_waited_past)
+{
+	scripted_source source;
+	source.script = { { status::frame, false }, { status::frame, false }, { status::frame, true } };
+
+	cpu::frame_acquirer acquirer{ 1ms, 1s };
+
+	CHECK(acquirer.acquire(source) == result::fresh);
+	CHECK(source.releases == 3 && source.retains == 1);
+	CHECK(!source.misuse);
+
+	// past the budget a pointer frame is just released
+	source.script = { { status::frame, false } };
+	std::this_thread::sleep_for(5ms);
+
+	const auto r = acquirer.acquire(source);
+	CHECK(r == result::retained);
+	CHECK(source.retains == 1);
+	CHECK(!source.misuse && !source.held);
+}
+
+TEST(nothing_presented_fails_after_the_first_wait)
+{
+	scripted_source source;
+	cpu::frame_acquirer acquirer{ 1ms, 30ms };
+
+	const auto start = std::chrono::steady_clock::now();
+	CHECK(acquirer.acquire(source) == result::failed);
+
+	CHECK(std::chrono::steady_clock::now() - start >= 30ms);
+	CHECK(acquirer.waits().last() >= 30.0);
+	CHECK(source.retains == 0 && source.releases == 0);
+}
+
+TEST(access_lost_recreates_and_waits_for_the_first_frame)
+{
+	scripted_source source;
+	source.script = { { status::frame } };
+
+	cpu::frame_acquirer acquirer{ 1ms, 1s };
+	acquirer.acquire(source);
+
+	source.timeouts.clear();
+	source.script = { { status::access_lost }, { status::frame } };
+
+	CHECK(acquirer.acquire(source) == result::fresh);
+	CHECK(source.recreates == 1);
+
+	// after recreating, the first wait applies again
+	CHECK(source.timeouts.size() == 2 && source.timeouts[1] == 1000);
+	CHECK(!source.misuse);
+}
+
+TEST(losing_access_over_and_over_fails)
+{
+	scripted_source source;
+	source.script.assign(10, { status::access_lost });
+
+	cpu::frame_acquirer acquirer{ 1ms, 1s };
+
+	CHECK(acquirer.acquire(source) == result::failed);
+	CHECK(source.recreates == 3);
+	CHECK(!acquirer.has_retained());
+}
+
+TEST(a_failed_acquire_fails_right_away)
+{
+	scripted_source source;
+	source.script = { { status::frame }, { status::failed } };
+
+	cpu::frame_acquirer acquirer{ 1ms, 1s };
+	acquirer.acquire(source);
+
+	CHECK(acquirer.acquire(source) == result::failed);
+
+	// forget makes the next acquire wait for a first frame again
+	acquirer.forget();
+	CHECK(!acquirer.has_retained());
+
+	source.timeouts.clear();
+	source.script = { { status::frame } };
+	CHECK(acquirer.acquire(source) == result::fresh);
+	CHECK(source.timeouts.front() == 1000);
+}
+
+TEST(wait_stats_keep_the_last_samples)
+{
+	cpu::wait_stats stats{ 4 };
+
+	CHECK(stats.percentile(0.5) == 0.0);
+
+	for (const double ms : { 100.0, 1.0, 2.0, 3.0, 4.0 })
+		stats.record(ms);
+
+	// 100 fell out of the window
+	CHECK(stats.recorded() == 5);
+	CHECK(stats.last() == 4.0);
+	CHECK(stats.percentile(1.0) == 4.0);
+	CHECK(stats.percentile(0.0) == 1.0);
+}
+
+TEST_MAIN()
@@ -0,0 +1,134 @@
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/frame_cache.hpp"
+
+namespace
+{
+	// a frame whose every pixel says where it is on the desktop
+	std::vector<uint32_t> frame(const cpu::rect& area)
+	{
+		std::vector<uint32_t> pixels(static_cast<size_t>(area.width()) * area.height());
+
+		for (int y = 0; y < area.height(); y++)
+		{
+			for (int x = 0; x < area.width(); x++)
+				pixels[static_cast<size_t>(y) * area.width() + x] = (static_cast<uint32_t>(area.top + y) << 16) | static_cast<uint32_t>(area.left + x);
+		}
+
+		return pixels;
+	}
+
+	void store(cpu::frame_cache& cache, const cpu::rect& area, uint64_t generation, int64_t present_time)
+	{
+		const auto pixels = frame(area);
+		cache.store(area, generation, present_time, reinterpret_cast<const uint8_t*>(pixels.data()), area.width() * 4);
+	}
+
+	bool lookup(cpu::frame_cache& cache, const cpu::rect& request, uint64_t generation, int64_t present_time)
+	{
+		std::vector<uint32_t> out(static_cast<size_t>(request.width()) * request.height());
+		const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), request.width(), request.height(), request.width() * 4 };
+
+		if (!cache.lookup(request, generation, present_time, dest))
+			return false;
+
+		CHECK(out == frame(request));
+		return true;
+	}
+}
+
+TEST(a_request_inside_the_frame_is_cropped_out)
+{
+	cpu::frame_cache cache{ std::chrono::seconds(10) };
+	store(cache, { -100, 0, 300, 200 }, 1, 50);
+
+	CHECK(lookup(cache, { -100, 0, 300, 200 }, 1, 50));
+	CHECK(lookup(cache, { 10, 20, 30, 25 }, 1, 50));
+	CHECK(lookup(cache, { -100, 199, -99, 200 }, 1, 0));
+
+	CHECK(cache.hits() == 3);
+	CHECK(cache.misses() == 0);
+}
+
+TEST(a_request_reaching_outside_misses)
+{
+	cpu::frame_cache cache{ std::chrono::seconds(10) };
+	store(cache, { 0, 0, 100, 100 }, 1, 50);
+
+	CHECK(!lookup(cache, { 50, 50, 101, 60 }, 1, 50));
+	CHECK(!lookup(cache, { -1, 0, 10, 10 }, 1, 50));
+	CHECK(!lookup(cache, { 10, 10, 10, 10 }, 1, 50));
+	CHECK(cache.misses() == 3);
+}
+
+TEST(a_newer_present_time_misses)
+{
+	cpu::frame_cache cache{ std::chrono::seconds(10) };
+	store(cache, { 0, 0, 100, 100 }, 1, 50);
+
+	// another capture acquired a newer frame on one of the monitors
+	CHECK(!lookup(cache, { 0, 0, 10, 10 }, 1, 51));
+	CHECK(lookup(cache, { 0, 0, 10, 10 }, 1, 50));
+}
+
+TEST(another_topology_generation_misses)
+{
+	cpu::frame_cache cache{ std::chrono::seconds(10) };
+	store(cache, { 0, 0, 100, 100 }, 1, 50);
+
+	CHECK(!lookup(cache, { 0, 0, 10, 10 }, 2, 50));
+}
+
+TEST(the_frame_expires_after_the_ttl)
+{
+	cpu::frame_cache cache{ std::chrono::milliseconds(20) };
+	store(cache, { 0, 0, 100, 100 }, 1, 50);
+
+	CHECK(lookup(cache, { 0, 0, 10, 10 }, 1, 50));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(40));
+	CHECK(!lookup(cache, { 0, 0, 10, 10 }, 1, 50));
+}
+
+TEST(invalidate_drops_the_frame_and_its_buffer)
+{
+	cpu::pixel_pool::shared().trim();
+	const auto held = cpu::pixel_pool::shared().held_bytes();
+
+	{
+		cpu::frame_cache cache{ std::chrono::seconds(10) };
+		store(cache, { 0, 0, 100, 100 }, 1, 50);
+
+		CHECK(cpu::pixel_pool::shared().held_bytes() > held);
+
+		cache.invalidate();
+		CHECK(!lookup(cache, { 0, 0, 10, 10 }, 1, 50));
+	}
+
+	cpu::pixel_pool::shared().trim();
+	CHECK(cpu::pixel_pool::shared().held_bytes() == held);
+}
+
+TEST(storing_reuses_the_buffer)
+{
+	cpu::frame_cache cache{ std::chrono::seconds(10) };
+	store(cache, { 0, 0, 640, 480 }, 1, 50);
+
+	const auto allocated = cpu::pixel_pool::shared().allocated_bytes();
+	const auto reused = cpu::pixel_pool::shared().reused_bytes();
+
+	// smaller or equal frames land in the buffer already held
+	for (int i = 0; i < 10; i++)
+		store(cache, { i, i, 600 + i, 400 + i }, 1, 50 + i);
+
+	CHECK(cpu::pixel_pool::shared().allocated_bytes() == allocated);
+	CHECK(cpu::pixel_pool::shared().reused_bytes() == reused);
+
+	CHECK(lookup(cache, { 9, 9, 609, 409 }, 1, 59));
+}
+
+TEST_MAIN()
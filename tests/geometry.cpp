@@ -0,0 +1,103 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/geometry.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tonemapper.hpp"
+
+namespace
+{
+	bool same(const cpu::rect& a, const cpu::rect& b)
+	{
+		return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+	}
+
+	const cpu::rotation_t rotations[] =
+	{
+		cpu::rotation_t::identity, cpu::rotation_t::rotate90, cpu::rotation_t::rotate180, cpu::rotation_t::rotate270,
+	};
+}
+
+TEST(intersect_and_unite)
+{
+	CHECK(same(cpu::intersect({ 0, 0, 10, 10 }, { 5, -5, 20, 5 }), { 5, 0, 10, 5 }));
+	CHECK(cpu::intersect({ 0, 0, 10, 10 }, { 10, 0, 20, 10 }).empty());
+
+	CHECK(same(cpu::unite({ 0, 0, 10, 10 }, { 5, -5, 20, 5 }), { 0, -5, 20, 10 }));
+	CHECK(same(cpu::unite({}, { 5, 5, 6, 6 }), { 5, 5, 6, 6 }));
+	CHECK(same(cpu::unite({ 1, 1, 2, 2 }, { 9, 9, 9, 9 }), { 1, 1, 2, 2 }));
+}
+
+TEST(rotation_from_degrees)
+{
+	CHECK(cpu::rotation_from_degrees(0.0f) == cpu::rotation_t::identity);
+	CHECK(cpu::rotation_from_degrees(90.0f) == cpu::rotation_t::rotate90);
+	CHECK(cpu::rotation_from_degrees(180.0f) == cpu::rotation_t::rotate180);
+	CHECK(cpu::rotation_from_degrees(270.0f) == cpu::rotation_t::rotate270);
+}
+
+TEST(to_source_undoes_to_dest)
+{
+	std::mt19937 rng{ 11 };
+
+	for (const auto rotation : rotations)
+	{
+		for (int i = 0; i < 200; i++)
+		{
+			const cpu::placement p{ 1 + static_cast<int>(rng() % 300), 1 + static_cast<int>(rng() % 300), static_cast<int>(rng() % 600) - 300, static_cast<int>(rng() % 600) - 300, rotation };
+
+			const int l = static_cast<int>(rng() % p.width);
+			const int t = static_cast<int>(rng() % p.height);
+			const cpu::rect src{ l, t, l + 1 + static_cast<int>(rng() % (p.width - l)), t + 1 + static_cast<int>(rng() % (p.height - t)) };
+
+			const auto dest = cpu::to_dest(p, src);
+			CHECK(dest.width() * dest.height() == src.width() * src.height());
+			CHECK(same(cpu::to_source(p, dest), src));
+		}
+	}
+}
+
+TEST(crop_of_a_request_misses_nothing_inside_it)
+{
+	// tonemapping only the cropped part must give the same pixels as the whole
+	// monitor clipped to the request
+	std::mt19937 rng{ 13 };
+	cpu::thread_pool pool{ 3 };
+
+	for (int i = 0; i < 300; i++)
+	{
+		const int width = 1 + static_cast<int>(rng() % 200);
+		const int height = 1 + static_cast<int>(rng() % 200);
+
+		std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+		for (auto& c : pixels)
+			c = static_cast<uint8_t>(rng());
+
+		const int dest_width = 1 + static_cast<int>(rng() % 150);
+		const int dest_height = 1 + static_cast<int>(rng() % 150);
+
+		const cpu::placement p{ width, height, static_cast<int>(rng() % 300) - 150, static_cast<int>(rng() % 300) - 150, rotations[rng() % 4] };
+
+		std::vector<uint8_t> whole(static_cast<size_t>(dest_width) * dest_height * 4), cropped(whole.size());
+		const cpu::bitmap_view whole_view{ whole.data(), dest_width, dest_height, dest_width * 4 };
+		const cpu::bitmap_view cropped_view{ cropped.data(), dest_width, dest_height, dest_width * 4 };
+
+		const cpu::render_job full{ { pixels.data(), width, height, width * 4, cpu::pixel_format::r8g8b8a8_unorm }, p.x, p.y, p.rotation, 200.0f };
+		cpu::tonemap({ &full, 1 }, whole_view, pool);
+
+		cpu::placement sub;
+		const auto region = cpu::crop(p, { 0, 0, dest_width, dest_height }, sub);
+
+		if (!region.empty())
+		{
+			const cpu::render_job part{ { pixels.data() + region.top * width * 4 + region.left * 4, region.width(), region.height(), width * 4, cpu::pixel_format::r8g8b8a8_unorm }, sub.x, sub.y, sub.rotation, 200.0f };
+			cpu::tonemap({ &part, 1 }, cropped_view, pool);
+		}
+
+		CHECK(whole == cropped);
+	}
+}
+
+TEST_MAIN()
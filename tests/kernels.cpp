@@ -0,0 +1,192 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/kernels.hpp"
+#include "cpu/tonemapper.hpp"
+
+namespace
+{
+	std::vector<const cpu::row_kernels*> runnable_kernels()
+	{
+		std::vector<const cpu::row_kernels*> tables{ &cpu::scalar_row_kernels };
+
+#if defined(CPU_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+		const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+
+		if (avx2)
+			tables.push_back(&cpu::avx2_row_kernels);
+
+		if (avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+			&& __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl"))
+			tables.push_back(&cpu::avx512_row_kernels);
+#else
+		if (&cpu::select_row_kernels() != &cpu::scalar_row_kernels)
+			tables.push_back(&cpu::select_row_kernels());
+#endif
+
+		return tables;
+	}
+
+	// fp16 bit patterns covering the interesting parts of the range: negatives,
+	// subnormals, the knees of the curve, values far above the white level
+	std::vector<uint16_t> hdr_pixels(int count, uint32_t seed)
+	{
+		std::mt19937 rng{ seed };
+		std::vector<uint16_t> px(static_cast<size_t>(count) * 4);
+
+		const uint16_t specials[] = { 0x0000, 0x8000, 0x0001, 0x03ff, 0x3c00, 0xbc00, 0x4900, 0x5640, 0x7bff, 0x2e66 };
+
+		for (size_t i = 0; i < px.size(); i++)
+		{
+			if ((i & 3) == 3)
+				px[i] = 0x3c00;
+			else if (rng() % 5 == 0)
+				px[i] = specials[rng() % std::size(specials)];
+			else
+				px[i] = static_cast<uint16_t>(rng() % 0x7c00);
+		}
+
+		return px;
+	}
+
+	int max_channel_diff(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+	{
+		int worst = 0;
+
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			for (int shift = 0; shift < 32; shift += 8)
+			{
+				const int d = std::abs(static_cast<int>((a[i] >> shift) & 0xff) - static_cast<int>((b[i] >> shift) & 0xff));
+				worst = d > worst ? d : worst;
+			}
+		}
+
+		return worst;
+	}
+}
+
+TEST(scalar_kernel_matches_tonemap_hdr)
+{
+	const auto px = hdr_pixels(4096, 1);
+	std::vector<uint32_t> out(4096);
+
+	cpu::scalar_row_kernels.hdr(reinterpret_cast<const uint8_t*>(px.data()), out.data(), 4096, 200.0f);
+
+	for (int i = 0; i < 4096; i++)
+	{
+		const cpu::float3 color{ cpu::half_to_float(px[i * 4]), cpu::half_to_float(px[i * 4 + 1]), cpu::half_to_float(px[i * 4 + 2]) };
+		CHECK(out[i] == cpu::pack_bgra(cpu::tonemap_hdr(color, 200.0f)));
+	}
+}
+
+TEST(vector_hdr_kernels_stay_within_one_lsb_of_scalar)
+{
+	const float white_levels[] = { 80.0f, 200.0f, 480.0f };
+
+	// counts that leave every possible tail after 8 and 16 lanes
+	for (const auto* kernels : runnable_kernels())
+	{
+		for (int count = 1; count <= 70; count += 3)
+		{
+			for (const float white : white_levels)
+			{
+				const auto px = hdr_pixels(count, count);
+				const auto* src = reinterpret_cast<const uint8_t*>(px.data());
+
+				std::vector<uint32_t> expected(count), out(count + 1, 0xdeadbeefu);
+
+				cpu::scalar_row_kernels.hdr(src, expected.data(), count, white);
+				kernels->hdr(src, out.data(), count, white);
+
+				// nothing past count is written
+				CHECK(out[count] == 0xdeadbeefu);
+				out.pop_back();
+
+				CHECK(max_channel_diff(out, expected) <= 1);
+			}
+		}
+	}
+}
+
+TEST(vector_sdr_kernels_match_scalar_exactly)
+{
+	std::mt19937 rng{ 7 };
+
+	for (const auto* kernels : runnable_kernels())
+	{
+		for (int count = 1; count <= 100; count += 7)
+		{
+			std::vector<uint8_t> px(static_cast<size_t>(count) * 4);
+			for (auto& c : px)
+				c = static_cast<uint8_t>(rng());
+
+			std::vector<uint32_t> expected(count), out(count);
+
+			cpu::scalar_row_kernels.sdr(px.data(), expected.data(), count, 0.0f);
+			kernels->sdr(px.data(), out.data(), count, 0.0f);
+
+			CHECK(out == expected);
+			CHECK(expected[0] == (px[2] | (px[1] << 8) | (px[0] << 16) | 0xff000000u));
+		}
+	}
+}
+
+TEST(every_hash_agrees_with_scalar)
+{
+	std::mt19937 rng{ 3 };
+	std::vector<uint8_t> block(64 * 8 * 70);
+
+	for (auto& c : block)
+		c = static_cast<uint8_t>(rng());
+
+	const ptrdiff_t pitch = 64 * 8 + 16;
+
+	for (const auto* kernels : runnable_kernels())
+	{
+		// whole stripes and every kind of tail
+		for (int row_bytes = 1; row_bytes <= 64 * 8; row_bytes += 37)
+		{
+			const auto expected = cpu::scalar_row_kernels.hash(block.data(), pitch, row_bytes, 64);
+			CHECK(kernels->hash(block.data(), pitch, row_bytes, 64) == expected);
+		}
+	}
+}
+
+TEST(hash_sees_every_byte_and_the_shape)
+{
+	std::vector<uint8_t> block(256 * 16, 0x5a);
+	const auto& kernels = cpu::select_row_kernels();
+
+	const auto base = kernels.hash(block.data(), 256, 256, 16);
+
+	block[255 * 16 + 3]++;
+	CHECK(kernels.hash(block.data(), 256, 256, 16) != base);
+	block[255 * 16 + 3]--;
+
+	// same bytes, different rows
+	CHECK(kernels.hash(block.data(), 128, 128, 32) != base);
+	CHECK(kernels.hash(block.data(), 256, 256, 16) == base);
+}
+
+TEST(selected_kernels_are_runnable)
+{
+	const auto tables = runnable_kernels();
+	const auto& selected = cpu::select_row_kernels();
+
+	bool found = false;
+	for (const auto* kernels : tables)
+		found |= kernels == &selected;
+
+	CHECK(found);
+
+	// the widest one this cpu can run
+	CHECK(tables.back() == &selected);
+}
+
+TEST_MAIN()
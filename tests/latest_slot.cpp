@@ -0,0 +1,112 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/latest_slot.hpp"
+
+TEST(take_sees_only_new_values)
+{
+	cpu::latest_slot<int> slot;
+
+	CHECK(!slot.take());
+
+	slot.back() = 1;
+	slot.publish();
+	slot.back() = 2;
+	slot.publish();
+
+	// the newest one wins, the one in between is dropped
+	CHECK(slot.take());
+	CHECK(slot.front() == 2);
+	CHECK(!slot.take());
+	CHECK(slot.front() == 2);
+
+	slot.back() = 3;
+	slot.publish();
+
+	CHECK(slot.take());
+	CHECK(slot.front() == 3);
+}
+
+TEST(the_producer_never_writes_what_the_consumer_holds)
+{
+	cpu::latest_slot<int> slot;
+
+	for (int i = 0; i < 100; i++)
+	{
+		slot.back() = i;
+		slot.publish();
+
+		if (i % 3 == 0)
+		{
+			slot.take();
+
+			// publishing more must not touch front
+			const int* held = &slot.front();
+			const int value = *held;
+
+			for (int j = 0; j < 5; j++)
+			{
+				CHECK(&slot.back() != held);
+				slot.back() = -1;
+				slot.publish();
+			}
+
+			CHECK(*held == value);
+		}
+	}
+}
+
+TEST(values_arrive_whole_and_in_order_across_threads)
+{
+	cpu::latest_slot<std::vector<uint64_t>> slot;
+	std::atomic<bool> done{ false };
+
+	constexpr uint64_t count = 200000;
+
+	std::thread producer{ [&]
+	{
+		for (uint64_t n = 1; n <= count; n++)
+		{
+			slot.back().assign(16, n);
+			slot.publish();
+		}
+
+		done = true;
+	} };
+
+	bool whole = true;
+	bool ordered = true;
+	uint64_t last = 0;
+
+	const auto check_front = [&]
+	{
+		const auto& value = slot.front();
+
+		for (const auto v : value)
+			whole &= v == value[0];
+
+		ordered &= value[0] >= last;
+		last = value[0];
+	};
+
+	while (!done)
+	{
+		if (slot.take())
+			check_front();
+	}
+
+	producer.join();
+
+	// unless the loop took the last value already
+	if (slot.take())
+		check_front();
+
+	CHECK(whole);
+	CHECK(ordered);
+	CHECK(last == count);
+}
+
+TEST_MAIN()
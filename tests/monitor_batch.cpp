@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/monitor_batch.hpp"
+#include "cpu/retained_frame.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tile_cache.hpp"
+
+namespace
+{
+	// one monitor, rendered once per monitor and once batched into a
+	// retained frame each
+	struct fake_monitor
+	{
+		cpu::placement place;
+		cpu::pixel_format format;
+		float white_level;
+		std::vector<uint8_t> pixels;
+
+		cpu::retained_frame single;
+		cpu::retained_frame batched;
+
+		void scribble(std::mt19937& rng)
+		{
+			pixels.resize(static_cast<size_t>(place.width) * place.height * cpu::bytes_per_pixel(format));
+
+			if (format == cpu::pixel_format::r16g16b16a16_float)
+			{
+				for (size_t i = 0; i < pixels.size(); i += 2)
+				{
+					const auto half = static_cast<uint16_t>(0x3000 + rng() % 0x1800);
+					std::memcpy(&pixels[i], &half, 2);
+				}
+			}
+			else
+			{
+				for (auto& b : pixels)
+					b = static_cast<uint8_t>(rng());
+			}
+		}
+
+		// region of the frame the way the staging texture holds it
+		cpu::image_view view(const cpu::rect& region) const
+		{
+			const int bpp = cpu::bytes_per_pixel(format);
+			const auto pitch = static_cast<ptrdiff_t>(place.width) * bpp;
+
+			return { pixels.data() + pitch * region.top + region.left * bpp, region.width(), region.height(), pitch, format };
+		}
+	};
+}
+
+TEST(batched_renders_match_rendering_every_monitor_alone)
+{
+	std::mt19937 rng{ 42 };
+	cpu::thread_pool pool{ 3 };
+
+	for (int layout = 0; layout < 150; layout++)
+	{
+		// up to four monitors in a row, the request cuts into the outer ones
+		std::vector<fake_monitor> monitors(1 + rng() % 4);
+
+		int x = -static_cast<int>(rng() % 100);
+		int bottom = 0;
+
+		for (auto& m : monitors)
+		{
+			const int w = 64 + static_cast<int>(rng() % 500);
+			const int h = 64 + static_cast<int>(rng() % 400);
+			const auto rotation = static_cast<cpu::rotation_t>(rng() % 4);
+			const bool transposed = rotation == cpu::rotation_t::rotate90 || rotation == cpu::rotation_t::rotate270;
+			const int y = static_cast<int>(rng() % 120) - 60;
+
+			m.place = { w, h, x, y, rotation };
+			m.format = rng() % 2 ? cpu::pixel_format::r16g16b16a16_float : cpu::pixel_format::r8g8b8a8_unorm;
+			m.white_level = rng() % 2 ? 200.0f : 80.0f;
+			m.scribble(rng);
+
+			x += transposed ? h : w;
+			bottom = std::max(bottom, y + (transposed ? w : h));
+		}
+
+		const int width = std::max(1, x - static_cast<int>(rng() % 200));
+		const int height = std::max(1, bottom - static_cast<int>(rng() % 60));
+
+		std::vector<uint8_t> single(static_cast<size_t>(width) * height * 4), batched(single.size());
+		const cpu::bitmap_view single_dest{ single.data(), width, height, width * 4 };
+		const cpu::bitmap_view batched_dest{ batched.data(), width, height, width * 4 };
+
+		cpu::tile_cache single_cache{ 8 << 20 }, batched_cache{ 8 << 20 };
+
+		for (int frame = 0; frame < 3; frame++)
+		{
+			std::vector<cpu::monitor_params> table;
+			std::vector<cpu::retained_frame*> frames;
+			std::vector<cpu::image_view> sources;
+
+			for (auto& m : monitors)
+			{
+				if (frame)
+				{
+					const int left = static_cast<int>(rng() % m.place.width);
+					const int top = static_cast<int>(rng() % m.place.height);
+					const cpu::rect damage{ left, top, left + 1 + static_cast<int>(rng() % 200), top + 1 + static_cast<int>(rng() % 200) };
+
+					m.scribble(rng);
+					m.single.damage(damage);
+					m.batched.damage(damage);
+				}
+
+				cpu::monitor_params params;
+				if (!cpu::make_monitor_params(m.place, m.format, m.white_level, width, height, params))
+					continue;
+
+				m.single.prepare(m.place.width, m.place.height, m.format, m.white_level);
+				m.batched.prepare(m.place.width, m.place.height, m.format, m.white_level);
+
+				std::vector<cpu::rect> stale;
+				m.batched.pending(params.region, stale);
+
+				m.single.update(m.view(params.region), params.region, pool, &single_cache);
+				m.single.compose(params.region, params.visible, single_dest, pool);
+
+				table.push_back(params);
+				frames.push_back(&m.batched);
+				sources.push_back(stale.empty() ? cpu::image_view{} : m.view(params.region));
+			}
+
+			cpu::render_batch(table, frames, sources, batched_dest, pool, &batched_cache);
+			CHECK(single == batched);
+		}
+	}
+}
+
+TEST(monitors_outside_the_request_get_no_params)
+{
+	cpu::monitor_params params;
+
+	CHECK(!cpu::make_monitor_params({ 100, 100, 200, 0, cpu::rotation_t::identity }, cpu::pixel_format::r8g8b8a8_unorm, 200.0f, 200, 100, params));
+	CHECK(!cpu::make_monitor_params({ 100, 100, -100, 0, cpu::rotation_t::identity }, cpu::pixel_format::r8g8b8a8_unorm, 200.0f, 200, 100, params));
+
+	CHECK(cpu::make_monitor_params({ 100, 100, 150, -50, cpu::rotation_t::identity }, cpu::pixel_format::r8g8b8a8_unorm, 80.0f, 200, 100, params));
+	CHECK(params.region.left == 0 && params.region.top == 50 && params.region.right == 50 && params.region.bottom == 100);
+	CHECK(params.white_level == 80.0f);
+}
+
+TEST_MAIN()
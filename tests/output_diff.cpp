@@ -0,0 +1,110 @@
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/output_diff.hpp"
+
+namespace
+{
+	constexpr auto npos = cpu::output_diff::npos;
+
+	// a 1080p sdr output at x
+	cpu::output_key output(const wchar_t* name, int x, cpu::rotation_t rotation = cpu::rotation_t::identity)
+	{
+		const bool transposed = rotation == cpu::rotation_t::rotate90 || rotation == cpu::rotation_t::rotate270;
+		return { name, { x, 0, x + (transposed ? 1080 : 1920), transposed ? 1920 : 1080 }, rotation };
+	}
+
+	const std::vector<cpu::output_key> three
+	{
+		output(L"\\\\.\\DISPLAY1", 0),
+		output(L"\\\\.\\DISPLAY2", 1920),
+		output(L"\\\\.\\DISPLAY3", 3840),
+	};
+}
+
+TEST(unchanged_outputs_are_all_kept)
+{
+	const auto diff = cpu::diff_outputs(three, three);
+
+	CHECK((diff.kept_from == std::vector<size_t>{ 0, 1, 2 }));
+	CHECK(diff.removed.empty());
+	CHECK(diff.kept() == 3 && diff.added() == 0);
+}
+
+TEST(the_first_enumeration_adds_everything)
+{
+	const auto diff = cpu::diff_outputs({}, three);
+
+	CHECK(diff.kept() == 0 && diff.added() == 3);
+	CHECK(diff.removed.empty());
+}
+
+TEST(rotated_or_moved_outputs_are_replaced)
+{
+	auto now = three;
+	now[1] = output(L"\\\\.\\DISPLAY2", 1920, cpu::rotation_t::rotate90);
+	now[2] = output(L"\\\\.\\DISPLAY3", 3000);
+
+	const auto diff = cpu::diff_outputs(three, now);
+
+	CHECK((diff.kept_from == std::vector<size_t>{ 0, npos, npos }));
+	CHECK((diff.removed == std::vector<size_t>{ 1, 2 }));
+}
+
+TEST(an_hdr_or_color_space_change_replaces_the_output)
+{
+	auto now = three;
+	now[0].hdr = true;
+	now[0].color_space = 12;
+	now[2].color_space = 1;
+
+	const auto diff = cpu::diff_outputs(three, now);
+
+	CHECK((diff.kept_from == std::vector<size_t>{ npos, 1, npos }));
+	CHECK((diff.removed == std::vector<size_t>{ 0, 2 }));
+
+	// and back again
+	CHECK(cpu::diff_outputs(now, now).kept() == 3);
+}
+
+TEST(plugging_and_unplugging_keeps_the_rest)
+{
+	auto now = three;
+	now.push_back(output(L"\\\\.\\DISPLAY4", 5760));
+	now.erase(now.begin());
+
+	const auto diff = cpu::diff_outputs(three, now);
+
+	CHECK((diff.kept_from == std::vector<size_t>{ 1, 2, npos }));
+	CHECK((diff.removed == std::vector<size_t>{ 0 }));
+	CHECK(diff.added() == 1);
+}
+
+TEST(a_new_enumeration_order_is_followed)
+{
+	const std::vector<cpu::output_key> now{ three[2], three[0], three[1] };
+	const auto diff = cpu::diff_outputs(three, now);
+
+	CHECK((diff.kept_from == std::vector<size_t>{ 2, 0, 1 }));
+	CHECK(diff.removed.empty());
+}
+
+TEST(an_earlier_output_is_continued_at_most_once)
+{
+	// the same display reported twice, only one of them takes the monitor over
+	const std::vector<cpu::output_key> now{ three[0], three[0] };
+	const auto diff = cpu::diff_outputs(three, now);
+
+	CHECK((diff.kept_from == std::vector<size_t>{ 0, npos }));
+	CHECK((diff.removed == std::vector<size_t>{ 1, 2 }));
+}
+
+TEST(everything_unplugged_removes_everything)
+{
+	const auto diff = cpu::diff_outputs(three, {});
+
+	CHECK(diff.kept_from.empty());
+	CHECK((diff.removed == std::vector<size_t>{ 0, 1, 2 }));
+}
+
+TEST_MAIN()
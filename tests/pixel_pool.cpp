@@ -0,0 +1,94 @@
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "check.hpp"
+#include "cpu/pixel_pool.hpp"
+
+namespace
+{
+	constexpr size_t mb = 1 << 20;
+	constexpr size_t frame_4k = 3840 * 2160 * 4;
+}
+
+TEST(buffers_are_page_aligned_and_big_enough)
+{
+	cpu::pixel_pool pool{ 64 * mb };
+
+	for (const size_t size : { size_t{ 1 }, size_t{ 4097 }, size_t{ 1920 * 1080 * 4 }, frame_4k })
+	{
+		auto buffer = pool.acquire(size);
+
+		CHECK(buffer && buffer.size() == size && buffer.capacity() >= size);
+		CHECK(reinterpret_cast<uintptr_t>(buffer.data()) % 4096 == 0);
+
+		// at most a quarter wasted, plus the rounding to whole pages
+		CHECK(buffer.capacity() <= size + size / 4 + (2 * mb));
+
+		std::memset(buffer.data(), 0xab, buffer.size());
+	}
+}
+
+TEST(a_released_buffer_is_reused_for_a_nearby_size)
+{
+	cpu::pixel_pool pool{ 64 * mb };
+
+	uint8_t* data;
+	{
+		auto buffer = pool.acquire(frame_4k);
+		data = buffer.data();
+	}
+
+	CHECK(pool.idle_bytes() == pool.held_bytes());
+
+	auto again = pool.acquire(frame_4k + 4096);
+	CHECK(again.data() == data);
+	CHECK(pool.idle_bytes() == 0);
+	CHECK(pool.reused_bytes() == again.capacity());
+	CHECK(pool.allocated_bytes() == again.capacity());
+}
+
+TEST(idle_memory_is_bounded_and_trimmed)
+{
+	cpu::pixel_pool pool{ 40 * mb };
+
+	{
+		auto a = pool.acquire(frame_4k);
+		auto b = pool.acquire(frame_4k);
+		auto c = pool.acquire(frame_4k);
+
+		CHECK(pool.held_bytes() == a.capacity() * 3);
+	}
+
+	// only what fits under the bound stays idle, the rest went back to the os
+	CHECK(pool.idle_bytes() <= 40 * mb);
+	CHECK(pool.idle_bytes() > 0);
+	CHECK(pool.held_bytes() == pool.idle_bytes());
+
+	pool.trim();
+	CHECK(pool.held_bytes() == 0 && pool.idle_bytes() == 0);
+}
+
+TEST(moving_a_buffer_hands_it_back_once)
+{
+	cpu::pixel_pool pool{ 64 * mb };
+
+	{
+		auto a = pool.acquire(frame_4k);
+		auto b = std::move(a);
+
+		CHECK(!a && b);
+
+		cpu::pixel_buffer c;
+		c = std::move(b);
+		CHECK(!b && c && c.size() == frame_4k);
+	}
+
+	CHECK(pool.idle_bytes() == pool.held_bytes());
+
+	auto x = pool.acquire(frame_4k);
+	auto y = pool.acquire(frame_4k);
+	CHECK(x.data() != y.data());
+}
+
+TEST_MAIN()
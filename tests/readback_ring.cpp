@@ -0,0 +1,202 @@
+#include <cstdint>
+#include <map>
+
+#include "check.hpp"
+#include "cpu/readback_ring.hpp"
+
+namespace
+{
+	using status = cpu::readback_device::map_status;
+
+	// textures are plain allocations, every copy stays in flight for
+	// busy_polls non blocking maps
+	struct fake_device : cpu::readback_device
+	{
+		struct texture
+		{
+			int width;
+			int height;
+			uint32_t format;
+			int polls = 0;
+			bool mapped = false;
+		};
+
+		std::map<void*, texture> live;
+		int created = 0;
+		int busy_polls = 0;
+		bool misuse = false;
+
+		void* create_staging(int width, int height, uint32_t format) override
+		{
+			auto* handle = new char;
+			live[handle] = { width, height, format };
+			created++;
+			return handle;
+		}
+
+		void release_staging(void* handle) override
+		{
+			misuse |= !live.count(handle) || live[handle].mapped;
+			live.erase(handle);
+			delete static_cast<char*>(handle);
+		}
+
+		status map(void* handle, bool do_not_wait, cpu::mapped_view& mapped) override
+		{
+			auto& t = live.at(handle);
+			misuse |= t.mapped;
+
+			if (do_not_wait && t.polls++ < busy_polls)
+				return status::busy;
+
+			t.mapped = true;
+			mapped = { static_cast<const uint8_t*>(handle), t.width * 4 };
+			return status::ok;
+		}
+
+		void unmap(void* handle) override
+		{
+			auto& t = live.at(handle);
+			misuse |= !t.mapped;
+
+			t.mapped = false;
+			t.polls = 0;
+		}
+	};
+
+	void read(cpu::readback_ring& ring, void* texture)
+	{
+		cpu::mapped_view mapped;
+		ring.map(texture, mapped);
+		ring.unmap(texture);
+	}
+}
+
+TEST(a_returned_texture_is_reused)
+{
+	fake_device device;
+
+	{
+		cpu::readback_ring ring{ device };
+
+		for (int i = 0; i < 50; i++)
+			read(ring, ring.acquire(1920, 1080, 87));
+
+		CHECK(device.created == 1);
+		CHECK(ring.acquires() == 50 && ring.reuses() == 49);
+	}
+
+	CHECK(device.live.empty());
+	CHECK(!device.misuse);
+}
+
+TEST(sizes_are_rounded_up_to_buckets)
+{
+	fake_device device;
+	cpu::readback_ring ring{ device };
+
+	// a loupe whose clipped size changes every frame
+	for (int i = 0; i < 40; i++)
+		read(ring, ring.acquire(200 + i, 150 + i % 7, 87));
+
+	CHECK(device.created == 1);
+
+	const auto& t = device.live.begin()->second;
+	CHECK(t.width == 256 && t.height == 256);
+
+	read(ring, ring.acquire(257, 10, 87));
+	CHECK(device.created == 2);
+	CHECK(device.live.count(ring.acquire(512, 256, 87)));
+	CHECK(device.created == 2);
+
+	// the format is part of the size
+	ring.acquire(100, 100, 2);
+	CHECK(device.created == 3);
+	CHECK(!device.misuse);
+}
+
+TEST(a_bucket_of_one_keeps_exact_sizes)
+{
+	fake_device device;
+	cpu::readback_ring ring{ device, 3, 8, 1 };
+
+	read(ring, ring.acquire(201, 150, 87));
+	read(ring, ring.acquire(200, 150, 87));
+
+	CHECK(device.created == 2);
+}
+
+TEST(the_ring_grows_while_textures_are_in_flight_and_shrinks_back)
+{
+	fake_device device;
+	cpu::readback_ring ring{ device, 2 };
+
+	void* in_flight[5];
+	for (auto& t : in_flight)
+		t = ring.acquire(64, 64, 87);
+
+	CHECK(device.created == 5);
+
+	for (auto* t : in_flight)
+		read(ring, t);
+
+	CHECK(device.live.size() == 2);
+
+	// the least recently used idle one comes back first
+	auto* a = ring.acquire(64, 64, 87);
+	auto* b = ring.acquire(64, 64, 87);
+
+	CHECK(a != b);
+	CHECK(device.created == 5);
+	CHECK(!device.misuse);
+}
+
+TEST(try_map_reports_copies_in_flight)
+{
+	fake_device device;
+	device.busy_polls = 2;
+
+	cpu::readback_ring ring{ device };
+	auto* t = ring.acquire(64, 64, 87);
+
+	cpu::mapped_view mapped;
+	CHECK(ring.try_map(t, mapped) == status::busy);
+	CHECK(ring.try_map(t, mapped) == status::busy);
+	CHECK(ring.try_map(t, mapped) == status::ok);
+	CHECK(mapped.data == t);
+	ring.unmap(t);
+
+	// map blocks instead
+	t = ring.acquire(64, 64, 87);
+	CHECK(ring.map(t, mapped) == status::ok);
+	ring.unmap(t);
+
+	CHECK(ring.busy_maps() == 3);
+	CHECK(ring.try_map(&device, mapped) == status::failed);
+	CHECK(!device.misuse);
+}
+
+TEST(the_least_recently_used_idle_size_is_evicted)
+{
+	fake_device device;
+	cpu::readback_ring ring{ device, 3, 2 };
+
+	read(ring, ring.acquire(256, 256, 87));
+	auto* busy = ring.acquire(512, 512, 87);
+	read(ring, ring.acquire(768, 768, 87));
+
+	// 256 is the oldest idle size, 512 is still in flight
+	CHECK(device.live.size() == 2);
+	CHECK(device.live.count(busy));
+
+	for (const auto& [handle, t] : device.live)
+		CHECK(t.width != 256);
+
+	read(ring, busy);
+
+	ring.clear();
+	CHECK(device.live.empty());
+	CHECK(!device.misuse);
+}
+
+TEST_MAIN()
@@ -0,0 +1,345 @@
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/retained_frame.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tonemapper.hpp"
+
+namespace
+{
+	// stands in for a duplicated output: the pixels it shows and what it
+	// reports as changed between frames
+	struct fake_output
+	{
+		int width;
+		int height;
+		cpu::pixel_format format;
+		std::vector<uint8_t> pixels;
+
+		int bpp() const { return cpu::bytes_per_pixel(format); }
+
+		cpu::image_view view() const
+		{
+			return { pixels.data(), width, height, static_cast<ptrdiff_t>(width) * bpp(), format };
+		}
+
+		void scribble(const cpu::rect& r, std::mt19937& rng)
+		{
+			for (int y = r.top; y < r.bottom; y++)
+			{
+				for (int x = r.left * bpp(); x < r.right * bpp(); x++)
+				{
+					auto& b = pixels[static_cast<size_t>(y) * width * bpp() + x];
+					b = static_cast<uint8_t>(rng());
+
+					// keep fp16 values finite and below ~2
+					if (format == cpu::pixel_format::r16g16b16a16_float && x % 2)
+						b &= 0x3b;
+				}
+			}
+		}
+
+		// what a move rect reports: the content of src_x, src_y shows up at dest
+		void move(const cpu::rect& dest, int src_x, int src_y)
+		{
+			const auto before = pixels;
+			const size_t row = static_cast<size_t>(dest.width()) * bpp();
+
+			for (int y = 0; y < dest.height(); y++)
+			{
+				std::memcpy(
+					&pixels[(static_cast<size_t>(dest.top + y) * width + dest.left) * bpp()],
+					&before[(static_cast<size_t>(src_y + y) * width + src_x) * bpp()],
+					row
+				);
+			}
+		}
+
+		cpu::rect random_rect(std::mt19937& rng, int max_size) const
+		{
+			const int x = static_cast<int>(rng() % width);
+			const int y = static_cast<int>(rng() % height);
+			return { x, y, std::min(width, x + 1 + static_cast<int>(rng() % max_size)), std::min(height, y + 1 + static_cast<int>(rng() % max_size)) };
+		}
+	};
+
+	fake_output make_output(std::mt19937& rng)
+	{
+		fake_output out{ 50 + static_cast<int>(rng() % 300), 50 + static_cast<int>(rng() % 300), rng() % 2 ? cpu::pixel_format::r16g16b16a16_float : cpu::pixel_format::r8g8b8a8_unorm, {} };
+		out.pixels.resize(static_cast<size_t>(out.width) * out.height * out.bpp());
+		out.scribble({ 0, 0, out.width, out.height }, rng);
+		return out;
+	}
+
+	// what the readback would hand over: the pending parts of region, garbage
+	// everywhere else so reading anything else shows up
+	std::vector<uint8_t> read_back(const fake_output& out, const cpu::rect& region, const std::vector<cpu::rect>& pending)
+	{
+		const int bpp = out.bpp();
+		std::vector<uint8_t> staging(static_cast<size_t>(region.width()) * region.height() * bpp, 0xcd);
+
+		for (const auto& r : pending)
+		{
+			for (int y = r.top; y < r.bottom; y++)
+			{
+				std::memcpy(
+					&staging[(static_cast<size_t>(y - region.top) * region.width() + (r.left - region.left)) * bpp],
+					&out.pixels[(static_cast<size_t>(y) * out.width + r.left) * bpp],
+					static_cast<size_t>(r.width()) * bpp
+				);
+			}
+		}
+
+		return staging;
+	}
+
+	// one capture of out at p through frame, compared with tonemapping all of out
+	bool capture_matches(cpu::retained_frame& frame, const fake_output& out, const cpu::placement& p, float white, cpu::thread_pool& pool, size_t* pending_area = nullptr)
+	{
+		constexpr int dest_size = 300;
+
+		frame.prepare(out.width, out.height, out.format, white);
+
+		cpu::placement sub;
+		const auto region = cpu::crop(p, { 0, 0, dest_size, dest_size }, sub);
+		if (region.empty())
+			return true;
+
+		std::vector<cpu::rect> pending;
+		frame.pending(region, pending);
+
+		if (pending_area)
+		{
+			*pending_area = 0;
+			for (const auto& r : pending)
+				*pending_area += static_cast<size_t>(r.width()) * r.height();
+		}
+
+		const auto staging = read_back(out, region, pending);
+		frame.update({ staging.data(), region.width(), region.height(), static_cast<ptrdiff_t>(region.width()) * out.bpp(), out.format }, region, pool);
+
+		std::vector<uint8_t> retained(dest_size * dest_size * 4), expected(retained.size());
+		frame.compose(region, sub, { retained.data(), dest_size, dest_size, dest_size * 4 }, pool);
+
+		const cpu::render_job job{ out.view(), p.x, p.y, p.rotation, white };
+		cpu::tonemap({ &job, 1 }, { expected.data(), dest_size, dest_size, dest_size * 4 }, pool);
+
+		return retained == expected;
+	}
+
+	cpu::placement random_placement(const fake_output& out, std::mt19937& rng)
+	{
+		return { out.width, out.height, static_cast<int>(rng() % 200) - 100, static_cast<int>(rng() % 200) - 100, static_cast<cpu::rotation_t>(rng() % 4) };
+	}
+}
+
+TEST(dirty_rects_keep_the_retained_output_current)
+{
+	std::mt19937 rng{ 1 };
+	cpu::thread_pool pool{ 3 };
+
+	for (int i = 0; i < 150; i++)
+	{
+		auto out = make_output(rng);
+		const auto rotation = static_cast<cpu::rotation_t>(rng() % 4);
+		cpu::retained_frame frame;
+
+		for (int step = 0; step < 5; step++)
+		{
+			for (int n = static_cast<int>(rng() % 4); step && n > 0; n--)
+			{
+				const auto r = out.random_rect(rng, 80);
+				out.scribble(r, rng);
+				frame.damage(r);
+			}
+
+			// the request moves around, the white level changes once
+			auto p = random_placement(out, rng);
+			p.rotation = rotation;
+
+			CHECK(capture_matches(frame, out, p, step == 3 ? 300.0f : 200.0f, pool));
+		}
+	}
+}
+
+TEST(only_damaged_tiles_are_read_back)
+{
+	std::mt19937 rng{ 2 };
+	cpu::thread_pool pool{ 2 };
+
+	fake_output out{ 256, 192, cpu::pixel_format::r16g16b16a16_float, {} };
+	out.pixels.resize(static_cast<size_t>(out.width) * out.height * out.bpp());
+	out.scribble({ 0, 0, out.width, out.height }, rng);
+
+	cpu::retained_frame frame;
+	const cpu::placement p{ out.width, out.height, 0, 0, cpu::rotation_t::identity };
+
+	size_t area = 0;
+	CHECK(capture_matches(frame, out, p, 200.0f, pool, &area));
+	CHECK(area == 256 * 192);
+
+	// nothing changed
+	CHECK(capture_matches(frame, out, p, 200.0f, pool, &area));
+	CHECK(area == 0);
+
+	// a damaged pixel costs its tile
+	out.scribble({ 100, 100, 101, 101 }, rng);
+	frame.damage({ 100, 100, 101, 101 });
+
+	CHECK(capture_matches(frame, out, p, 200.0f, pool, &area));
+	CHECK(area == cpu::tile_size * cpu::tile_size);
+}
+
+TEST(moves_and_dirty_rects_keep_the_retained_output_current)
+{
+	std::mt19937 rng{ 4 };
+	cpu::thread_pool pool{ 3 };
+
+	for (int i = 0; i < 150; i++)
+	{
+		auto out = make_output(rng);
+		const auto rotation = static_cast<cpu::rotation_t>(rng() % 4);
+		cpu::retained_frame frame;
+
+		for (int step = 0; step < 5; step++)
+		{
+			// moves first, in reported order, then the dirty rects
+			for (int n = static_cast<int>(rng() % 3); step && n > 0; n--)
+			{
+				const int w = 1 + static_cast<int>(rng() % out.width);
+				const int h = 1 + static_cast<int>(rng() % out.height);
+				const int sx = static_cast<int>(rng() % (out.width - w + 1));
+				const int sy = static_cast<int>(rng() % (out.height - h + 1));
+				const int dx = static_cast<int>(rng() % (out.width - w + 1));
+				const int dy = static_cast<int>(rng() % (out.height - h + 1));
+
+				out.move({ dx, dy, dx + w, dy + h }, sx, sy);
+				frame.move({ dx, dy, dx + w, dy + h }, sx, sy);
+			}
+
+			for (int n = static_cast<int>(rng() % 4); step && n > 0; n--)
+			{
+				const auto r = out.random_rect(rng, 80);
+				out.scribble(r, rng);
+				frame.damage(r);
+			}
+
+			auto p = random_placement(out, rng);
+			p.rotation = rotation;
+
+			CHECK(capture_matches(frame, out, p, step == 3 ? 300.0f : 200.0f, pool));
+		}
+	}
+}
+
+TEST(a_scroll_needs_no_readback)
+{
+	std::mt19937 rng{ 5 };
+	cpu::thread_pool pool{ 2 };
+
+	fake_output out{ 256, 192, cpu::pixel_format::r16g16b16a16_float, {} };
+	out.pixels.resize(static_cast<size_t>(out.width) * out.height * out.bpp());
+	out.scribble({ 0, 0, out.width, out.height }, rng);
+
+	cpu::retained_frame frame;
+	const cpu::placement p{ out.width, out.height, 0, 0, cpu::rotation_t::identity };
+
+	CHECK(capture_matches(frame, out, p, 200.0f, pool));
+
+	// scrolling up by 7 rows and down by 30, what scrolled in is reported dirty
+	out.move({ 0, 0, 256, 185 }, 0, 7);
+	frame.move({ 0, 0, 256, 185 }, 0, 7);
+	out.move({ 0, 30, 256, 192 }, 0, 0);
+	frame.move({ 0, 30, 256, 192 }, 0, 0);
+
+	size_t area = 0;
+	CHECK(capture_matches(frame, out, p, 200.0f, pool, &area));
+	CHECK(area == 0);
+}
+
+TEST(a_move_from_stale_tiles_stays_stale)
+{
+	cpu::retained_frame frame;
+	frame.prepare(256, 256, cpu::pixel_format::r8g8b8a8_unorm, 200.0f);
+	frame.finish({ 0, 0, 256, 256 });
+	frame.damage({ 0, 0, 1, 1 });
+
+	frame.move({ 128, 128, 192, 192 }, 0, 0);
+
+	std::vector<cpu::rect> pending;
+	frame.pending({ 128, 128, 256, 256 }, pending);
+
+	CHECK(pending.size() == 1);
+	CHECK(pending[0].left == 128 && pending[0].top == 128 && pending[0].right == 192 && pending[0].bottom == 192);
+}
+
+TEST(a_move_reaching_outside_marks_its_destination)
+{
+	cpu::retained_frame frame;
+	frame.prepare(256, 256, cpu::pixel_format::r8g8b8a8_unorm, 200.0f);
+	frame.finish({ 0, 0, 256, 256 });
+
+	frame.move({ 0, 0, 64, 64 }, 220, 0);
+
+	std::vector<cpu::rect> pending;
+	frame.pending({ 0, 0, 256, 256 }, pending);
+
+	CHECK(pending.size() == 1);
+	CHECK(pending[0].left == 0 && pending[0].top == 0 && pending[0].right == 64 && pending[0].bottom == 64);
+}
+
+TEST(tiles_cut_by_the_request_stay_stale)
+{
+	cpu::retained_frame frame;
+	frame.prepare(640, 480, cpu::pixel_format::r8g8b8a8_unorm, 200.0f);
+	frame.finish({ 0, 0, 300, 300 });
+
+	std::vector<cpu::rect> pending;
+	frame.pending({ 0, 0, 640, 480 }, pending);
+
+	const auto covered = [&](int x, int y)
+	{
+		for (const auto& r : pending)
+		{
+			if (x >= r.left && x < r.right && y >= r.top && y < r.bottom)
+				return true;
+		}
+
+		return false;
+	};
+
+	CHECK(!covered(0, 0));
+	CHECK(!covered(255, 255));
+	CHECK(covered(256, 0));
+	CHECK(covered(299, 299));
+	CHECK(covered(0, 256));
+}
+
+TEST(a_format_or_white_level_change_redoes_everything)
+{
+	std::mt19937 rng{ 3 };
+
+	cpu::retained_frame frame;
+	frame.prepare(200, 100, cpu::pixel_format::r8g8b8a8_unorm, 200.0f);
+	frame.finish({ 0, 0, 200, 100 });
+
+	std::vector<cpu::rect> pending;
+	frame.pending({ 0, 0, 200, 100 }, pending);
+	CHECK(pending.empty());
+
+	frame.prepare(200, 100, cpu::pixel_format::r8g8b8a8_unorm, 240.0f);
+	frame.pending({ 0, 0, 200, 100 }, pending);
+	CHECK(pending.size() == 1);
+
+	frame.finish({ 0, 0, 200, 100 });
+	pending.clear();
+
+	frame.prepare(200, 100, cpu::pixel_format::r16g16b16a16_float, 240.0f);
+	frame.pending({ 0, 0, 200, 100 }, pending);
+	CHECK(pending.size() == 1);
+}
+
+TEST_MAIN()
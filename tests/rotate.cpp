@@ -0,0 +1,91 @@
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/rotate.hpp"
+
+namespace
+{
+	uint32_t pixel(const std::vector<uint8_t>& image, ptrdiff_t pitch, int x, int y)
+	{
+		uint32_t px;
+		std::memcpy(&px, image.data() + pitch * y + x * 4, sizeof(px));
+		return px;
+	}
+}
+
+TEST(rotate_copy_matches_a_pixel_by_pixel_rotation)
+{
+	std::mt19937 rng{ 5 };
+
+	const cpu::rotation_t rotations[] =
+	{
+		cpu::rotation_t::identity, cpu::rotation_t::rotate90, cpu::rotation_t::rotate180, cpu::rotation_t::rotate270,
+	};
+
+	// sizes on and off the 4x4 and 16x16 blocks, padded pitches on both ends
+	const int sizes[] = { 1, 3, 4, 15, 16, 17, 33, 64, 100 };
+
+	for (const auto rotation : rotations)
+	{
+		for (const int width : sizes)
+		{
+			for (const int height : sizes)
+			{
+				const ptrdiff_t src_pitch = (width + 3) * 4;
+				std::vector<uint8_t> src(src_pitch * height);
+				for (auto& c : src)
+					c = static_cast<uint8_t>(rng());
+
+				const bool transposed = rotation == cpu::rotation_t::rotate90 || rotation == cpu::rotation_t::rotate270;
+				const int dest_width = transposed ? height : width;
+				const int dest_height = transposed ? width : height;
+				const ptrdiff_t dest_pitch = (dest_width + 5) * 4;
+
+				std::vector<uint8_t> dest(dest_pitch * dest_height, 0xee);
+				cpu::rotate_copy(src.data(), src_pitch, width, height, dest.data(), dest_pitch, rotation);
+
+				int wrong = 0;
+
+				for (int y = 0; y < height; y++)
+				{
+					for (int x = 0; x < width; x++)
+					{
+						int dx = x, dy = y;
+
+						if (rotation == cpu::rotation_t::rotate90)
+						{
+							dx = height - 1 - y;
+							dy = x;
+						}
+						else if (rotation == cpu::rotation_t::rotate180)
+						{
+							dx = width - 1 - x;
+							dy = height - 1 - y;
+						}
+						else if (rotation == cpu::rotation_t::rotate270)
+						{
+							dx = y;
+							dy = width - 1 - x;
+						}
+
+						wrong += pixel(dest, dest_pitch, dx, dy) != pixel(src, src_pitch, x, y);
+					}
+				}
+
+				CHECK(wrong == 0);
+
+				// the padding past each row is left alone
+				int touched = 0;
+				for (int y = 0; y < dest_height; y++)
+					touched += pixel(dest, dest_pitch, dest_width, y) != 0xeeeeeeeeu;
+
+				CHECK(touched == 0);
+			}
+		}
+	}
+}
+
+TEST_MAIN()
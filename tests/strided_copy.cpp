@@ -0,0 +1,103 @@
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/kernels.hpp"
+#include "cpu/strided_copy.hpp"
+#include "cpu/thread_pool.hpp"
+
+namespace
+{
+	// copies rows x row_bytes between random pitches and a random destination
+	// alignment, and compares against a row by row memcpy. the bytes between
+	// rows have to be left alone
+	bool copy_matches(std::mt19937& rng, size_t row_bytes, int rows, bool packed, cpu::thread_pool& pool)
+	{
+		const size_t src_pitch = packed ? row_bytes : row_bytes + rng() % 100;
+		const size_t dest_pitch = packed ? row_bytes : row_bytes + rng() % 100;
+		const size_t offset = rng() % 16;
+
+		// a pattern rather than rng per byte, the streaming case is hundreds of mb
+		const uint32_t seed = rng();
+		std::vector<uint8_t> src(src_pitch * rows);
+		for (size_t i = 0; i < src.size(); i++)
+			src[i] = static_cast<uint8_t>((i * 131 + seed) >> (i % 3));
+
+		std::vector<uint8_t> dest(dest_pitch * rows + 16, 0xcd);
+		auto expected = dest;
+
+		for (int y = 0; y < rows; y++)
+			std::memcpy(&expected[offset + dest_pitch * y], &src[src_pitch * y], row_bytes);
+
+		cpu::strided_copy(src.data(), src_pitch, dest.data() + offset, dest_pitch, row_bytes, rows, pool);
+		return dest == expected;
+	}
+}
+
+TEST(matches_a_row_by_row_copy)
+{
+	std::mt19937 rng{ 3 };
+	cpu::thread_pool pool{ 3 };
+
+	for (int i = 0; i < 300; i++)
+	{
+		const size_t row_bytes = 1 + rng() % 20000;
+		const int rows = 1 + static_cast<int>(rng() % 300);
+
+		CHECK(copy_matches(rng, row_bytes, rows, rng() % 3 == 0, pool));
+	}
+}
+
+TEST(copies_larger_than_the_cache_stream)
+{
+	std::mt19937 rng{ 4 };
+	cpu::thread_pool pool{ 3 };
+
+	// just past the last level cache, so the streaming stores run
+	const size_t row_bytes = 16384 + 4;
+	const int rows = static_cast<int>(cpu::last_level_cache_size() / row_bytes) + 2;
+
+	CHECK(copy_matches(rng, row_bytes, rows, false, pool));
+	CHECK(copy_matches(rng, row_bytes, rows, true, pool));
+}
+
+TEST(a_bottom_up_destination_is_filled_top_down)
+{
+	cpu::thread_pool pool{ 2 };
+
+	constexpr int width = 33;
+	constexpr int rows = 20;
+
+	std::vector<uint32_t> src(width * rows);
+	for (size_t i = 0; i < src.size(); i++)
+		src[i] = static_cast<uint32_t>(i);
+
+	std::vector<uint32_t> dest(width * rows);
+	auto* last_row = reinterpret_cast<uint8_t*>(dest.data() + width * (rows - 1));
+
+	cpu::strided_copy(reinterpret_cast<const uint8_t*>(src.data()), width * 4, last_row, -width * 4, width * 4, rows, pool);
+
+	bool flipped = true;
+	for (int y = 0; y < rows; y++)
+		flipped &= std::memcmp(&dest[width * (rows - 1 - y)], &src[width * y], width * 4) == 0;
+
+	CHECK(flipped);
+}
+
+TEST(nothing_is_copied_onto_itself_or_for_empty_copies)
+{
+	cpu::thread_pool pool{ 2 };
+
+	std::vector<uint8_t> px(64, 5);
+	cpu::strided_copy(px.data(), 16, px.data(), 16, 16, 4, pool);
+	CHECK(px == std::vector<uint8_t>(64, 5));
+
+	std::vector<uint8_t> dest(64, 0);
+	cpu::strided_copy(px.data(), 16, dest.data(), 16, 0, 4, pool);
+	cpu::strided_copy(px.data(), 16, dest.data(), 16, 16, 0, pool);
+	CHECK(dest == std::vector<uint8_t>(64, 0));
+}
+
+TEST_MAIN()
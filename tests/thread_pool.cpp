@@ -0,0 +1,164 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tonemapper.hpp"
+
+TEST(every_index_runs_exactly_once)
+{
+	for (const unsigned int threads : { 1u, 2u, 3u, 8u, 17u })
+	{
+		cpu::thread_pool pool{ threads };
+
+		for (uint32_t count = 0; count < 1000; count += 37)
+		{
+			std::vector<std::atomic<int>> hits(count);
+			pool.parallel_for(count, [&](uint32_t i) { hits[i]++; });
+
+			int wrong = 0;
+			for (const auto& h : hits)
+				wrong += h.load() != 1;
+
+			CHECK(wrong == 0);
+		}
+	}
+}
+
+TEST(nested_calls_run_inline)
+{
+	cpu::thread_pool pool{ 4 };
+	std::atomic<int> total{ 0 };
+
+	pool.parallel_for(8, [&](uint32_t)
+	{
+		pool.parallel_for(8, [&](uint32_t) { total++; });
+	});
+
+	CHECK(total == 64);
+}
+
+namespace
+{
+	// parallel_for where the first index run on a thread matching on_caller
+	// throws. every index takes a moment so the workers get to take part
+	bool throw_once(cpu::thread_pool& pool, bool on_caller, std::atomic<int>& inside)
+	{
+		const auto caller = std::this_thread::get_id();
+		std::atomic<bool> thrown{ false };
+
+		try
+		{
+			pool.parallel_for(64, [&](uint32_t)
+			{
+				inside++;
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+				const bool mine = (std::this_thread::get_id() == caller) == on_caller;
+
+				if (mine && !thrown.exchange(true))
+				{
+					inside--;
+					throw std::runtime_error{ "bad index" };
+				}
+
+				inside--;
+			});
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+
+		// every index ran on the other kind of thread
+		return !thrown;
+	}
+}
+
+TEST(a_worker_exception_reaches_the_caller)
+{
+	cpu::thread_pool pool{ 4 };
+
+	for (int i = 0; i < 20; i++)
+	{
+		std::atomic<int> inside{ 0 };
+
+		CHECK(throw_once(pool, false, inside));
+		CHECK(inside == 0);
+	}
+
+	// and the pool still works afterwards
+	std::atomic<int> hits{ 0 };
+	pool.parallel_for(100, [&](uint32_t) { hits++; });
+	CHECK(hits == 100);
+}
+
+TEST(a_caller_exception_waits_for_the_workers)
+{
+	cpu::thread_pool pool{ 4 };
+
+	for (int i = 0; i < 20; i++)
+	{
+		std::atomic<int> inside{ 0 };
+
+		CHECK(throw_once(pool, true, inside));
+
+		// nobody is still running the callable that went out of scope
+		CHECK(inside == 0);
+	}
+}
+
+TEST(only_the_first_exception_is_rethrown)
+{
+	cpu::thread_pool pool{ 3 };
+	int caught = 0;
+
+	try
+	{
+		pool.parallel_for(300, [&](uint32_t) { throw std::logic_error{ "every index" }; });
+	}
+	catch (const std::logic_error&)
+	{
+		caught++;
+	}
+
+	CHECK(caught == 1);
+}
+
+TEST(all_jobs_in_one_call_match_one_call_each)
+{
+	std::mt19937 rng{ 9 };
+
+	std::vector<uint8_t> pixels(300 * 170 * 4);
+	for (auto& c : pixels)
+		c = static_cast<uint8_t>(rng());
+
+	const cpu::image_view src{ pixels.data(), 300, 170, 300 * 4, cpu::pixel_format::r8g8b8a8_unorm };
+
+	const cpu::render_job jobs[] =
+	{
+		{ src, 0, 0, cpu::rotation_t::identity, 200.0f },
+		{ src, 400, 0, cpu::rotation_t::rotate90, 200.0f },
+		{ src, 0, 400, cpu::rotation_t::rotate180, 200.0f },
+		{ src, 400, 400, cpu::rotation_t::rotate270, 200.0f },
+	};
+
+	std::vector<uint8_t> all(1000 * 1000 * 4), each(1000 * 1000 * 4);
+	const cpu::bitmap_view all_view{ all.data(), 1000, 1000, 4000 };
+	const cpu::bitmap_view each_view{ each.data(), 1000, 1000, 4000 };
+
+	cpu::thread_pool pool{ 5 };
+	cpu::tonemap(jobs, all_view, pool);
+
+	for (const auto& job : jobs)
+		cpu::tonemap({ &job, 1 }, each_view, pool);
+
+	CHECK(all == each);
+}
+
+TEST_MAIN()
@@ -0,0 +1,162 @@
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/tile_bitmap.hpp"
+
+namespace
+{
+	constexpr int t = cpu::tile_size;
+
+	int dirty_count(const cpu::tile_bitmap& bits)
+	{
+		int count = 0;
+
+		for (int ty = 0; ty * t < bits.height(); ty++)
+		{
+			for (int tx = 0; tx * t < bits.width(); tx++)
+				count += bits.dirty(tx, ty);
+		}
+
+		return count;
+	}
+}
+
+TEST(resize_starts_out_all_dirty)
+{
+	cpu::tile_bitmap bits;
+	bits.resize(130, 65);
+
+	CHECK(dirty_count(bits) == 3 * 2);
+
+	bits.clear({ 0, 0, 130, 65 });
+	CHECK(!bits.any());
+	CHECK(dirty_count(bits) == 0);
+}
+
+TEST(mark_touches_every_tile_under_the_rect)
+{
+	cpu::tile_bitmap bits;
+	bits.resize(4 * t, 4 * t);
+	bits.clear({ 0, 0, 4 * t, 4 * t });
+
+	bits.mark({ t - 1, t - 1, t + 1, t + 1 });
+
+	CHECK(dirty_count(bits) == 4);
+	CHECK(bits.dirty(0, 0) && bits.dirty(1, 0) && bits.dirty(0, 1) && bits.dirty(1, 1));
+
+	// clipped to the image
+	bits.mark({ -100, 3 * t + 5, -1, 5 * t });
+	CHECK(dirty_count(bits) == 4);
+
+	bits.mark({ 4 * t - 1, 4 * t - 1, 10 * t, 10 * t });
+	CHECK(bits.dirty(3, 3));
+}
+
+TEST(clear_keeps_tiles_cut_by_the_rect)
+{
+	cpu::tile_bitmap bits;
+	bits.resize(4 * t, 4 * t);
+
+	bits.clear({ t / 2, 0, 3 * t, t });
+
+	// tile 0 is only half inside
+	CHECK(bits.dirty(0, 0));
+	CHECK(!bits.dirty(1, 0));
+	CHECK(!bits.dirty(2, 0));
+	CHECK(bits.dirty(3, 0));
+}
+
+TEST(clear_reaching_the_image_edge_clears_partial_edge_tiles)
+{
+	cpu::tile_bitmap bits;
+	bits.resize(t + 10, t + 10);
+
+	bits.clear({ t, t, t + 10, t + 10 });
+	CHECK(!bits.dirty(1, 1));
+	CHECK(bits.dirty(0, 0));
+}
+
+TEST(any_looks_only_under_the_rect)
+{
+	cpu::tile_bitmap bits;
+	bits.resize(4 * t, 4 * t);
+	bits.clear({ 0, 0, 4 * t, 4 * t });
+	bits.mark({ 3 * t, 3 * t, 3 * t + 1, 3 * t + 1 });
+
+	CHECK(bits.any());
+	CHECK(!bits.any({ 0, 0, 3 * t, 4 * t }));
+	CHECK(bits.any({ 3 * t, 3 * t, 4 * t, 4 * t }));
+}
+
+TEST(collect_covers_exactly_the_dirty_tiles)
+{
+	std::mt19937 rng{ 17 };
+
+	for (int i = 0; i < 300; i++)
+	{
+		const int width = 1 + static_cast<int>(rng() % (9 * t));
+		const int height = 1 + static_cast<int>(rng() % (9 * t));
+
+		cpu::tile_bitmap bits;
+		bits.resize(width, height);
+		bits.clear({ 0, 0, width, height });
+
+		for (int m = static_cast<int>(rng() % 6); m > 0; m--)
+		{
+			const int x = static_cast<int>(rng() % width);
+			const int y = static_cast<int>(rng() % height);
+			bits.mark({ x, y, x + 1 + static_cast<int>(rng() % 150), y + 1 + static_cast<int>(rng() % 150) });
+		}
+
+		const int bx = static_cast<int>(rng() % width);
+		const int by = static_cast<int>(rng() % height);
+		const cpu::rect bounds{ bx - 20, by - 20, bx + static_cast<int>(rng() % 400), by + static_cast<int>(rng() % 400) };
+
+		std::vector<cpu::rect> rects;
+		bits.collect(bounds, rects);
+
+		// every pixel of bounds is covered once when its tile is dirty, never otherwise
+		const auto area = cpu::intersect(bounds, { 0, 0, width, height });
+		int wrong = 0;
+
+		for (int y = area.top; y < area.bottom; y++)
+		{
+			for (int x = area.left; x < area.right; x++)
+			{
+				int covered = 0;
+
+				for (const auto& r : rects)
+					covered += x >= r.left && x < r.right && y >= r.top && y < r.bottom;
+
+				wrong += covered != (bits.dirty(x / t, y / t) ? 1 : 0);
+			}
+		}
+
+		CHECK(wrong == 0);
+
+		for (const auto& r : rects)
+		{
+			CHECK(!r.empty());
+			CHECK(r.left >= area.left && r.top >= area.top && r.right <= area.right && r.bottom <= area.bottom);
+		}
+	}
+}
+
+TEST(collect_joins_runs_into_few_rects)
+{
+	cpu::tile_bitmap bits;
+	bits.resize(8 * t, 8 * t);
+	bits.clear({ 0, 0, 8 * t, 8 * t });
+
+	// a 3x4 block of tiles is one rect
+	bits.mark({ 2 * t, t, 5 * t, 5 * t });
+
+	std::vector<cpu::rect> rects;
+	bits.collect({ 0, 0, 8 * t, 8 * t }, rects);
+
+	CHECK(rects.size() == 1);
+	CHECK(rects[0].left == 2 * t && rects[0].top == t && rects[0].right == 5 * t && rects[0].bottom == 5 * t);
+}
+
+TEST_MAIN()
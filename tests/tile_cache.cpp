@@ -0,0 +1,173 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/retained_frame.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tile_cache.hpp"
+
+namespace
+{
+	constexpr int side = 64;
+	constexpr size_t tile_bytes = side * side * 4;
+
+	cpu::tile_cache::key key_of(uint64_t hash)
+	{
+		return { hash, side, side, cpu::pixel_format::r16g16b16a16_float, 200.0f };
+	}
+
+	std::vector<uint8_t> tile(uint8_t fill)
+	{
+		return std::vector<uint8_t>(tile_bytes, fill);
+	}
+}
+
+TEST(a_lookup_copies_out_what_was_inserted)
+{
+	cpu::tile_cache cache{ 4 * tile_bytes };
+
+	std::vector<uint8_t> src(tile_bytes);
+	std::mt19937 rng{ 1 };
+	for (auto& b : src)
+		b = static_cast<uint8_t>(rng());
+
+	cache.insert(key_of(1), src.data(), side * 4);
+
+	// into a wider destination, the bytes past each row stay untouched
+	std::vector<uint8_t> dest(tile_bytes * 2, 0xcd);
+	CHECK(cache.lookup(key_of(1), dest.data(), side * 8));
+
+	bool same = true;
+	for (int y = 0; y < side; y++)
+	{
+		for (int x = 0; x < side * 4; x++)
+			same &= dest[y * side * 8 + x] == src[y * side * 4 + x];
+		for (int x = side * 4; x < side * 8; x++)
+			same &= dest[y * side * 8 + x] == 0xcd;
+	}
+
+	CHECK(same);
+	CHECK(cache.hits() == 1 && cache.misses() == 0);
+	CHECK(cache.size() == tile_bytes);
+}
+
+TEST(every_part_of_the_key_counts)
+{
+	cpu::tile_cache cache{ 4 * tile_bytes };
+	const auto px = tile(1);
+	cache.insert(key_of(7), px.data(), side * 4);
+
+	auto other_level = key_of(7);
+	other_level.white_level = 300.0f;
+	auto other_format = key_of(7);
+	other_format.format = cpu::pixel_format::r8g8b8a8_unorm;
+
+	std::vector<uint8_t> dest(tile_bytes);
+	CHECK(!cache.lookup(key_of(8), dest.data(), side * 4));
+	CHECK(!cache.lookup(other_level, dest.data(), side * 4));
+	CHECK(!cache.lookup(other_format, dest.data(), side * 4));
+	CHECK(cache.misses() == 3 && cache.hits() == 0);
+}
+
+TEST(the_least_recently_used_tiles_go_first)
+{
+	cpu::tile_cache cache{ 3 * tile_bytes };
+	std::vector<uint8_t> dest(tile_bytes);
+
+	for (uint64_t i = 1; i <= 3; i++)
+		cache.insert(key_of(i), tile(static_cast<uint8_t>(i)).data(), side * 4);
+
+	// touching 1 leaves 2 the oldest
+	CHECK(cache.lookup(key_of(1), dest.data(), side * 4));
+	cache.insert(key_of(4), tile(4).data(), side * 4);
+
+	CHECK(cache.size() == 3 * tile_bytes);
+	CHECK(!cache.lookup(key_of(2), dest.data(), side * 4));
+	CHECK(cache.lookup(key_of(1), dest.data(), side * 4) && dest[0] == 1);
+	CHECK(cache.lookup(key_of(3), dest.data(), side * 4) && dest[0] == 3);
+	CHECK(cache.lookup(key_of(4), dest.data(), side * 4) && dest[0] == 4);
+}
+
+TEST(shrinking_evicts_and_oversized_tiles_are_not_kept)
+{
+	cpu::tile_cache cache{ 4 * tile_bytes };
+
+	for (uint64_t i = 1; i <= 4; i++)
+		cache.insert(key_of(i), tile(static_cast<uint8_t>(i)).data(), side * 4);
+
+	cache.set_capacity(tile_bytes + 1);
+	CHECK(cache.size() == tile_bytes);
+
+	std::vector<uint8_t> dest(tile_bytes);
+	CHECK(cache.lookup(key_of(4), dest.data(), side * 4));
+
+	cache.set_capacity(tile_bytes - 1);
+	CHECK(cache.size() == 0);
+
+	cache.insert(key_of(5), tile(5).data(), side * 4);
+	CHECK(cache.size() == 0);
+	CHECK(!cache.lookup(key_of(5), dest.data(), side * 4));
+
+	cache.set_capacity(tile_bytes);
+	cache.insert(key_of(5), tile(5).data(), side * 4);
+	cache.insert(key_of(5), tile(5).data(), side * 4);
+	CHECK(cache.size() == tile_bytes);
+
+	cache.clear();
+	CHECK(cache.size() == 0);
+	CHECK(!cache.lookup(key_of(5), dest.data(), side * 4));
+}
+
+TEST(cached_tiles_compose_the_same_output)
+{
+	// a frame of four distinct tiles repeated, so the cache hits inside one update
+	constexpr int width = 512;
+	constexpr int height = 256;
+
+	std::mt19937 rng{ 3 };
+	std::vector<uint16_t> hdr(static_cast<size_t>(width) * height * 4);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width * 4; x++)
+		{
+			const int pattern = (x / (side * 4)) % 2 + (y / side) % 2 * 2;
+			hdr[static_cast<size_t>(y) * width * 4 + x] = static_cast<uint16_t>((pattern * 977 + (y % side) * 31 + x % (side * 4)) & 0x3bff);
+		}
+	}
+
+	const cpu::image_view src{ reinterpret_cast<const uint8_t*>(hdr.data()), width, height, width * 8, cpu::pixel_format::r16g16b16a16_float };
+	const cpu::rect region{ 0, 0, width, height };
+	const cpu::placement p{ width, height, 0, 0, cpu::rotation_t::identity };
+
+	// one thread, two workers missing on the same content would both count
+	cpu::thread_pool pool{ 1 };
+	cpu::tile_cache cache{ 64 * tile_bytes };
+
+	cpu::retained_frame cached, plain;
+	cached.prepare(width, height, src.format, 200.0f);
+	plain.prepare(width, height, src.format, 200.0f);
+
+	cached.update(src, region, pool, &cache);
+	plain.update(src, region, pool);
+
+	std::vector<uint8_t> a(static_cast<size_t>(width) * height * 4), b(a.size());
+	cached.compose(region, p, { a.data(), width, height, width * 4 }, pool);
+	plain.compose(region, p, { b.data(), width, height, width * 4 }, pool);
+
+	CHECK(a == b);
+	CHECK(cache.hits() == 32 - 4);
+	CHECK(cache.size() == 4 * tile_bytes);
+
+	// a second monitor with the same content is all hits
+	cpu::retained_frame other;
+	other.prepare(width, height, src.format, 200.0f);
+	other.update(src, region, pool, &cache);
+	other.compose(region, p, { b.data(), width, height, width * 4 }, pool);
+
+	CHECK(a == b);
+	CHECK(cache.hits() == 32 - 4 + 32);
+}
+
+TEST_MAIN()
@@ -0,0 +1,211 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/thread_pool.hpp"
+#include "cpu/tonemapper.hpp"
+
+namespace
+{
+	// a float in [0, max) as an fp16 bit pattern, built the slow way
+	uint16_t float_to_half(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000u;
+		const int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+		const uint32_t mantissa = bits & 0x7fffff;
+
+		if (exponent <= 0)
+			return static_cast<uint16_t>(sign);
+
+		if (exponent >= 0x1f)
+			return static_cast<uint16_t>(sign | 0x7c00u);
+
+		return static_cast<uint16_t>(sign | (exponent << 10) | (mantissa >> 13));
+	}
+
+	struct source
+	{
+		std::vector<uint8_t> pixels;
+		cpu::image_view view;
+	};
+
+	source make_source(int width, int height, cpu::pixel_format format, uint32_t seed)
+	{
+		std::mt19937 rng{ seed };
+		std::uniform_real_distribution<float> nits{ 0.0f, 12.0f };
+
+		const int bpp = cpu::bytes_per_pixel(format);
+
+		source s;
+		s.pixels.resize(static_cast<size_t>(width) * height * bpp);
+
+		for (size_t i = 0; i < s.pixels.size(); i += bpp)
+		{
+			if (format == cpu::pixel_format::r16g16b16a16_float)
+			{
+				const uint16_t px[4] = { float_to_half(nits(rng)), float_to_half(nits(rng)), float_to_half(nits(rng)), float_to_half(1.0f) };
+				std::memcpy(&s.pixels[i], px, sizeof(px));
+			}
+			else
+			{
+				for (int c = 0; c < 4; c++)
+					s.pixels[i + c] = static_cast<uint8_t>(rng());
+			}
+		}
+
+		s.view = { s.pixels.data(), width, height, static_cast<ptrdiff_t>(width) * bpp, format };
+		return s;
+	}
+
+	// the shader's answer for one source pixel, without any of the tiling
+	uint32_t reference_pixel(const cpu::image_view& src, int x, int y, float white_level)
+	{
+		const auto* px = src.data + src.pitch * y + x * cpu::bytes_per_pixel(src.format);
+
+		if (src.format == cpu::pixel_format::r8g8b8a8_unorm)
+			return px[2] | (px[1] << 8) | (px[0] << 16) | 0xff000000u;
+
+		uint16_t h[4];
+		std::memcpy(h, px, sizeof(h));
+
+		const cpu::float3 color{ cpu::half_to_float(h[0]), cpu::half_to_float(h[1]), cpu::half_to_float(h[2]) };
+		return cpu::pack_bgra(cpu::tonemap_hdr(color, white_level));
+	}
+
+	// calc_dest_pos for every rotation, one pixel at a time
+	void reference_pos(const cpu::render_job& job, int sx, int sy, int& dx, int& dy)
+	{
+		const int w = job.src.width;
+		const int h = job.src.height;
+
+		switch (job.rotation)
+		{
+		case cpu::rotation_t::rotate90:
+			dx = job.x + h - 1 - sy;
+			dy = job.y + sx;
+			break;
+		case cpu::rotation_t::rotate180:
+			dx = job.x + w - 1 - sx;
+			dy = job.y + h - 1 - sy;
+			break;
+		case cpu::rotation_t::rotate270:
+			dx = job.x + sy;
+			dy = job.y + w - 1 - sx;
+			break;
+		default:
+			dx = job.x + sx;
+			dy = job.y + sy;
+			break;
+		}
+	}
+
+	// vector kernels may round the last bit differently
+	bool close(uint32_t a, uint32_t b)
+	{
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			if (std::abs(static_cast<int>((a >> shift) & 0xff) - static_cast<int>((b >> shift) & 0xff)) > 1)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+TEST(half_to_float_decodes_normals_subnormals_and_inf)
+{
+	CHECK(cpu::half_to_float(0x0000) == 0.0f);
+	CHECK(cpu::half_to_float(0x3c00) == 1.0f);
+	CHECK(cpu::half_to_float(0xc000) == -2.0f);
+	CHECK(cpu::half_to_float(0x7bff) == 65504.0f);
+	CHECK(cpu::half_to_float(0x0001) == std::ldexp(1.0f, -24));
+	CHECK(std::isinf(cpu::half_to_float(0x7c00)));
+	CHECK(std::isnan(cpu::half_to_float(0x7e00)));
+}
+
+TEST(pack_bgra_saturates_and_orders_channels)
+{
+	CHECK(cpu::pack_bgra({ 1.0f, 0.0f, 0.0f }) == 0xffff0000u);
+	CHECK(cpu::pack_bgra({ 0.0f, 1.0f, 0.0f }) == 0xff00ff00u);
+	CHECK(cpu::pack_bgra({ 0.0f, 0.0f, 1.0f }) == 0xff0000ffu);
+	CHECK(cpu::pack_bgra({ 2.0f, -1.0f, NAN }) == 0xffff0000u);
+}
+
+TEST(black_stays_black)
+{
+	CHECK(cpu::pack_bgra(cpu::tonemap_hdr({ 0.0f, 0.0f, 0.0f }, 200.0f)) == 0xff000000u);
+}
+
+TEST(brighter_input_never_gets_darker)
+{
+	float last = -1.0f;
+
+	for (float v = 0.0f; v < 20.0f; v += 0.05f)
+	{
+		const auto out = cpu::tonemap_hdr({ v, v, v }, 200.0f);
+		CHECK(out.g >= last - 1e-6f);
+		last = out.g;
+	}
+}
+
+TEST(tonemap_places_every_rotation_like_calc_dest_pos)
+{
+	cpu::thread_pool pool{ 4 };
+
+	const cpu::rotation_t rotations[] =
+	{
+		cpu::rotation_t::identity, cpu::rotation_t::rotate90, cpu::rotation_t::rotate180, cpu::rotation_t::rotate270,
+	};
+
+	const cpu::pixel_format formats[] = { cpu::pixel_format::r8g8b8a8_unorm, cpu::pixel_format::r16g16b16a16_float };
+
+	uint32_t seed = 1;
+
+	for (const auto format : formats)
+	{
+		for (const auto rotation : rotations)
+		{
+			// odd sizes cross tile edges, the offset pushes part of it off dest
+			const auto src = make_source(150, 97, format, seed++);
+			const cpu::render_job job{ src.view, -20, 13, rotation, 240.0f };
+
+			const int width = 200;
+			const int height = 180;
+
+			std::vector<uint32_t> out(static_cast<size_t>(width) * height, 0x12345678u);
+			const cpu::bitmap_view dest{ reinterpret_cast<uint8_t*>(out.data()), width, height, width * 4 };
+
+			cpu::tonemap({ &job, 1 }, dest, pool);
+
+			std::vector<uint32_t> expected(out.size(), 0x12345678u);
+
+			for (int y = 0; y < src.view.height; y++)
+			{
+				for (int x = 0; x < src.view.width; x++)
+				{
+					int dx, dy;
+					reference_pos(job, x, y, dx, dy);
+
+					if (dx >= 0 && dy >= 0 && dx < width && dy < height)
+						expected[static_cast<size_t>(dy) * width + dx] = reference_pixel(src.view, x, y, job.white_level);
+				}
+			}
+
+			int mismatches = 0;
+
+			for (size_t i = 0; i < out.size(); i++)
+				mismatches += !close(out[i], expected[i]);
+
+			CHECK(mismatches == 0);
+		}
+	}
+}
+
+TEST_MAIN()
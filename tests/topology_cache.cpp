@@ -0,0 +1,130 @@
+#include <atomic>
+#include <thread>
+
+#include "check.hpp"
+#include "cpu/topology_cache.hpp"
+
+namespace
+{
+	// side by side 1080p outputs, as many as outputs says
+	struct fake_provider : cpu::topology_provider
+	{
+		std::atomic<int> queries{ 0 };
+		std::atomic<float> white_level{ 200.0f };
+		size_t outputs = 3;
+
+		bool query(size_t output, cpu::output_info& info) override
+		{
+			queries++;
+
+			if (output >= outputs)
+				return false;
+
+			const int x = static_cast<int>(output) * 1920;
+			info.area = { x, 0, x + 1920, 1080 };
+			info.hdr = true;
+			info.sdr_white_level = white_level;
+			return true;
+		}
+	};
+}
+
+TEST(outputs_are_queried_once)
+{
+	fake_provider provider;
+	cpu::topology_cache cache{ provider };
+	cpu::output_info info;
+
+	for (int request = 0; request < 1000; request++)
+	{
+		for (size_t output = 0; output < 3; output++)
+			CHECK(cache.get(output, info));
+	}
+
+	CHECK(provider.queries == 3);
+	CHECK(cache.misses() == 3 && cache.hits() == 2997);
+
+	CHECK(cache.get(2, info));
+	CHECK(info.area.left == 3840 && info.area.right == 5760 && info.hdr);
+}
+
+TEST(invalidate_queries_again)
+{
+	fake_provider provider;
+	cpu::topology_cache cache{ provider };
+	cpu::output_info info;
+
+	cache.get(1, info);
+	const auto generation = cache.generation();
+
+	provider.white_level = 80.0f;
+	cache.get(1, info);
+	CHECK(info.sdr_white_level == 200.0f);
+
+	cache.invalidate();
+	CHECK(cache.generation() > generation);
+
+	cache.get(1, info);
+	CHECK(info.sdr_white_level == 80.0f);
+	CHECK(provider.queries == 2);
+
+	cache.get(1, info);
+	CHECK(provider.queries == 2);
+}
+
+TEST(failed_queries_are_not_cached)
+{
+	fake_provider provider;
+	cpu::topology_cache cache{ provider };
+	cpu::output_info info;
+
+	cache.get(2, info);
+
+	provider.outputs = 1;
+	cache.invalidate();
+
+	CHECK(!cache.get(2, info));
+	CHECK(!cache.get(2, info));
+	CHECK(provider.queries == 3);
+
+	provider.outputs = 3;
+	CHECK(cache.get(2, info));
+	CHECK(cache.get(2, info));
+	CHECK(provider.queries == 4);
+}
+
+TEST(invalidate_from_another_thread)
+{
+	fake_provider provider;
+	cpu::topology_cache cache{ provider };
+
+	std::thread listener{ [&]
+	{
+		for (int i = 0; i < 20000; i++)
+			cache.invalidate();
+	} };
+
+	bool ok = true;
+	cpu::output_info info;
+
+	for (int i = 0; i < 20000; i++)
+		ok &= cache.get(static_cast<size_t>(i) % 3, info) && info.area.width() == 1920;
+
+	listener.join();
+
+	CHECK(ok);
+	CHECK(cache.generation() == 20001);
+
+	// after the last invalidate, every output is queried once more at most
+	const int queries = provider.queries;
+	for (size_t output = 0; output < 3; output++)
+		cache.get(output, info);
+
+	cache.invalidate();
+	for (size_t output = 0; output < 3; output++)
+		cache.get(output, info);
+
+	CHECK(provider.queries <= queries + 6 && provider.queries >= queries + 3);
+}
+
+TEST_MAIN()
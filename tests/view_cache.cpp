@@ -0,0 +1,152 @@
+#include <cstdint>
+#include <map>
+
+#include "check.hpp"
+#include "cpu/view_cache.hpp"
+
+namespace
+{
+	using kind = cpu::view_device::view_kind;
+
+	// views are plain allocations that remember what they were made for
+	struct fake_device : cpu::view_device
+	{
+		struct view
+		{
+			void* texture;
+			uint32_t format;
+			view_kind kind;
+		};
+
+		std::map<void*, view> live;
+		int created = 0;
+		bool fail = false;
+		bool misuse = false;
+
+		void* create_view(void* texture, uint32_t format, view_kind kind) override
+		{
+			if (fail)
+				return nullptr;
+
+			auto* handle = new char;
+			live[handle] = { texture, format, kind };
+			created++;
+			return handle;
+		}
+
+		void release_view(void* handle) override
+		{
+			misuse |= !live.erase(handle);
+			delete static_cast<char*>(handle);
+		}
+	};
+}
+
+TEST(views_are_made_once_per_texture)
+{
+	fake_device device;
+	int textures[4];
+
+	{
+		cpu::view_cache cache{ device };
+
+		// three monitor frames and the desktop texture, captured 100 times
+		for (int capture = 0; capture < 100; capture++)
+		{
+			cache.trim();
+
+			for (int m = 0; m < 3; m++)
+				cache.get(&textures[m], 10, kind::shader_resource);
+
+			cache.get(&textures[3], 87, kind::unordered_access);
+		}
+
+		CHECK(device.created == 4);
+		CHECK(cache.creations() == 4 && cache.hits() == 396);
+		CHECK(cache.size() == 4);
+
+		const auto& view = device.live.at(cache.get(&textures[3], 87, kind::unordered_access));
+		CHECK(view.texture == &textures[3] && view.format == 87 && view.kind == kind::unordered_access);
+	}
+
+	CHECK(device.live.empty());
+	CHECK(!device.misuse);
+}
+
+TEST(format_and_kind_are_part_of_the_key)
+{
+	fake_device device;
+	cpu::view_cache cache{ device };
+	int texture;
+
+	auto* srv = cache.get(&texture, 10, kind::shader_resource);
+	auto* uav = cache.get(&texture, 10, kind::unordered_access);
+	auto* other = cache.get(&texture, 28, kind::shader_resource);
+
+	CHECK(srv != uav && srv != other && uav != other);
+	CHECK(device.created == 3);
+	CHECK(cache.get(&texture, 10, kind::shader_resource) == srv);
+}
+
+TEST(views_idle_for_too_long_are_released)
+{
+	fake_device device;
+	cpu::view_cache cache{ device, 8 };
+	int old_frame, new_frame;
+
+	cache.trim();
+	cache.get(&old_frame, 10, kind::shader_resource);
+
+	// the monitor recreated its frame texture, only the new one is asked for
+	for (int capture = 1; capture <= 8; capture++)
+	{
+		cache.trim();
+		cache.get(&new_frame, 10, kind::shader_resource);
+	}
+
+	CHECK(cache.size() == 2);
+
+	cache.trim();
+	CHECK(cache.size() == 1);
+	CHECK(device.live.size() == 1 && device.live.begin()->second.texture == &new_frame);
+	CHECK(!device.misuse);
+}
+
+TEST(forget_and_clear_release_views)
+{
+	fake_device device;
+	cpu::view_cache cache{ device };
+	int a, b;
+
+	cache.get(&a, 10, kind::shader_resource);
+	cache.get(&a, 10, kind::unordered_access);
+	cache.get(&b, 10, kind::shader_resource);
+
+	cache.forget(&a);
+	CHECK(cache.size() == 1 && device.live.size() == 1);
+
+	// a texture made again at the same address gets fresh views
+	cache.get(&a, 10, kind::shader_resource);
+	CHECK(device.created == 4);
+
+	cache.clear();
+	CHECK(cache.size() == 0 && device.live.empty());
+	CHECK(!device.misuse);
+}
+
+TEST(failed_views_are_not_cached)
+{
+	fake_device device;
+	cpu::view_cache cache{ device };
+	int texture;
+
+	device.fail = true;
+	CHECK(!cache.get(&texture, 10, kind::shader_resource));
+	CHECK(cache.size() == 0);
+
+	device.fail = false;
+	CHECK(cache.get(&texture, 10, kind::shader_resource));
+	CHECK(cache.size() == 1);
+}
+
+TEST_MAIN()
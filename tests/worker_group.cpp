@@ -0,0 +1,145 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+#include "cpu/worker_group.hpp"
+
+namespace
+{
+	using namespace std::chrono_literals;
+}
+
+TEST(every_job_runs_once_and_the_first_on_the_caller)
+{
+	cpu::worker_group group;
+
+	for (const uint32_t count : { 1u, 2u, 5u, 3u })
+	{
+		std::vector<std::atomic<int>> runs(count);
+		std::thread::id first;
+
+		group.run(count, [&](uint32_t i)
+		{
+			runs[i]++;
+
+			if (!i)
+				first = std::this_thread::get_id();
+		});
+
+		bool once = true;
+		for (const auto& r : runs)
+			once &= r == 1;
+
+		CHECK(once);
+		CHECK(first == std::this_thread::get_id());
+	}
+
+	group.run(0, [](uint32_t) {});
+}
+
+TEST(jobs_run_at_the_same_time)
+{
+	cpu::worker_group group;
+
+	// every job waits for all of them to have started, which only finishes
+	// when each one has a thread of its own
+	constexpr uint32_t count = 4;
+	std::atomic<uint32_t> started{ 0 };
+	std::atomic<bool> all{ true };
+
+	group.run(count, [&](uint32_t)
+	{
+		started++;
+
+		const auto until = std::chrono::steady_clock::now() + 5s;
+		while (started < count)
+		{
+			if (std::chrono::steady_clock::now() > until)
+			{
+				all = false;
+				return;
+			}
+
+			std::this_thread::yield();
+		}
+	});
+
+	CHECK(all);
+}
+
+TEST(threads_are_kept_between_runs)
+{
+	cpu::worker_group group;
+
+	std::mutex mutex;
+	std::set<std::thread::id> first, second;
+
+	group.run(3, [&](uint32_t) { std::lock_guard lock{ mutex }; first.insert(std::this_thread::get_id()); std::this_thread::sleep_for(5ms); });
+	group.run(3, [&](uint32_t) { std::lock_guard lock{ mutex }; second.insert(std::this_thread::get_id()); std::this_thread::sleep_for(5ms); });
+
+	CHECK(first.size() == 3);
+	CHECK(first == second);
+}
+
+TEST(an_exception_is_rethrown_once_the_others_are_done)
+{
+	cpu::worker_group group;
+
+	for (const uint32_t thrower : { 0u, 2u })
+	{
+		std::atomic<int> finished{ 0 };
+		bool threw = false;
+
+		try
+		{
+			group.run(4, [&](uint32_t i)
+			{
+				if (i == thrower)
+					throw std::runtime_error{ "job failed" };
+
+				std::this_thread::sleep_for(10ms);
+				finished++;
+			});
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+
+		CHECK(threw);
+		CHECK(finished == 3);
+	}
+
+	// and the group still works afterwards
+	std::atomic<int> runs{ 0 };
+	group.run(4, [&](uint32_t) { runs++; });
+	CHECK(runs == 4);
+}
+
+TEST(runs_from_several_threads_take_turns)
+{
+	cpu::worker_group group;
+	std::atomic<int> runs{ 0 };
+
+	std::vector<std::thread> callers;
+	for (int c = 0; c < 3; c++)
+	{
+		callers.emplace_back([&]
+		{
+			for (int i = 0; i < 20; i++)
+				group.run(3, [&](uint32_t) { runs++; });
+		});
+	}
+
+	for (auto& t : callers)
+		t.join();
+
+	CHECK(runs == 3 * 20 * 3);
+}
+
+TEST_MAIN()
@@ -1,11 +1,23 @@
-Texture2D<float4> src : register(t0);
+// the most monitors one dispatch takes, max_batched_monitors on the cpu side
+#define MAX_MONITORS 8
+
+Texture2D<float4> src[MAX_MONITORS] : register(t0);
 RWTexture2D<float4> dest : register(u0);
 
-cbuffer data : register(b0)
+// a row of the parameter table, one per monitor of the dispatch
+struct monitor_params
 {
 	float white_level;
 	uint is_hdr;
+	uint2 src_offset;
 	float3x3 transform;
+	uint2 src_extent;
+	uint2 src_size;
+};
+
+cbuffer data : register(b0)
+{
+	monitor_params monitors[MAX_MONITORS];
 }
 
 float3 soft_clip(float3 x)
@@ -61,7 +73,23 @@ float3 neutral(float3 color)
 	return result;
 }
 
-uint2 calc_dest_pos(float2 src, uint width, uint height)
+// resource arrays only take literal indices in cs_5_0
+float4 load_src(uint index, uint2 pos)
+{
+	switch (index)
+	{
+	case 0: return src[0][pos];
+	case 1: return src[1][pos];
+	case 2: return src[2][pos];
+	case 3: return src[3][pos];
+	case 4: return src[4][pos];
+	case 5: return src[5][pos];
+	case 6: return src[6][pos];
+	default: return src[7][pos];
+	}
+}
+
+uint2 calc_dest_pos(float2 src, uint width, uint height, float3x3 transform)
 {
     float2x2 rotation =
     {
@@ -84,22 +112,23 @@ uint2 calc_dest_pos(float2 src, uint width, uint height)
 [numthreads(16, 16, 1)]
 void main(uint3 tid : SV_DispatchThreadID)
 {
-	uint width, height;
-	src.GetDimensions(width, height);
+	// z picks the monitor, x and y span the biggest part of any of them
+	const monitor_params params = monitors[tid.z];
 
-	if (tid.x > width || tid.y > height)
+	// only the part of the monitor inside the requested rect is dispatched
+	if (tid.x >= params.src_extent.x || tid.y >= params.src_extent.y)
 	{
 		return;
 	}
 
-	uint2 src_pos = tid.xy;
-	uint2 dest_pos = calc_dest_pos(src_pos, width, height);
+	uint2 src_pos = tid.xy + params.src_offset;
+	uint2 dest_pos = calc_dest_pos(src_pos, params.src_size.x, params.src_size.y, params.transform);
     
-	float3 src_color = src[src_pos].rgb;
+	float3 src_color = load_src(tid.z, src_pos).rgb;
 	
-	if (is_hdr == 1)
+	if (params.is_hdr == 1)
 	{
-		float3 input_color = clamp(src_color, 0, 10000) / (white_level / 80);
+		float3 input_color = clamp(src_color, 0, 10000) / (params.white_level / 80);
 		float3 linear_color = bt2020_inv_gamma(input_color);
 
 		float3 linear_result = linear_tonemap(linear_color);